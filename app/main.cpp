@@ -1,14 +1,68 @@
 #include <iostream>
 #include "particle.hpp"
+#include "ParticleSystem.hpp"
+#include "ForceKernel.hpp"
+#include "ForceSolver.hpp"
+#include "Integrator.hpp"
+#include "Simulation.hpp"
+#include "Diagnostics.hpp"
+#include "Trajectory.hpp"
+#include "Checkpoint.hpp"
+#include "CheckpointGenerator.hpp"
+#include "Profiler.hpp"
+#include "Ensemble.hpp"
+#include "FixedSystem.hpp"
+#include "PersistentRun.hpp"
+#include "DistributedRun.hpp"
+#include "EncounterIntegrator.hpp"
+#include "AutoTuner.hpp"
 #include "InitialConditionGenerator.hpp"
 #include "SolarSystemGenerator.hpp"
 #include "RandomSystemGenerator.hpp"
+#include "ParallelSystemGenerator.hpp"
+#include <algorithm>
 #include <cmath>
 #include <vector>
 #include <random>
 #include <chrono>
+#include <cstdint>
 #include <cstring>
+#include <fstream>
 #include <memory>
+#include <stdexcept>
+#include <utility>
+#include <omp.h>
+
+// Options collected from the command line
+struct RunOptions {
+  std::string mode;
+  std::string type;
+  double dt = 0.0;
+  int time_steps = 0;
+  int num_particles = 0;
+  double epsilon = 0.0;
+  SolverConfig solver;
+  std::string integrator = "euler";
+  std::string output;
+  int every = 1;
+  std::string checkpoint;
+  int checkpoint_every = 1000;
+  std::string restart;
+  bool profile = false;
+  std::string trace;
+  long num_members = 0;
+  std::uint64_t seed = 1;
+  int batch = 64;
+  std::string summary;
+  bool fixed = false;
+  bool persistent = false;
+  int ranks = 1;
+  int test_particles = 0;
+  double encounter_radius = 0.0;
+  double merge_radius = 0.0;
+  bool autotune = false;
+  std::string tuning_cache = "nbody_tuning.txt";
+};
 
 // Function to print help messages
 void print_usage(char* program) {
@@ -16,7 +70,38 @@ void print_usage(char* program) {
   std::cerr << "Options: \n";
   std::cerr << "  --generator solar <dt> <time_steps> Generate Solar system with initial & evolution condition\n";
   std::cerr << "  --generator random <dt> <time_steps> <num_particles> Generate random system with initial & evolution condition\n";
+  std::cerr << "  --generator disk|thick-disk|plummer <dt> <time_steps> <num_particles> Draw the bodies in parallel from counter-based\n"
+               "      random streams of --seed, the same for any number of threads\n";
   std::cerr << "  --softening <epsilon> Set the value of epsilon\n";
+  std::cerr << "  --solver <direct|pairwise|bh> Choose direct summation (default), symmetric pairwise summation or the Barnes-Hut tree\n";
+  std::cerr << "  --theta <theta> Set the Barnes-Hut opening angle (default 0.5)\n";
+  std::cerr << "  --quadrupole Add quadrupole moments to the Barnes-Hut nodes\n";
+  std::cerr << "  --precision <double|mixed> Pair forces in double (default) or in single precision summed in double, mixed needs the direct solver\n";
+  std::cerr << "  --integrator <euler|leapfrog|verlet|yoshida4|wh|block> Choose the time integrator (default euler), wh is Wisdom-Holman for systems around a central mass, block is leapfrog with individual block timesteps up to dt\n";
+  std::cerr << "  --fixed Step with the compile-time fixed-size kernels, for leapfrog or yoshida4 with 2 to 16 bodies and the direct solver\n";
+  std::cerr << "  --persistent Step euler or leapfrog with the direct solver in one parallel region for the whole run, one barrier per step.\n"
+               "      Bind the threads (OMP_PROC_BIND=close) so each block of bodies stays on the socket that first touched it\n";
+  std::cerr << "  --ranks <p> Step leapfrog with the direct solver in p processes, each owning a slice of the bodies, the sources\n"
+               "      passed around a ring in shared memory\n";
+  std::cerr << "  --autotune Time the solvers, their tile, leaf and chunk sizes and the thread counts on this host and run the fastest,\n"
+               "      calibrating once per host, opening angle and power-of-two band of N, --solver is ignored and --theta kept\n";
+  std::cerr << "  --tuning-cache <file> Where --autotune keeps its calibrations (default nbody_tuning.txt)\n";
+  std::cerr << "  --output <file> Record a binary trajectory of positions and velocities\n";
+  std::cerr << "  --every <n> Write a trajectory frame every n steps (default 1)\n";
+  std::cerr << "  --checkpoint <file> Save the full state every --checkpoint-every steps, replacing the file atomically\n";
+  std::cerr << "  --checkpoint-every <n> Steps between checkpoints (default 1000)\n";
+  std::cerr << "  --restart <file> Continue the run from a checkpoint up to <time_steps>, with the same dt, softening and integrator\n";
+  std::cerr << "  --profile Print the time of every phase, the spread over threads and the interaction counts\n";
+  std::cerr << "  --profile-trace <file> Profile and also write a Chrome trace-event JSON of every phase\n";
+  std::cerr << "  --ensemble <dt> <time_steps> <num_members> Run many Solar systems with their own planet phases, leapfrog with batches of members in SIMD lanes\n";
+  std::cerr << "  --encounter-radius <r> Leapfrog that finds the pairs closer than r with a cell list every step and integrates\n"
+               "      them in substeps, r should be several times the distance two bodies close in one step\n";
+  std::cerr << "  --merge-radius <r> With --encounter-radius, merge bodies closer than r into one, conserving mass and momentum\n";
+  std::cerr << "  --test-particles <n> Add n massless bodies that feel the massive ones but not each other, an asteroid belt for solar,\n"
+               "      bodies of the same distribution for random, disk, thick-disk, plummer and --openMP\n";
+  std::cerr << "  --seed <s> Base seed of the ensemble members, of the asteroid belt and of disk, thick-disk and plummer (default 1)\n";
+  std::cerr << "  --batch <n> Ensemble members integrated together by one thread (default 64)\n";
+  std::cerr << "  --summary <file> Stream the energy error and final orbital elements of every ensemble member as CSV\n";
   std::cerr << "  --openMP <dt> <time_steps> <num_particles> Generate random system with initial & evolution condition to check performance using openMP\n";
   std::cerr << "  --help, -h  Show help messages\n";
   std::cerr << "\n";
@@ -25,115 +110,437 @@ void print_usage(char* program) {
   std::cerr << "  " << program << " --generator random 0.001 1000 2048\n";
   std::cerr << "  " << program << " --generator solar 0.001 1000 --softening 0.001\n";
   std::cerr << "  " << program << " --generator random 0.001 1000 2048 --softening 0.001\n";
+  std::cerr << "  " << program << " --generator random 0.001 10 100000 --softening 0.001 --solver bh --theta 0.5\n";
+  std::cerr << "  " << program << " --generator solar 0.01 62832 --integrator leapfrog\n";
+  std::cerr << "  " << program << " --generator solar 0.05 12566 --integrator wh\n";
+  std::cerr << "  " << program << " --generator solar 0.001 6283200 --integrator leapfrog --fixed\n";
+  std::cerr << "  OMP_PROC_BIND=close " << program << " --generator random 0.001 1000 4096 --softening 0.01 --integrator leapfrog --persistent\n";
+  std::cerr << "  " << program << " --generator plummer 0.001 100 16384 --softening 0.01 --integrator leapfrog --ranks 4\n";
+  std::cerr << "  " << program << " --generator random 0.5 100 1000 --integrator block\n";
+  std::cerr << "  " << program << " --generator plummer 0.001 100 100000 --softening 0.01 --integrator leapfrog --autotune\n";
+  std::cerr << "  " << program << " --generator disk 0.001 1000 4096 --integrator leapfrog --encounter-radius 0.05 --merge-radius 0.002\n";
+  std::cerr << "  " << program << " --generator random 0.001 100 16384 --softening 0.01 --integrator leapfrog --precision mixed\n";
+  std::cerr << "  " << program << " --generator random 0.01 10000 100000 --solver bh --output traj.bin --every 100\n";
+  std::cerr << "  " << program << " --generator plummer 0.001 100 100000 --softening 0.01 --solver bh --integrator leapfrog --seed 7\n";
+  std::cerr << "  " << program << " --generator solar 0.001 628320 --integrator leapfrog --checkpoint ckpt.bin --checkpoint-every 10000\n";
+  std::cerr << "  " << program << " --generator solar 0.001 628320 --integrator leapfrog --checkpoint ckpt.bin --checkpoint-every 10000 --restart ckpt.bin\n";
+  std::cerr << "  " << program << " --generator solar 0.01 6283 --integrator leapfrog --test-particles 200000 --output belt.bin --every 628\n";
+  std::cerr << "  " << program << " --ensemble 0.01 6283 100000 --seed 7 --summary members.csv\n";
   std::cerr << "  " << program << " --openMP 0.001 1000 2048\n";
 }
 
-// Function to print position & energy changes for a list of particles
-void print_position_energy(std::string type, double dt, int time_steps, double epsilon = 0.0, int num_particles = 0){
-  std::vector<Particle> particles_start;
-  std::vector<Particle> particles_end;
-  if (type == "solar") {
-    InitialConditionGenerator *generator = new SolarSystemGenerator();
-    particles_start = generator->generateInitialConditions();
-    particles_end = evolution_Solar_System(particles_start, dt, time_steps, epsilon);
-  }
-  else if (type == "random") {
-    InitialConditionGenerator *generator = new RandomSystemGenerator(num_particles);
-    particles_start = generator->generateInitialConditions();
-    particles_end = evolution_Solar_System(particles_start, dt, time_steps, epsilon);
+// Function to parse the command line, returns false if the arguments are not valid
+bool parse_options(int argc, char* argv[], RunOptions& options) {
+  int i = 1;
+  if (argc >= 5 && strcmp(argv[1], "--generator") == 0) {
+    options.mode = "generator";
+    options.type = argv[2];
+    options.dt = std::atof(argv[3]);
+    options.time_steps = std::stoi(argv[4]);
+    i = 5;
+    if (options.type == "random" || ParallelSystemGenerator::hasDistribution(options.type)) {
+      if (argc < 6) {
+        return false;
+      }
+      options.num_particles = std::stoi(argv[5]);
+      i = 6;
+    }
+  }
+  else if (argc >= 5 && strcmp(argv[1], "--ensemble") == 0) {
+    options.mode = "ensemble";
+    options.dt = std::atof(argv[2]);
+    options.time_steps = std::stoi(argv[3]);
+    options.num_members = std::stol(argv[4]);
+    i = 5;
+  }
+  else if (argc >= 5 && strcmp(argv[1], "--openMP") == 0) {
+    options.mode = "openMP";
+    options.dt = std::atof(argv[2]);
+    options.time_steps = std::stoi(argv[3]);
+    options.num_particles = std::stoi(argv[4]);
+    options.epsilon = 0.001;
+    i = 5;
   }
   else {
-    std::cerr << "Type should be either 'solar' or 'random'\n";
+    return false;
+  }
+
+  for (; i < argc; i++) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--softening") == 0 && has_value) {
+      options.epsilon = std::atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--solver") == 0 && has_value) {
+      options.solver.name = argv[++i];
+    }
+    else if (strcmp(argv[i], "--theta") == 0 && has_value) {
+      options.solver.theta = std::atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--precision") == 0 && has_value) {
+      options.solver.precision = argv[++i];
+    }
+    else if (strcmp(argv[i], "--integrator") == 0 && has_value) {
+      options.integrator = argv[++i];
+    }
+    else if (strcmp(argv[i], "--fixed") == 0) {
+      options.fixed = true;
+    }
+    else if (strcmp(argv[i], "--persistent") == 0) {
+      options.persistent = true;
+    }
+    else if (strcmp(argv[i], "--ranks") == 0 && has_value) {
+      options.ranks = std::stoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--autotune") == 0) {
+      options.autotune = true;
+    }
+    else if (strcmp(argv[i], "--tuning-cache") == 0 && has_value) {
+      options.tuning_cache = argv[++i];
+    }
+    else if (strcmp(argv[i], "--output") == 0 && has_value) {
+      options.output = argv[++i];
+    }
+    else if (strcmp(argv[i], "--every") == 0 && has_value) {
+      options.every = std::stoi(argv[++i]);
+      if (options.every < 1) {
+        return false;
+      }
+    }
+    else if (strcmp(argv[i], "--checkpoint") == 0 && has_value) {
+      options.checkpoint = argv[++i];
+    }
+    else if (strcmp(argv[i], "--checkpoint-every") == 0 && has_value) {
+      options.checkpoint_every = std::stoi(argv[++i]);
+      if (options.checkpoint_every < 1) {
+        return false;
+      }
+    }
+    else if (strcmp(argv[i], "--restart") == 0 && has_value) {
+      options.restart = argv[++i];
+    }
+    else if (strcmp(argv[i], "--encounter-radius") == 0 && has_value) {
+      options.encounter_radius = std::stod(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--merge-radius") == 0 && has_value) {
+      options.merge_radius = std::stod(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--test-particles") == 0 && has_value) {
+      options.test_particles = std::stoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+      options.seed = std::stoull(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--batch") == 0 && has_value) {
+      options.batch = std::stoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--summary") == 0 && has_value) {
+      options.summary = argv[++i];
+    }
+    else if (strcmp(argv[i], "--profile") == 0) {
+      options.profile = true;
+    }
+    else if (strcmp(argv[i], "--profile-trace") == 0 && has_value) {
+      options.profile = true;
+      options.trace = argv[++i];
+    }
+    else if (strcmp(argv[i], "--quadrupole") == 0) {
+      options.solver.quadrupole = true;
+    }
+    else {
+      std::cerr << "Unknown or incomplete option: " << argv[i] << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+// Function to build the integrator of the run, the encounter leapfrog when an encounter radius is given
+std::unique_ptr<Integrator> make_run_integrator(const RunOptions& options) {
+  if (options.encounter_radius <= 0.0) {
+    if (options.merge_radius > 0.0) {
+      throw std::invalid_argument("--merge-radius needs --encounter-radius");
+    }
+    return makeIntegrator(options.integrator);
   }
-  for (int i = 0; i < particles_start.size(); i++) {
-    std::cout << "Body No." << i + 1 << " Start position: " << particles_start[i].getPosition().transpose() << "\n";
-    std::cout << "Body No." << i + 1 << " End position: " << particles_end[i].getPosition().transpose() << "\n";
+  if (options.integrator != "leapfrog") {
+    throw std::invalid_argument("--encounter-radius runs leapfrog");
+  }
+  // frames hold a fixed number of bodies
+  if (options.merge_radius > 0.0 && !options.output.empty()) {
+    throw std::invalid_argument("--merge-radius removes bodies, which a trajectory file cannot follow");
+  }
+  return std::make_unique<EncounterIntegrator>(options.encounter_radius, options.merge_radius);
+}
+
+// Function to choose the solver of the run and set its thread count, by the auto-tuner with --autotune
+SolverConfig make_run_solver(const RunOptions& options, const ParticleSystem& system) {
+  if (!options.autotune) {
+    return options.solver;
+  }
+  if (options.fixed || options.persistent || options.ranks > 1) {
+    throw std::invalid_argument("--fixed, --persistent and --ranks sum the forces directly, leave out --autotune");
+  }
+  AutoTuner tuner(options.tuning_cache);
+  const TuningChoice choice = tuner.tune(system, options.epsilon, options.solver);
+  omp_set_num_threads(choice.threads);
+  std::cout << "Auto-tuned: " << describeChoice(choice) << (tuner.calibrated() ? ", calibrated into " : ", from ") << options.tuning_cache << "\n";
+  // the profile covers the run and not the calibration
+  if (options.profile && tuner.calibrated()) {
+    Profiler::enable(!options.trace.empty());
+  }
+  return choice.solver;
+}
+
+// Function to print the start and end positions and the change of the conserved quantities
+void print_changes(const std::vector<Particle>& particles_start, const Diagnostics& diagnostics_start, const ParticleSystem& system_end, const Diagnostics& diagnostics_end, double elapsed) {
+  // the test particles are too many to list, their positions are in the trajectory
+  if (system_end.size() == particles_start.size()) {
+    for (std::size_t i = 0; i < system_end.numMassive(); i++) {
+      std::cout << "Body No." << i + 1 << " Start position: " << particles_start[i].getPosition().transpose() << "\n";
+      std::cout << "Body No." << i + 1 << " End position: " << system_end.getPosition(i).transpose() << "\n";
+    }
   }
-  double total_energy_start = totalEnergy(particles_start);
-  double total_energy_end = totalEnergy(particles_end);
+  else {
+    // merged bodies leave the rest renumbered
+    std::cout << "Bodies: " << particles_start.size() << " at the start, " << system_end.size() << " at the end\n";
+  }
+  if (system_end.numTest() > 0) {
+    std::cout << "Test particles: " << system_end.numTest() << "\n";
+  }
+  double total_energy_start = diagnostics_start.energy();
+  double total_energy_end = diagnostics_end.energy();
   std::cout << "Total start energy: " << total_energy_start << "\n";
   std::cout << "Total end energy: " << total_energy_end << "\n";
   std::cout << "Energy loss: " << total_energy_start - total_energy_end << "\n";
+  std::cout << "Momentum change: " << (diagnostics_end.momentum - diagnostics_start.momentum).norm() << "\n";
+  std::cout << "Angular momentum change: " << (diagnostics_end.angular_momentum - diagnostics_start.angular_momentum).norm() << "\n";
+  std::cout << "Centre of mass drift: " << centreOfMassDrift(diagnostics_start, diagnostics_end, elapsed) << "\n";
 }
 
-// Function to print the time cost of the evolution of system
-void print_openMP_performance(double dt, int time_steps, int num_particles) {
-  InitialConditionGenerator *generator = new RandomSystemGenerator(num_particles);
-  std::vector<Particle> particles_start = generator->generateInitialConditions();
-  auto start = std::chrono::high_resolution_clock::now();
-  std::vector<Particle> particles_end = evolution_Solar_System(particles_start, dt, time_steps, 0.001);
-  auto end = std::chrono::high_resolution_clock::now();
-  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-  double total_time = duration / 1000.0;
-  std::cout << "| " << omp_get_max_threads() << " | " << total_time << " |\n";
+// Function to step a generated system with the fixed-size kernels, in one persistent parallel region or
+// over several processes, writing trajectory frames as print_position_energy does
+void print_kernel_energy(const RunOptions& options, ParticleSystem system, const std::vector<Particle>& particles_start, const Diagnostics& diagnostics_start) {
+  const std::string flag = options.fixed ? "--fixed" : options.persistent ? "--persistent" : "--ranks";
+  if (options.fixed + options.persistent + (options.ranks > 1) > 1) {
+    throw std::invalid_argument("--fixed, --persistent and --ranks are different step kernels, choose one");
+  }
+  if (options.solver.name != "direct" || options.solver.precision != "double" || !options.checkpoint.empty() || !options.restart.empty()) {
+    throw std::invalid_argument(flag + " sums the forces directly in double precision and does not write or restart from checkpoints");
+  }
+  if (options.encounter_radius > 0.0) {
+    throw std::invalid_argument(flag + " does not handle close encounters, leave out --encounter-radius");
+  }
+  if (options.fixed && !hasFixedKernel(system.size(), options.integrator)) {
+    throw std::invalid_argument("--fixed runs leapfrog or yoshida4 with " + std::to_string(kMinFixedBodies) + " to " + std::to_string(kMaxFixedBodies) + " bodies");
+  }
+  if (options.persistent && !hasPersistentKernel(options.integrator)) {
+    throw std::invalid_argument("--persistent runs euler or leapfrog");
+  }
+  if (options.ranks > 1 && options.integrator != "leapfrog") {
+    throw std::invalid_argument("--ranks runs leapfrog");
+  }
+  std::unique_ptr<TrajectoryWriter> writer;
+  if (!options.output.empty()) {
+    writer = std::make_unique<TrajectoryWriter>(options.output, system);
+    writer->write(system, 0.0, 0);
+  }
+  long steps = 0;
+  while (steps < options.time_steps) {
+    long next = options.time_steps;
+    if (writer) {
+      next = std::min<long>(next, (steps / options.every + 1) * options.every);
+    }
+    if (options.fixed) {
+      advanceFixed(system, options.integrator, options.dt, next - steps, options.epsilon);
+    }
+    else if (options.persistent) {
+      advancePersistent(system, options.integrator, options.dt, next - steps, options.epsilon);
+    }
+    else {
+      advanceDistributed(system, options.ranks, options.dt, next - steps, options.epsilon);
+    }
+    steps = next;
+    if (writer && (steps % options.every == 0 || steps == options.time_steps)) {
+      writer->write(system, steps * options.dt, steps);
+    }
+  }
+  if (writer) {
+    writer->close();
+    std::cout << "Wrote " << writer->framesQueued() << " frames to " << options.output << "\n";
+  }
+  print_changes(particles_start, diagnostics_start, system, computeDiagnostics(system, options.epsilon), steps * options.dt);
 }
 
-int main(int argc, char* argv[]) {
-  
-  if (argc == 1 || (argc == 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0))) {
-    print_usage(argv[0]);
+// Function to print position & energy changes for a list of particles
+void print_position_energy(const RunOptions& options) {
+  std::unique_ptr<InitialConditionGenerator> generator;
+  const CheckpointGenerator* restart_generator = nullptr;
+  if (!options.restart.empty()) {
+    auto checkpoint_generator = std::make_unique<CheckpointGenerator>(options.restart);
+    restart_generator = checkpoint_generator.get();
+    generator = std::move(checkpoint_generator);
   }
-  
-  if (argc == 5 && strcmp(argv[1], "--generator" ) == 0 && strcmp(argv[2], "solar") == 0) {
-    std::string type = argv[2];
-    double dt = std::atof(argv[3]);
-    int time_steps = std::stoi(argv[4]);
-      
-    print_position_energy(type, dt, time_steps);
+  else if (options.type == "solar") {
+    if (options.test_particles > 0) {
+      generator = std::make_unique<SolarSystemGenerator>(options.seed, options.test_particles);
+    }
+    else {
+      generator = std::make_unique<SolarSystemGenerator>();
+    }
   }
-
-  if (argc == 6 && strcmp(argv[1], "--generator") == 0 && strcmp(argv[2], "random") == 0) {
-    double dt = std::atof(argv[3]);
-    int time_steps = std::stoi(argv[4]);
-    int num_particles = std::stoi(argv[5]);
-      
-    print_position_energy("random", dt, time_steps, 0.0, num_particles);
+  else if (options.type == "random") {
+    generator = std::make_unique<RandomSystemGenerator>(options.num_particles, options.test_particles);
   }
-
-  if (argc == 7 && strcmp(argv[1], "--generator" ) == 0 && strcmp(argv[2], "solar") == 0 && strcmp(argv[5], "--softening") == 0) {
-    std::string type = argv[2];
-    double dt = std::atof(argv[3]);
-    int time_steps = std::stoi(argv[4]);
-    double epsilon = std::atof(argv[6]);
-      
-    print_position_energy(type, dt, time_steps, epsilon);
+  else if (ParallelSystemGenerator::hasDistribution(options.type)) {
+    generator = std::make_unique<ParallelSystemGenerator>(options.type, options.num_particles, options.seed, options.test_particles);
+  }
+  else {
+    std::cerr << "Type should be 'solar', 'random', 'disk', 'thick-disk' or 'plummer'\n";
+    return;
+  }
+  ParticleSystem system = generator->generateParticleSystem();
+  std::vector<Particle> particles_start = system.toParticles();
+  Diagnostics diagnostics_start = computeDiagnostics(system, options.epsilon);
+  const SolverConfig solver = make_run_solver(options, system);
+  if (options.fixed || options.persistent || options.ranks > 1) {
+    print_kernel_energy(options, std::move(system), particles_start, diagnostics_start);
+    return;
+  }
+  Simulation simulation(std::move(system), makeForceSolver(solver), make_run_integrator(options), options.dt, options.epsilon);
+  if (restart_generator != nullptr) {
+    simulation.restore(restart_generator->checkpoint());
+    std::cout << "Restarted from step " << simulation.steps() << " of " << options.restart << "\n";
   }
+  simulation.setComputePotential(true);
 
-  if (argc == 8 && strcmp(argv[1], "--generator" ) == 0 && strcmp(argv[2], "random") == 0 && strcmp(argv[6], "--softening") == 0) {
-    std::string type = argv[2];
-    double dt = std::atof(argv[3]);
-    int time_steps = std::stoi(argv[4]);
-    int num_particles = std::stoi(argv[5]);
-    double epsilon = std::atof(argv[7]);
-      
-    print_position_energy(type, dt, time_steps, epsilon, num_particles);
+  // Trajectory frames at the first step, every `every` steps and at the end, written by a background thread.
+  // A restarted run continues the file of the first run from the checkpoint on.
+  std::unique_ptr<TrajectoryWriter> writer;
+  if (!options.output.empty() && restart_generator != nullptr) {
+    writer = std::make_unique<TrajectoryWriter>(options.output, simulation.system(), true, simulation.steps());
+  }
+  else if (!options.output.empty()) {
+    writer = std::make_unique<TrajectoryWriter>(options.output, simulation.system());
+    writer->write(simulation.system(), simulation.time(), simulation.steps());
+  }
+  while (simulation.steps() < options.time_steps) {
+    long next = options.time_steps;
+    if (writer) {
+      next = std::min<long>(next, (simulation.steps() / options.every + 1) * options.every);
+    }
+    if (!options.checkpoint.empty()) {
+      next = std::min<long>(next, (simulation.steps() / options.checkpoint_every + 1) * options.checkpoint_every);
+    }
+    simulation.advance(next - simulation.steps());
+    if (writer && (next % options.every == 0 || next == options.time_steps)) {
+      writer->write(simulation.system(), simulation.time(), simulation.steps());
+    }
+    if (!options.checkpoint.empty() && next % options.checkpoint_every == 0) {
+      simulation.writeCheckpoint(options.checkpoint);
+    }
   }
+  if (writer) {
+    writer->close();
+    std::cout << "Wrote " << writer->framesQueued() << " frames to " << options.output << "\n";
+  }
+  if (const auto* encounter = dynamic_cast<const EncounterIntegrator*>(&simulation.integrator())) {
+    std::cout << "Encounter pairs: " << encounter->encounterPairs() << ", substeps: " << encounter->substeps() << ", merged bodies: " << encounter->mergedBodies() << "\n";
+  }
+  print_changes(particles_start, diagnostics_start, simulation.system(), simulation.diagnostics(), simulation.time());
+}
 
-  if (argc == 5 && strcmp(argv[1], "--openMP" ) == 0) {
-    double dt = std::atof(argv[2]);
-    int time_steps = std::stoi(argv[3]);
-    int num_particles = std::stoi(argv[4]);
+// Function to run an ensemble of Solar systems and print the spread of their energy errors
+void print_ensemble(const RunOptions& options) {
+  EnsembleRunner runner([](std::uint64_t seed) { return SolarSystemGenerator(seed).generateParticleSystem(); }, options.dt, options.epsilon, options.batch);
 
-    print_openMP_performance(dt, time_steps, num_particles);
+  std::ofstream summary;
+  if (!options.summary.empty()) {
+    summary.open(options.summary);
+    if (!summary) {
+      throw std::runtime_error("Cannot create '" + options.summary + "'");
+    }
+    summary.precision(17);
   }
 
-  // You should be able to enable or disable any debug during the CMake configure process with cmake -S. -B build -DCMAKE_BUILD_TYPE=Debug ... or -DCMAKE_BUILD_TYPE=Release.
-  #ifdef DEBUG
-  std::vector<Particle> particles_start = initial_condition_generator();
-  std::vector<double> dt_vec = {0.5, 0.1, 0.05, 0.01, 0.005, 0.001, 0.0005, 0.0001};
-  double year_100 = 100 * 2 * M_PI;
-  for (int i = 0; i < dt_vec.size(); i++) { 
-    double dt = dt_vec[i];
-    int time_steps = int(year_100 / dt);
-
-    auto start = std::chrono::high_resolution_clock::now();
-    std::vector<Particle> particles_end = evolution_Solar_System(particles_start, dt, time_steps);
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    double avg_time_per_timestep = static_cast<double>(duration) / time_steps;
+  std::vector<double> errors;
+  errors.reserve(options.num_members);
+  auto start = std::chrono::high_resolution_clock::now();
+  runner.run(options.num_members, options.seed, options.time_steps, [&](const EnsembleSummary& member) {
+    errors.push_back(member.relativeEnergyError());
+    if (summary.is_open()) {
+      if (errors.size() == 1) {
+        summary << "member,seed,energy_start,energy_end,relative_energy_error";
+        for (std::size_t i = 1; i <= member.elements.size(); i++) {
+          summary << ",a" << i << ",e" << i << ",i" << i;
+        }
+        summary << "\n";
+      }
+      summary << member.member << "," << member.seed << "," << member.energy_start << "," << member.energy_end << "," << member.relativeEnergyError();
+      for (const OrbitalElements& elements : member.elements) {
+        summary << "," << elements.semi_major_axis << "," << elements.eccentricity << "," << elements.inclination;
+      }
+      summary << "\n";
+    }
+  });
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
 
-    std::cout << "Timestep size: " << dt << ", Total time: " << duration << "ms, Average time per timestep: " << avg_time_per_timestep << "ms" << std::endl;
+  std::sort(errors.begin(), errors.end());
+  std::cout << "Members: " << errors.size() << ", steps: " << options.time_steps << ", time: " << seconds << " s\n";
+  std::cout << "Member steps per second: " << static_cast<double>(errors.size()) * options.time_steps / seconds << "\n";
+  if (!errors.empty()) {
+    std::cout << "Relative energy error median: " << errors[errors.size() / 2] << ", max: " << errors.back() << "\n";
   }
-  #endif
+}
 
+// Function to print the time cost of the evolution of system
+void print_openMP_performance(const RunOptions& options) {
+  ParticleSystem system = RandomSystemGenerator(options.num_particles, options.test_particles).generateParticleSystem();
+  const SolverConfig solver = make_run_solver(options, system);
+  Simulation simulation(std::move(system), makeForceSolver(solver), make_run_integrator(options), options.dt, options.epsilon);
+  auto start = std::chrono::high_resolution_clock::now();
+  simulation.advance(options.time_steps);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+  double total_time = duration / 1000.0;
+  std::cout << "| " << omp_get_max_threads() << " | " << simdLevelName(detectSimdLevel()) << " | " << total_time << " |\n";
+}
+
+int main(int argc, char* argv[]) {
+  
+  if (argc == 1 || (argc == 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0))) {
+    print_usage(argv[0]);
+  }
+  else {
+    RunOptions options;
+    if (!parse_options(argc, argv, options)) {
+      print_usage(argv[0]);
+      return 1;
+    }
+    try {
+      if (options.profile) {
+        Profiler::enable(!options.trace.empty());
+      }
+      if (options.mode == "generator") {
+        print_position_energy(options);
+      }
+      else if (options.mode == "ensemble") {
+        print_ensemble(options);
+      }
+      else {
+        print_openMP_performance(options);
+      }
+      if (options.profile) {
+        Profiler::disable();
+        Profiler::printSummary(std::cout);
+        if (!options.trace.empty()) {
+          Profiler::writeChromeTrace(options.trace);
+        }
+      }
+    }
+    catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return 1;
+    }
+  }
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Compare two nbody_bench JSON results and flag the cases that got slower.
+
+Usage: compare_bench.py base.json new.json [--threshold 0.05]
+
+Cases are matched on group, variant, N and thread count. A case is a
+regression if its median time grew by more than the threshold and the new
+minimum is also above the old maximum, so noise between repetitions alone
+is not reported. The exit status is 1 if any case regressed.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    cases = {}
+    for r in data["results"]:
+        cases[(r["group"], r["variant"], r["n"], r["threads"])] = r
+    return data.get("context", {}), cases
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("base")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="relative growth of the median counted as a change (default 0.05)")
+    args = parser.parse_args()
+
+    base_context, base = load(args.base)
+    new_context, new = load(args.new)
+    for key in ("build_type", "simd", "max_threads", "proc_bind"):
+        if base_context.get(key) != new_context.get(key):
+            print(f"Warning: {key} differs, {base_context.get(key)} -> {new_context.get(key)}")
+
+    print("| Group | Variant | N | Threads | Base (ms) | New (ms) | Ratio | |")
+    print("|---|---|---|---|---|---|---|---|")
+    regressions = 0
+    for key in sorted(base.keys() & new.keys()):
+        b, n = base[key], new[key]
+        ratio = n["median_s"] / b["median_s"]
+        status = ""
+        if ratio > 1 + args.threshold and n["min_s"] > b["max_s"]:
+            status = "REGRESSION"
+            regressions += 1
+        elif ratio < 1 - args.threshold and n["max_s"] < b["min_s"]:
+            status = "faster"
+        print(f"| {key[0]} | {key[1]} | {key[2]} | {key[3]} | {b['median_s'] * 1e3:.4g} | {n['median_s'] * 1e3:.4g} | {ratio:.3f} | {status} |")
+
+    for key in sorted(base.keys() - new.keys()):
+        print(f"Only in {args.base}: {' '.join(map(str, key))}")
+    for key in sorted(new.keys() - base.keys()):
+        print(f"Only in {args.new}: {' '.join(map(str, key))}")
+
+    print(f"{regressions} regression(s) above {args.threshold:.0%}")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
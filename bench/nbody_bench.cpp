@@ -0,0 +1,438 @@
+#include "ParticleSystem.hpp"
+#include "ForceKernel.hpp"
+#include "ForceSolver.hpp"
+#include "Integrator.hpp"
+#include "Diagnostics.hpp"
+#include "FixedSystem.hpp"
+#include "PersistentRun.hpp"
+#include "Encounters.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "ParallelSystemGenerator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <omp.h>
+#include <unistd.h>
+
+#ifndef NBODY_BUILD_TYPE
+#define NBODY_BUILD_TYPE "unknown"
+#endif
+
+// Flops of one softened interaction in the usual count for N-body codes: 3 subtractions, 6 for r^2 + epsilon^2,
+// 4 for the inverse cube root and 6 for accumulating m r / |r|^3
+const double kFlopsPerInteraction = 20.0;
+const double kEpsilon = 0.01;
+// Steps per iteration of the fixed-size kernels, so the call overhead is spread the way a long run spreads it
+const long kFixedSteps = 100;
+// Steps per iteration of the persistent region, so its fork/join and first force evaluation are spread as in a run
+const long kPersistentSteps = 100;
+// Search radius of the encounter grid, a few times the closest spacing of the random disks
+const double kEncounterRadius = 0.01;
+
+struct BenchOptions {
+  std::vector<long> sizes = {9, 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576};
+  std::vector<int> threads;
+  std::vector<std::string> groups = {"force", "step", "energy", "generate"};
+  int repeats = 5;
+  double min_time = 0.05;
+  long max_direct = 65536;
+  long max_step_direct = 4096;
+  bool pin = true;
+  std::string json;
+  std::string csv;
+};
+
+struct BenchResult {
+  std::string group;
+  std::string variant;
+  long n;
+  int threads;
+  long iterations;
+  int repeats;
+  // seconds per iteration
+  double median;
+  double min;
+  double max;
+  // bodies (or body-steps) and pair interactions done by one iteration, 0 where it has no meaning
+  double bodies;
+  double interactions;
+
+  double nsPerBody() const {
+    return median / bodies * 1e9;
+  }
+  double interactionsPerSecond() const {
+    return interactions / median;
+  }
+  double gflops() const {
+    return interactions * kFlopsPerInteraction / median * 1e-9;
+  }
+};
+
+// Function to print help messages
+void print_usage(char* program) {
+  std::cerr << "Usage: " << program << " [options]\n";
+  std::cerr << "Times force evaluation, full steps, energy evaluation and initial conditions over a sweep of sizes and thread counts.\n";
+  std::cerr << "Options:\n";
+  std::cerr << "  --sizes <n,n,...> Numbers of bodies (default 9,64,256,1024,4096,16384,65536,262144,1048576)\n";
+  std::cerr << "  --threads <t,t,...> OpenMP thread counts (default 1, 2, 4, ... up to the available threads)\n";
+  std::cerr << "  --groups <g,g,...> Any of force, step, energy, generate (default all). For N of 2 to 16, step also times the\n"
+               "    fixed-size kernels (variants */fixed), 100 steps per iteration. Up to --max-step-direct, step also times\n"
+               "    the persistent parallel region (variants */persistent), 100 steps per iteration. force also times the\n"
+               "    O(N) search for close pairs (variant encounters) for every N\n";
+  std::cerr << "  --repeats <r> Timed repetitions, the median is reported (default 5)\n";
+  std::cerr << "  --min-time <s> Shortest time of one repetition, short cases are iterated (default 0.05)\n";
+  std::cerr << "  --max-direct <n> Largest N for the O(N^2) cases (default 65536)\n";
+  std::cerr << "  --max-step-direct <n> Largest N stepped with the direct solver, larger systems use Barnes-Hut (default 4096)\n";
+  std::cerr << "  --quick Short sweep for a smoke test: sizes 64,1024,4096, one and all threads, 3 repeats\n";
+  std::cerr << "  --no-pin Do not bind the OpenMP threads to cores\n";
+  std::cerr << "  --json <file> Write the results as JSON, see bench/compare_bench.py\n";
+  std::cerr << "  --csv <file> Write the results as CSV\n";
+  std::cerr << "  --help, -h  Show help messages\n";
+}
+
+template <typename T>
+std::vector<T> parse_list(const std::string& text) {
+  std::vector<T> values;
+  std::stringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    std::stringstream field(item);
+    T value;
+    if (!(field >> value)) {
+      throw std::invalid_argument("Cannot read '" + item + "' in the list '" + text + "'");
+    }
+    values.push_back(value);
+  }
+  return values;
+}
+
+// Function to parse the command line, returns false if the arguments are not valid
+bool parse_options(int argc, char* argv[], BenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--sizes") == 0 && has_value) {
+      options.sizes = parse_list<long>(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+      options.threads = parse_list<int>(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--groups") == 0 && has_value) {
+      options.groups = parse_list<std::string>(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--repeats") == 0 && has_value) {
+      options.repeats = std::stoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--min-time") == 0 && has_value) {
+      options.min_time = std::stod(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--max-direct") == 0 && has_value) {
+      options.max_direct = std::stol(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--max-step-direct") == 0 && has_value) {
+      options.max_step_direct = std::stol(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--quick") == 0) {
+      options.sizes = {64, 1024, 4096};
+      options.threads = {1, omp_get_max_threads()};
+      options.repeats = 3;
+    }
+    else if (strcmp(argv[i], "--no-pin") == 0) {
+      options.pin = false;
+    }
+    else if (strcmp(argv[i], "--json") == 0 && has_value) {
+      options.json = argv[++i];
+    }
+    else if (strcmp(argv[i], "--csv") == 0 && has_value) {
+      options.csv = argv[++i];
+    }
+    else {
+      std::cerr << "Unknown or incomplete option: " << argv[i] << "\n";
+      return false;
+    }
+  }
+  for (const std::string& group : options.groups) {
+    if (group != "force" && group != "step" && group != "energy" && group != "generate") {
+      std::cerr << "Unknown benchmark group: " << group << "\n";
+      return false;
+    }
+  }
+  if (options.threads.empty()) {
+    for (int t = 1; t < omp_get_max_threads(); t *= 2) {
+      options.threads.push_back(t);
+    }
+    options.threads.push_back(omp_get_max_threads());
+  }
+  std::sort(options.threads.begin(), options.threads.end());
+  options.threads.erase(std::unique(options.threads.begin(), options.threads.end()), options.threads.end());
+  if (options.repeats < 1 || options.min_time < 0.0 || options.threads.front() < 1) {
+    return false;
+  }
+  return true;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Function to time body: one warm-up call sizes the iteration count so a repetition lasts at least min_time,
+// then every repetition is timed as a whole and divided by the iterations
+BenchResult measure(const BenchOptions& options, const std::function<void()>& body) {
+  auto start = std::chrono::steady_clock::now();
+  body();
+  const double first = seconds_since(start);
+  const long iterations = std::max(1L, static_cast<long>(std::ceil(options.min_time / std::max(first, 1e-9))));
+
+  std::vector<double> times;
+  for (int r = 0; r < options.repeats; r++) {
+    start = std::chrono::steady_clock::now();
+    for (long k = 0; k < iterations; k++) {
+      body();
+    }
+    times.push_back(seconds_since(start) / static_cast<double>(iterations));
+  }
+  std::sort(times.begin(), times.end());
+
+  BenchResult result;
+  result.iterations = iterations;
+  result.repeats = options.repeats;
+  const std::size_t mid = times.size() / 2;
+  result.median = times.size() % 2 == 1 ? times[mid] : 0.5 * (times[mid - 1] + times[mid]);
+  result.min = times.front();
+  result.max = times.back();
+  return result;
+}
+
+void print_result(const BenchResult& r) {
+  std::cout << "| " << r.group << " | " << r.variant << " | " << r.n << " | " << r.threads << " | " << r.median * 1e3 << " | " << r.nsPerBody() << " | ";
+  if (r.interactions > 0.0) {
+    std::cout << r.interactionsPerSecond() << " | " << r.gflops() << " |\n";
+  }
+  else {
+    std::cout << "- | - |\n";
+  }
+}
+
+// Function to run every selected case of one size with the current thread count
+void run_size(const BenchOptions& options, long n, int threads, std::vector<BenchResult>& results) {
+  const ParticleSystem initial = RandomSystemGenerator(static_cast<int>(n)).generateParticleSystem();
+  const double pairs = static_cast<double>(n) * static_cast<double>(n - 1);
+
+  auto record = [&](const std::string& group, const std::string& variant, double bodies, double interactions, const std::function<void()>& body) {
+    BenchResult result = measure(options, body);
+    result.group = group;
+    result.variant = variant;
+    result.n = n;
+    result.threads = threads;
+    result.bodies = bodies;
+    result.interactions = interactions;
+    print_result(result);
+    results.push_back(result);
+  };
+
+  for (const std::string& group : options.groups) {
+    if (group == "force") {
+      for (const std::string name : {"direct", "pairwise", "bh"}) {
+        if (name != "bh" && n > options.max_direct) {
+          continue;
+        }
+        SolverConfig config;
+        config.name = name;
+        std::unique_ptr<ForceSolver> solver = makeForceSolver(config);
+        ParticleSystem system = initial;
+        solver->reserve(system.size());
+        // pairwise visits every pair once but applies both forces, so it is credited with the same interactions
+        record(group, name, static_cast<double>(n), name == "bh" ? 0.0 : pairs, [&] {
+          solver->computeAccelerations(system, kEpsilon);
+        });
+      }
+      EncounterGrid grid(kEncounterRadius);
+      record(group, "encounters", static_cast<double>(n), 0.0, [&] {
+        volatile std::size_t pairs_found = grid.findPairs(initial).size();
+        (void)pairs_found;
+      });
+      if (n <= options.max_direct) {
+        SolverConfig config;
+        config.precision = "mixed";
+        std::unique_ptr<ForceSolver> solver = makeForceSolver(config);
+        ParticleSystem system = initial;
+        solver->reserve(system.size());
+        record(group, "direct-mixed", static_cast<double>(n), pairs, [&] {
+          solver->computeAccelerations(system, kEpsilon);
+        });
+      }
+    }
+    else if (group == "step") {
+      SolverConfig config;
+      config.name = n > options.max_step_direct ? "bh" : "direct";
+      for (const std::string name : {"leapfrog", "yoshida4", "wh", "block"}) {
+        std::unique_ptr<ForceSolver> solver = makeForceSolver(config);
+        std::unique_ptr<Integrator> integrator = makeIntegrator(name);
+        ParticleSystem system = initial;
+        solver->reserve(system.size());
+        integrator->reserve(system.size());
+        record(group, name + "/" + config.name, static_cast<double>(n), 0.0, [&] {
+          integrator->step(system, *solver, 0.01, kEpsilon);
+        });
+      }
+      for (const std::string name : {"leapfrog", "yoshida4"}) {
+        if (!hasFixedKernel(n, name)) {
+          continue;
+        }
+        ParticleSystem system = initial;
+        record(group, name + "/fixed", static_cast<double>(n * kFixedSteps), 0.0, [&] {
+          advanceFixed(system, name, 0.01, kFixedSteps, kEpsilon);
+        });
+      }
+      if (n <= options.max_step_direct) {
+        ParticleSystem system = initial;
+        record(group, "leapfrog/persistent", static_cast<double>(n * kPersistentSteps), 0.0, [&] {
+          advancePersistent(system, "leapfrog", 0.01, kPersistentSteps, kEpsilon);
+        });
+      }
+    }
+    else if (group == "energy" && n <= options.max_direct) {
+      record(group, "pairs", static_cast<double>(n), 0.5 * pairs, [&] {
+        volatile double energy = computeDiagnostics(initial, kEpsilon).energy();
+        (void)energy;
+      });
+    }
+    else if (group == "generate") {
+      record(group, "random", static_cast<double>(n), 0.0, [&] {
+        ParticleSystem system = RandomSystemGenerator(static_cast<int>(n)).generateParticleSystem();
+        volatile double mass = system.m.back();
+        (void)mass;
+      });
+      for (const std::string name : {"disk", "thick-disk", "plummer"}) {
+        record(group, name, static_cast<double>(n), 0.0, [&] {
+          ParticleSystem system = ParallelSystemGenerator(name, n).generateParticleSystem();
+          volatile double mass = system.m.back();
+          (void)mass;
+        });
+      }
+    }
+  }
+}
+
+const char* proc_bind_name() {
+  switch (omp_get_proc_bind()) {
+    case omp_proc_bind_false: return "false";
+    case omp_proc_bind_true: return "true";
+    case omp_proc_bind_master: return "master";
+    case omp_proc_bind_close: return "close";
+    case omp_proc_bind_spread: return "spread";
+  }
+  return "unknown";
+}
+
+std::string timestamp() {
+  std::time_t now = std::time(nullptr);
+  char text[32];
+  std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  return text;
+}
+
+void write_json(const std::string& path, const std::vector<BenchResult>& results) {
+  std::ofstream out(path);
+  out.precision(9);
+  out << "{\n";
+  out << "  \"context\": {\"timestamp\": \"" << timestamp() << "\", \"build_type\": \"" << NBODY_BUILD_TYPE << "\", \"compiler\": \"" << __VERSION__
+      << "\", \"simd\": \"" << simdLevelName(detectSimdLevel()) << "\", \"max_threads\": " << omp_get_max_threads()
+      << ", \"proc_bind\": \"" << proc_bind_name() << "\", \"flops_per_interaction\": " << kFlopsPerInteraction << "},\n";
+  out << "  \"results\": [\n";
+  for (std::size_t k = 0; k < results.size(); k++) {
+    const BenchResult& r = results[k];
+    out << "    {\"group\": \"" << r.group << "\", \"variant\": \"" << r.variant << "\", \"n\": " << r.n << ", \"threads\": " << r.threads
+        << ", \"repeats\": " << r.repeats << ", \"iterations\": " << r.iterations << ", \"median_s\": " << r.median << ", \"min_s\": " << r.min
+        << ", \"max_s\": " << r.max << ", \"ns_per_body\": " << r.nsPerBody();
+    if (r.interactions > 0.0) {
+      out << ", \"interactions_per_s\": " << r.interactionsPerSecond() << ", \"gflops\": " << r.gflops();
+    }
+    out << "}" << (k + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+  if (!out) {
+    throw std::runtime_error("Cannot write '" + path + "'");
+  }
+}
+
+void write_csv(const std::string& path, const std::vector<BenchResult>& results) {
+  std::ofstream out(path);
+  out.precision(9);
+  out << "group,variant,n,threads,repeats,iterations,median_s,min_s,max_s,ns_per_body,interactions_per_s,gflops\n";
+  for (const BenchResult& r : results) {
+    out << r.group << "," << r.variant << "," << r.n << "," << r.threads << "," << r.repeats << "," << r.iterations << "," << r.median << ","
+        << r.min << "," << r.max << "," << r.nsPerBody() << ",";
+    if (r.interactions > 0.0) {
+      out << r.interactionsPerSecond() << "," << r.gflops() << "\n";
+    }
+    else {
+      out << ",\n";
+    }
+  }
+  if (!out) {
+    throw std::runtime_error("Cannot write '" + path + "'");
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc == 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)) {
+    print_usage(argv[0]);
+    return 0;
+  }
+  BenchOptions options;
+  try {
+    if (!parse_options(argc, argv, options)) {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  // The OpenMP runtime reads the binding when it starts, so pinning means starting again with it in the environment
+  if (options.pin && std::getenv("OMP_PROC_BIND") == nullptr) {
+    setenv("OMP_PROC_BIND", "close", 1);
+    setenv("OMP_PLACES", "cores", 1);
+    execv("/proc/self/exe", argv);
+    std::cerr << "Could not restart with pinned threads, timing unpinned\n";
+  }
+
+  std::cout << "Build " << NBODY_BUILD_TYPE << ", " << simdLevelName(detectSimdLevel()) << ", OMP_PROC_BIND=" << proc_bind_name() << "\n";
+  if (std::string(NBODY_BUILD_TYPE) != "Release") {
+    std::cout << "Warning: not a Release build, configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers\n";
+  }
+  std::cout << "| Group | Variant | N | Threads | Median (ms) | ns per body | Interactions/s | GFLOP/s |\n";
+  std::cout << "|---|---|---|---|---|---|---|---|\n";
+
+  std::vector<BenchResult> results;
+  try {
+    for (int threads : options.threads) {
+      omp_set_num_threads(threads);
+      for (long n : options.sizes) {
+        run_size(options, n, threads, results);
+      }
+    }
+    if (!options.json.empty()) {
+      write_json(options.json, results);
+    }
+    if (!options.csv.empty()) {
+      write_csv(options.csv, results);
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "ForceSolver.hpp"
+#include "ParticleSystem.hpp"
+
+// Solver settings and thread count chosen for one band of system sizes on one host
+struct TuningChoice {
+    SolverConfig solver;
+    int threads = 1;
+    // measured seconds per force evaluation of the whole system
+    double seconds = 0.0;
+};
+
+// Function to describe a choice in one line, e.g. "bh (theta 0.5, leaf 8, chunk 64), 4 threads, 1.2 ms per force evaluation"
+std::string describeChoice(const TuningChoice& choice);
+
+// Largest prefixes of a system the O(N^2) solvers and the tree are timed on
+constexpr std::size_t kMaxDirectCalibrationBodies = 4096;
+constexpr std::size_t kMaxTreeCalibrationBodies = 16384;
+
+// Chooses the fastest double precision solver for a system by timing force evaluations on the host
+// it runs on. Systems are grouped into bands of sizes 2^b .. 2^(b+1) - 1, by their number of bodies and
+// by their number of massive bodies, which sets the cost of the O(N^2) solvers, and the first system of
+// a band is calibrated:
+//   1. at the full thread count, the direct solver, the pairwise solver with several tile sides and
+//      the Barnes-Hut solver with several leaf sizes and walk chunks are timed,
+//   2. the fastest of each of the three is timed again at 1, 2, 4, ... threads up to the full count.
+// The O(N^2) solvers are timed on the first kMaxDirectCalibrationBodies bodies and the tree on the
+// first kMaxTreeCalibrationBodies, their times scaled up to the whole system, so a calibration takes
+// a few seconds on any system size. The generators draw the bodies independently, so a prefix has
+// the same distribution as the whole system.
+//
+// The results are appended to a text cache, one line per host, bands and thread count:
+//   host band massive_band max_threads theta quadrupole solver tile leaf_size chunk threads seconds
+// The host is the CPU model, the number of logical processors and the SIMD level, so one cache file
+// on a shared file system serves every kind of node, and the last matching line wins. max_threads is
+// omp_get_max_threads() at the calibration, so a run limited by OMP_NUM_THREADS calibrates again.
+class AutoTuner {
+public:
+    // The cache is read at the first tune(), a missing file is an empty cache
+    explicit AutoTuner(std::string cache_path);
+
+    // Function to choose the solver and thread count for system, from the cache when this host has
+    // calibrated the bands of system.size() and system.numMassive() at the current omp_get_max_threads()
+    // with the theta and quadrupole of base, else by calibrating and appending the result to the cache.
+    // choice.threads is at most omp_get_max_threads(), the caller applies it with omp_set_num_threads.
+    // Throws std::invalid_argument for mixed precision and std::runtime_error if the cache cannot be
+    // read or written or holds a malformed line.
+    TuningChoice tune(const ParticleSystem& system, double epsilon, const SolverConfig& base);
+
+    // whether the last tune() calibrated instead of reading the cache
+    bool calibrated() const;
+
+    // Function to time the candidates on system with up to max_threads threads, the thread count is restored afterwards
+    static TuningChoice calibrate(const ParticleSystem& system, double epsilon, const SolverConfig& base, int max_threads);
+
+    // CPU model, logical processors and SIMD level without whitespace, e.g. "Intel(R)_Xeon(R)_Gold_6248R/96/avx512"
+    static std::string hostKey();
+    // band of a system of n >= 1 bodies or massive bodies, floor(log2 n)
+    static int band(std::size_t n);
+
+private:
+    // what a cache line is looked up by, besides the theta and quadrupole of the base configuration
+    struct CacheKey {
+        std::string host;
+        int band = 0;
+        int massive_band = 0;
+        int max_threads = 1;
+    };
+
+    bool findEntry(const CacheKey& key, const SolverConfig& base, TuningChoice& choice) const;
+    void appendEntry(const CacheKey& key, const TuningChoice& choice) const;
+
+    std::string cache_path_;
+    bool calibrated_ = false;
+};
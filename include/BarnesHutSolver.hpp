@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "AlignedAllocator.hpp"
+#include "ForceSolver.hpp"
+
+// O(N log N) tree code. Bodies are sorted along a Morton curve and the octree is built
+// level by level into a node pool that keeps its capacity between steps.
+class BarnesHutSolver : public ForceSolver {
+public:
+    // chunk is the number of bodies a thread takes at a time from the dynamically scheduled tree walk.
+    // Throws std::invalid_argument unless leaf_size >= 1 and chunk >= 1
+    explicit BarnesHutSolver(double theta = 0.5, bool quadrupole = false, int leaf_size = 8, int chunk = 64);
+    void computeAccelerations(ParticleSystem& system, double epsilon) override;
+    // builds the tree from every body but only walks it for the active ones
+    void computeActiveAccelerations(ParticleSystem& system, const std::vector<int>& active, double epsilon) override;
+    // the node pool is sized for one node per body and still grows if a clustered tree needs more
+    void reserve(std::size_t num_particles) override;
+
+    std::size_t nodeCount() const;
+
+    struct Node {
+        double com[3];
+        double mass;
+        // traceless quadrupole about the centre of mass: xx, xy, xz, yy, yz, zz
+        double quad[6];
+        double center[3];
+        double half_size;
+        std::uint32_t begin, end;
+        std::int32_t first_child;
+        std::int32_t num_children;
+        int level;
+    };
+
+private:
+    void sortBodies(const ParticleSystem& system);
+    void buildTree();
+    void computeMoments();
+    void walk(std::size_t i, double epsilon2, double* acc) const;
+    void childRanges(const Node& node, std::uint32_t* bounds) const;
+
+    double theta_;
+    bool quadrupole_;
+    int leaf_size_;
+    int chunk_;
+
+    double root_center_[3];
+    double root_half_size_;
+
+    std::vector<std::uint64_t> keys_, keys_tmp_;
+    std::vector<std::uint32_t> order_, order_tmp_;
+    // sorted position of every body, the inverse of order_
+    std::vector<std::uint32_t> rank_;
+    AlignedVector x_, y_, z_, m_;
+    std::vector<Node> nodes_;
+    std::vector<std::size_t> level_begin_;
+    std::vector<std::uint32_t> child_offsets_;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include "AlignedAllocator.hpp"
+#include "Integrator.hpp"
+#include "ParticleSystem.hpp"
+
+// Kick-drift-kick leapfrog with individual power-of-two block timesteps. Body i moves with
+// dt / 2^level_i, where the level follows the Aarseth-style criterion eta |a| / |da/dt|.
+// All bodies drift to every sub-step, which predicts the positions of the inactive ones, but
+// only the bodies at the end of their own step get new accelerations and kicks.
+class BlockTimestepIntegrator : public Integrator {
+public:
+    explicit BlockTimestepIntegrator(double eta = 0.01, int max_level = 12);
+
+    // dt is the longest step, every body is synchronised again at its end
+    void step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) override;
+    std::string name() const override;
+    void reset() override;
+    void reserve(std::size_t num_particles) override;
+    void saveState(const ParticleSystem& system, std::vector<double>& state) const override;
+    void restoreState(ParticleSystem& system, const ForceSolver& solver, double epsilon, const std::vector<double>& state, std::size_t& pos) override;
+
+    // current level of every body, step i is dt / 2^level(i)
+    const std::vector<int>& levels() const;
+
+private:
+    void startUp(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon);
+    int desiredLevel(const ParticleSystem& system, std::size_t i, double dt) const;
+
+    double eta_;
+    int max_level_;
+
+    std::vector<int> level_;
+    std::vector<int> active_;
+    // acceleration at the start of each body's current step and the estimated |da/dt|
+    AlignedVector start_ax_, start_ay_, start_az_;
+    AlignedVector jerk_;
+    ParticleSystem probe_;
+    const ParticleSystem* state_for_ = nullptr;
+};
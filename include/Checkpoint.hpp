@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ParticleSystem.hpp"
+
+// Checkpoint file, all values little-endian:
+//   header   CheckpointHeader (80 bytes)
+//   arrays   m, x, y, z, vx, vy, vz, ax, ay, az, num_bodies doubles each
+//   state    state_size doubles saved by Integrator::saveState
+// The generators draw all their random numbers before the first step, so there is no RNG state to keep.
+struct CheckpointHeader {
+    char magic[8];
+    std::uint32_t version;
+    // trailing test particles, 0 in files written before they existed
+    std::uint32_t num_test;
+    std::uint64_t num_bodies;
+    std::int64_t steps;
+    double time;
+    double dt;
+    double epsilon;
+    std::uint64_t state_size;
+    // Integrator::name() of the integrator that saved the state, zero padded
+    char integrator[16];
+};
+
+// version 2 added the integrator name, version 1 files cannot be checked against the integrator and are rejected
+constexpr std::uint32_t kCheckpointVersion = 2;
+
+// Writes path + ".tmp", flushes it to disk and renames it over path, so an interrupted write
+// leaves the previous checkpoint intact. Throws std::runtime_error on I/O errors and for an
+// integrator name longer than 15 characters.
+void writeCheckpoint(const std::string& path, const ParticleSystem& system, long steps, double dt, double epsilon, const std::string& integrator, const std::vector<double>& integrator_state);
+
+// Maps a checkpoint file read-only; the particle arrays are copied out of the mapping in bulk
+class Checkpoint {
+public:
+    // throws std::runtime_error if the file cannot be mapped or is not a checkpoint
+    explicit Checkpoint(const std::string& path);
+    ~Checkpoint();
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    std::size_t numBodies() const;
+    long steps() const;
+    double time() const;
+    double timestep() const;
+    double softening() const;
+    // name of the integrator that wrote the checkpoint
+    std::string integrator() const;
+
+    void loadInto(ParticleSystem& system) const;
+    std::vector<double> integratorState() const;
+
+private:
+    const double* array(int k) const;
+
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    CheckpointHeader header_;
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include "Checkpoint.hpp"
+#include "InitialConditionGenerator.hpp"
+
+// Initial conditions taken from a checkpoint, the particle arrays as they were when it was written.
+// Pass checkpoint() to Simulation::restore to continue with the step count and integrator state as well.
+class CheckpointGenerator : public InitialConditionGenerator {
+public:
+    // throws std::runtime_error if path is not a checkpoint file
+    explicit CheckpointGenerator(const std::string& path);
+
+    std::vector<Particle> generateInitialConditions() override;
+    ParticleSystem generateParticleSystem() override;
+
+    const Checkpoint& checkpoint() const;
+
+private:
+    Checkpoint checkpoint_;
+};
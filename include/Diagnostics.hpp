@@ -0,0 +1,27 @@
+#pragma once
+#include <Eigen/Core>
+#include "AlignedAllocator.hpp"
+#include "ParticleSystem.hpp"
+
+// Conserved quantities of a system, summed with compensated (Neumaier) summation
+struct Diagnostics {
+    double mass = 0.0;
+    double kinetic = 0.0;
+    double potential = 0.0;
+    Eigen::Vector3d momentum = Eigen::Vector3d::Zero();
+    Eigen::Vector3d angular_momentum = Eigen::Vector3d::Zero();
+    Eigen::Vector3d centre_of_mass = Eigen::Vector3d::Zero();
+    Eigen::Vector3d centre_of_mass_velocity = Eigen::Vector3d::Zero();
+
+    double energy() const;
+};
+
+// One parallel pass over the bodies and the unordered pairs. Pairs are excluded by index, and
+// the softening matches the force kernels: -m_i m_j / sqrt(r^2 + epsilon^2).
+Diagnostics computeDiagnostics(const ParticleSystem& system, double epsilon = 0.0);
+
+// O(N) pass that takes the potential of every body from a force evaluation at the current positions
+Diagnostics computeDiagnostics(const ParticleSystem& system, const AlignedVector& potential);
+
+// Distance between the centre of mass and where uniform motion from start would have taken it after elapsed
+double centreOfMassDrift(const Diagnostics& start, const Diagnostics& now, double elapsed);
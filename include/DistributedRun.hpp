@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include "ParticleSystem.hpp"
+#include "Transport.hpp"
+
+// Leapfrog with direct summation over the ranks of transport, rank r owning bodies
+// n r / P .. n (r + 1) / P - 1 of the n bodies of system. Forces come from the systolic ring: the
+// massive bodies of every slice travel once around the ring, so a rank holds two slices of sources at a
+// time and each force evaluation moves P - 1 slices through every rank. Every rank passes the same
+// initial system. On return rank 0 holds the whole final state, gathered around the ring, and the
+// other ranks hold their own slice. Sums run over the slices in ring order, so the accelerations
+// agree with DirectSolver to rounding rather than bit for bit.
+// Throws std::invalid_argument if the transport capacity is below distributedCapacity.
+void runDistributedLeapfrog(Transport& transport, ParticleSystem& system, double dt, long num_steps, double epsilon = 0.0);
+
+// Message size in doubles that runDistributedLeapfrog needs for num_bodies bodies over num_ranks ranks
+std::size_t distributedCapacity(std::size_t num_bodies, int num_ranks);
+
+// runDistributedLeapfrog in num_ranks processes on this machine, see runLocalRanks
+void advanceDistributed(ParticleSystem& system, int num_ranks, double dt, long num_steps, double epsilon = 0.0);
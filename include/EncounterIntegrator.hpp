@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include "Encounters.hpp"
+#include "Integrator.hpp"
+#include "ParticleSystem.hpp"
+
+// Kick-drift-kick leapfrog that resolves close encounters. Each step, the bodies closer than the
+// encounter radius are collected into groups. Inside a group, the pair potential is shared between the
+// half kicks and the group itself, the group's share growing smoothly from 0 at the radius to all of it
+// at a tenth of the radius. The group then drifts under its own share in dt / k leapfrog substeps, k
+// chosen from the pericentre of its closest pair, while the rest of the system keeps the step dt.
+// Without encounters a step is the same as LeapfrogIntegrator's.
+// Pairs are found at the start of a step, so the radius should be several times the distance two
+// bodies close in one step.
+// With a merge radius, groups of bodies closer than it are first merged by mergeCollisions, which
+// shrinks the system. The merge radius is at most the encounter radius, so one search finds both.
+class EncounterIntegrator : public Integrator {
+public:
+    // Throws std::invalid_argument unless encounter_radius > 0, 0 <= merge_radius <= encounter_radius, eta > 0 and max_substeps >= 1
+    explicit EncounterIntegrator(double encounter_radius, double merge_radius = 0.0, double eta = 0.05, int max_substeps = 1024);
+
+    void step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) override;
+    std::string name() const override;
+
+    // totals since construction: pairs found at the start of the steps, substeps of the groups and bodies merged away
+    long encounterPairs() const;
+    long substeps() const;
+    long mergedBodies() const;
+
+private:
+    // Function to subtract h times the forces inside the groups from the velocities of their members
+    void removeGroupKick(ParticleSystem& system, double h);
+    void groupAccelerations(const ParticleSystem& system, int g, double epsilon2);
+    int groupSubsteps(const ParticleSystem& system, int g, double dt, double epsilon2) const;
+
+    EncounterGrid grid_;
+    double merge_radius_;
+    double eta_;
+    int max_substeps_;
+
+    std::vector<int> members_;
+    std::vector<int> group_begin_;
+    // accelerations from inside the group and start positions, by position in members_
+    std::vector<double> group_ax_, group_ay_, group_az_;
+    std::vector<double> start_x_, start_y_, start_z_;
+
+    long encounter_pairs_ = 0;
+    long substeps_ = 0;
+    long merged_bodies_ = 0;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ParticleSystem.hpp"
+
+// Pair of bodies i < j closer than the search radius
+using EncounterPair = std::pair<int, int>;
+
+// Uniform cell list for finding the pairs of bodies closer than a fixed radius in O(N). The cells
+// are cubes with the radius as side, so a body only needs to look at its own cell and the 26 around
+// it. Cells are hashed into a table of about twice as many buckets as bodies, which bounds the
+// memory for any spread of the system; bodies of different cells that share a bucket are told
+// apart by the distance check. The buffers are kept between searches, so a search per step does not
+// touch the heap once the system stops growing.
+class EncounterGrid {
+public:
+    // Throws std::invalid_argument unless radius > 0
+    explicit EncounterGrid(double radius);
+
+    // Function to find every pair closer than radius(), sorted, skipping pairs of two test particles
+    const std::vector<EncounterPair>& findPairs(const ParticleSystem& system);
+
+    double radius() const;
+    const std::vector<EncounterPair>& pairs() const;
+
+private:
+    std::int64_t cellOf(double coordinate) const;
+    std::uint32_t bucketOf(std::int64_t cx, std::int64_t cy, std::int64_t cz) const;
+
+    double radius_;
+    std::uint64_t mask_ = 0;
+    // cell coordinates of body i at 3 i .. 3 i + 2 and its bucket
+    std::vector<std::int64_t> cell_;
+    std::vector<std::uint32_t> bucket_;
+    // bodies sorted by bucket, those of bucket b are order_[start_[b]] .. order_[start_[b + 1] - 1]
+    std::vector<std::uint32_t> start_;
+    std::vector<int> order_;
+    std::vector<std::vector<EncounterPair>> thread_pairs_;
+    std::vector<EncounterPair> pairs_;
+};
+
+// Function to collect the bodies linked by pairs into groups, joining groups that share a body. The
+// bodies of group g are members[group_begin[g]] .. members[group_begin[g + 1] - 1] in increasing order,
+// and the groups are ordered by their first body.
+void encounterGroups(const std::vector<EncounterPair>& pairs, std::vector<int>& members, std::vector<int>& group_begin);
+
+// Merge every group of bodies linked by pairs closer than radius into its first body, which takes the
+// total mass and the centre of mass position and velocity, so mass and momentum are conserved and the
+// kinetic energy of the relative motion is lost. The other bodies are removed from the arrays, keeping
+// the order of the rest; a test particle that hits a massive body is absorbed without changing it.
+// pairs must have been found for the current positions with a search radius of at least radius.
+// Returns the number of bodies removed. Accelerations of merged bodies are zeroed, so an integrator
+// must be reset() when this returns more than 0.
+std::size_t mergeCollisions(ParticleSystem& system, const std::vector<EncounterPair>& pairs, double radius);
+// as above with the pairs closer than grid.radius()
+std::size_t mergeCollisions(ParticleSystem& system, EncounterGrid& grid);
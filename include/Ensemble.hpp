@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "AlignedAllocator.hpp"
+#include "KeplerSolver.hpp"
+#include "ParticleSystem.hpp"
+
+// Outcome of one ensemble member, with the elements of bodies 1 .. n - 1 relative to body 0
+struct EnsembleSummary {
+    long member;
+    std::uint64_t seed;
+    double energy_start;
+    double energy_end;
+    std::vector<OrbitalElements> elements;
+
+    double relativeEnergyError() const;
+};
+
+// Seed of member k, spread with SplitMix64 so neighbouring members get unrelated streams
+std::uint64_t ensembleMemberSeed(std::uint64_t base_seed, long member);
+
+// Integrates many independent small systems with the same number of bodies by kick-drift-kick leapfrog.
+// Members are packed in batches laid out systems-by-bodies, component c of body i of lane s at
+// c[i * width + s], so every pair loop runs across the members of a batch in SIMD lanes. Each
+// OpenMP thread takes whole batches, so no thread ever waits on another inside a step.
+class EnsembleRunner {
+public:
+    using MemberFactory = std::function<ParticleSystem(std::uint64_t seed)>;
+    using SummarySink = std::function<void(const EnsembleSummary&)>;
+
+    // throws std::invalid_argument unless batch_width >= 1
+    EnsembleRunner(MemberFactory make_member, double dt, double epsilon = 0.0, int batch_width = 64);
+
+    // Run members 0 .. num_members - 1 for steps steps. sink is called once per member, one call at a
+    // time but in the order the batches finish. Throws std::invalid_argument if the members differ in size.
+    void run(long num_members, std::uint64_t base_seed, long steps, const SummarySink& sink) const;
+
+private:
+    MemberFactory make_member_;
+    double dt_;
+    double epsilon_;
+    int batch_width_;
+};
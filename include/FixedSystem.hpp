@@ -0,0 +1,177 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "ParticleSystem.hpp"
+#include "SolarSystemGenerator.hpp"
+
+// Calls f(std::integral_constant<int, k>()) for k = Begin .. End - 1, expanded at compile time
+template <int Begin, int End, class F>
+inline void unrolledFor(F&& f) {
+    if constexpr (Begin < End) {
+        f(std::integral_constant<int, Begin>());
+        unrolledFor<Begin + 1, End>(f);
+    }
+}
+
+// Masses stored with the state, for any system of N bodies
+template <int N>
+struct RuntimeMasses {
+    static constexpr bool kCompileTime = false;
+    std::array<double, N> m{};
+
+    double operator[](int i) const {
+        return m[i];
+    }
+};
+
+// Masses of the Sun and planets as compile-time constants, so the pair loops multiply by literals
+struct SolarMasses {
+    static constexpr bool kCompileTime = true;
+
+    constexpr double operator[](int i) const {
+        return kSolarMasses[i];
+    }
+};
+
+// State of a system of N bodies in fixed-size arrays, with its force and step kernels. Every pair loop
+// is unrolled at compile time and nothing touches the heap, so for the few bodies of a planetary
+// system the step costs the arithmetic alone. ax/ay/az must belong to the positions before a step,
+// see computeAccelerations, and belong to the new positions after it.
+template <int N, class Masses = RuntimeMasses<N>>
+struct FixedSystem {
+    static_assert(N >= 1, "A fixed system needs at least one body");
+
+    std::array<double, N> x{}, y{}, z{};
+    std::array<double, N> vx{}, vy{}, vz{};
+    std::array<double, N> ax{}, ay{}, az{};
+    Masses masses{};
+
+    // Copy the positions, velocities and, unless they are compile-time constants, masses of the first N bodies
+    void load(const ParticleSystem& system) {
+        for (int i = 0; i < N; i++) {
+            x[i] = system.x[i];
+            y[i] = system.y[i];
+            z[i] = system.z[i];
+            vx[i] = system.vx[i];
+            vy[i] = system.vy[i];
+            vz[i] = system.vz[i];
+            if constexpr (!Masses::kCompileTime) {
+                masses.m[i] = system.m[i];
+            }
+        }
+    }
+
+    // Copy the positions, velocities and accelerations back into a system of N bodies
+    void store(ParticleSystem& system) const {
+        for (int i = 0; i < N; i++) {
+            system.x[i] = x[i];
+            system.y[i] = y[i];
+            system.z[i] = z[i];
+            system.vx[i] = vx[i];
+            system.vy[i] = vy[i];
+            system.vz[i] = vz[i];
+            system.ax[i] = ax[i];
+            system.ay[i] = ay[i];
+            system.az[i] = az[i];
+        }
+    }
+
+    // Softened accelerations, each unordered pair once with equal and opposite contributions
+    void computeAccelerations(double epsilon2) {
+        ax.fill(0.0);
+        ay.fill(0.0);
+        az.fill(0.0);
+        unrolledFor<0, N>([&](auto i) {
+            unrolledFor<decltype(i)::value + 1, N>([&](auto j) {
+                const double dx = x[j] - x[i];
+                const double dy = y[j] - y[i];
+                const double dz = z[j] - z[i];
+                const double d2 = dx * dx + dy * dy + dz * dz;
+                const double r2 = d2 + epsilon2;
+                const double inv3 = d2 > 0.0 ? 1.0 / (r2 * std::sqrt(r2)) : 0.0;
+                const double wi = masses[j] * inv3;
+                const double wj = masses[i] * inv3;
+                ax[i] += wi * dx;
+                ay[i] += wi * dy;
+                az[i] += wi * dz;
+                ax[j] -= wj * dx;
+                ay[j] -= wj * dy;
+                az[j] -= wj * dz;
+            });
+        });
+    }
+
+    void kick(double h) {
+        for (int i = 0; i < N; i++) {
+            vx[i] += h * ax[i];
+            vy[i] += h * ay[i];
+            vz[i] += h * az[i];
+        }
+    }
+
+    void drift(double h) {
+        for (int i = 0; i < N; i++) {
+            x[i] += h * vx[i];
+            y[i] += h * vy[i];
+            z[i] += h * vz[i];
+        }
+    }
+
+    // Kick-drift-kick leapfrog, as LeapfrogIntegrator
+    void leapfrogStep(double dt, double epsilon2) {
+        kick(0.5 * dt);
+        drift(dt);
+        computeAccelerations(epsilon2);
+        kick(0.5 * dt);
+    }
+
+    // Yoshida (1990) triple jump of three leapfrog steps, as YoshidaIntegrator
+    void yoshidaStep(double dt, double epsilon2) {
+        constexpr double cbrt2 = 1.2599210498948731648;
+        constexpr double w1 = 1.0 / (2.0 - cbrt2);
+        constexpr double w0 = -cbrt2 / (2.0 - cbrt2);
+        kick(0.5 * w1 * dt);
+        drift(w1 * dt);
+        computeAccelerations(epsilon2);
+        kick(0.5 * (w1 + w0) * dt);
+        drift(w0 * dt);
+        computeAccelerations(epsilon2);
+        kick(0.5 * (w0 + w1) * dt);
+        drift(w1 * dt);
+        computeAccelerations(epsilon2);
+        kick(0.5 * w1 * dt);
+    }
+
+    // Softened total energy, kinetic plus -m_i m_j / sqrt(r^2 + epsilon^2) over the unordered pairs
+    double energy(double epsilon2) const {
+        double kinetic = 0.0, potential = 0.0;
+        unrolledFor<0, N>([&](auto i) {
+            kinetic += 0.5 * masses[i] * (vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+            unrolledFor<decltype(i)::value + 1, N>([&](auto j) {
+                const double dx = x[j] - x[i];
+                const double dy = y[j] - y[i];
+                const double dz = z[j] - z[i];
+                potential -= masses[i] * masses[j] / std::sqrt(dx * dx + dy * dy + dz * dz + epsilon2);
+            });
+        });
+        return kinetic + potential;
+    }
+};
+
+// Body counts with a FixedSystem specialisation behind advanceFixed
+constexpr int kMinFixedBodies = 2;
+constexpr int kMaxFixedBodies = 16;
+
+// true if advanceFixed can run a system of num_bodies bodies with the integrator of that name
+bool hasFixedKernel(std::size_t num_bodies, const std::string& integrator = "leapfrog");
+
+// Advance system by num_steps steps of "leapfrog" or "yoshida4" with the FixedSystem of its size,
+// chosen at runtime; the Solar system masses of SolarSystemGenerator select the compile-time mass
+// variant. Forces are computed afresh from the positions, so splitting a run into several calls
+// gives the same result as one call. ax/ay/az are left at the final positions.
+// Throws std::invalid_argument unless hasFixedKernel(system.size(), integrator).
+void advanceFixed(ParticleSystem& system, const std::string& integrator, double dt, long num_steps, double epsilon = 0.0);
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include "ParticleSystem.hpp"
+
+// Instruction sets the direct-summation kernel has been specialised for
+enum class SimdLevel { Scalar, AVX2, AVX512 };
+
+// Read-only view of the gravitating bodies a kernel sums over
+struct SourceArrays {
+    const double* x;
+    const double* y;
+    const double* z;
+    const double* m;
+    std::size_t count;
+};
+
+// Accumulates into acc[0..2] the acceleration at (px, py, pz) due to every source.
+// Sources at exactly the same position are skipped, which excludes the body itself.
+using PointKernel = void (*)(const SourceArrays& sources, double px, double py, double pz, double epsilon2, double* acc);
+
+// Adds to b[i] the pull of bodies begin .. end - 1 on body i and subtracts the equal and
+// opposite reaction from each of those bodies. Callers pass begin > i, so self is excluded by index.
+using PairRowKernel = void (*)(const SourceArrays& bodies, std::size_t i, std::size_t begin, std::size_t end, double epsilon2, double* bx, double* by, double* bz);
+
+// Single precision copy of the bodies for the mixed precision kernels, positions taken relative to a reference point
+struct SourceArraysFloat {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* m;
+    std::size_t count;
+};
+
+// Sources summed in single precision before the partial sum is added to the double precision total
+constexpr std::size_t kMixedTile = 128;
+
+// Same contract as PointKernel, with the pair terms in single precision from a fast inverse square root
+// (hardware estimate and one Newton step). The sum runs in float over tiles of kMixedTile sources
+// and in double across tiles, so its rounding error does not grow with the number of sources.
+using MixedPointKernel = void (*)(const SourceArraysFloat& sources, float px, float py, float pz, float epsilon2, double* acc);
+
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+PointKernel selectKernel(SimdLevel level);
+// Same sums, and acc[3] also receives sum m_j / sqrt(r^2 + epsilon^2), so acc needs four entries
+PointKernel selectPotentialKernel(SimdLevel level);
+PairRowKernel selectPairRowKernel(SimdLevel level);
+MixedPointKernel selectMixedKernel(SimdLevel level);
+// the massive bodies of system, the test particles are no sources
+SourceArrays sourceArrays(const ParticleSystem& system);
+
+// Overwrite ax/ay/az with the softened gravitational acceleration on every body
+void computeAccelerations(ParticleSystem& system, double epsilon = 0.0);
+void computeAccelerations(ParticleSystem& system, double epsilon, SimdLevel level);
+// Same, and store the softened potential -sum m_j / sqrt(r_ij^2 + epsilon^2) of every body in potential[i]
+void computeAccelerationsAndPotential(ParticleSystem& system, double epsilon, double* potential);
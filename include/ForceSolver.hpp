@@ -0,0 +1,93 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "ParticleSystem.hpp"
+
+// Side of the square tiles of the pair triangle, 3 reaction arrays and 4 source arrays of this length fit in L1
+constexpr int kPairTile = 256;
+
+// Settings shared by the gravity backends, filled from the command line
+struct SolverConfig {
+    std::string name = "direct";
+    double theta = 0.5;
+    bool quadrupole = false;
+    // "double", or "mixed" for the single precision pair terms of MixedPrecisionSolver
+    std::string precision = "double";
+    // side of the pair tiles of PairwiseSolver
+    int tile = kPairTile;
+    // bodies per Barnes-Hut leaf and per dynamically scheduled chunk of the tree walk
+    int leaf_size = 8;
+    int chunk = 64;
+};
+
+class ForceSolver {
+public:
+    virtual ~ForceSolver() = default;
+
+    // overwrite ax/ay/az of every body with its softened gravitational acceleration
+    virtual void computeAccelerations(ParticleSystem& system, double epsilon) = 0;
+
+    // overwrite ax/ay/az of the listed bodies, the others may keep their old value or be recomputed.
+    // The default evaluates every body, solvers that can do less override it.
+    virtual void computeActiveAccelerations(ParticleSystem& system, const std::vector<int>& active, double epsilon);
+
+    // allocate the workspace for systems of up to num_particles bodies ahead of the first evaluation
+    virtual void reserve(std::size_t num_particles);
+
+    // Ask for the potential of every body alongside the accelerations. Solvers that can produce it
+    // for free fill potential() and report potentialAvailable() after a full evaluation.
+    void setComputePotential(bool enable);
+    bool potentialAvailable() const;
+    // -sum m_j / sqrt(r_ij^2 + epsilon^2) of every body at the positions of the last evaluation
+    const AlignedVector& potential() const;
+
+protected:
+    bool compute_potential_ = false;
+    bool potential_available_ = false;
+    AlignedVector potential_;
+};
+
+// O(N^2) summation with the SIMD kernels from ForceKernel.hpp
+class DirectSolver : public ForceSolver {
+public:
+    void computeAccelerations(ParticleSystem& system, double epsilon) override;
+    void computeActiveAccelerations(ParticleSystem& system, const std::vector<int>& active, double epsilon) override;
+    void reserve(std::size_t num_particles) override;
+};
+
+// O(N^2) summation like DirectSolver, with the positions relative to the centre of the bounding box
+// and the masses copied to float before every evaluation. The pair terms are computed in single
+// precision, twice as many per SIMD register, and summed in double, see MixedPointKernel. It never
+// offers the potential, so the energy diagnostics keep using the double precision pair sum.
+class MixedPrecisionSolver : public ForceSolver {
+public:
+    void computeAccelerations(ParticleSystem& system, double epsilon) override;
+    void computeActiveAccelerations(ParticleSystem& system, const std::vector<int>& active, double epsilon) override;
+    void reserve(std::size_t num_particles) override;
+
+private:
+    void convert(const ParticleSystem& system);
+
+    AlignedFloatVector x_, y_, z_, m_;
+};
+
+// O(N^2/2) summation: every unordered pair of massive bodies is visited once and the equal and
+// opposite contributions go to per-thread buffers that are reduced at the end. Test particles are
+// summed over the massive bodies with the point kernel of DirectSolver.
+class PairwiseSolver : public ForceSolver {
+public:
+    // Throws std::invalid_argument unless tile >= 1
+    explicit PairwiseSolver(int tile = kPairTile);
+    void computeAccelerations(ParticleSystem& system, double epsilon) override;
+    void reserve(std::size_t num_particles) override;
+
+private:
+    int tile_;
+    std::vector<AlignedVector> buffers_;
+};
+
+// Throws std::invalid_argument for an unknown solver name or precision, and for mixed precision with another solver than direct
+std::unique_ptr<ForceSolver> makeForceSolver(const SolverConfig& config);
+
+void evolution_Solar_System(ParticleSystem& system, ForceSolver& solver, double dt, int time_steps, double epsilon = 0.0);
@@ -1,9 +1,17 @@
 #pragma once
 #include <vector>
 #include "particle.hpp"
+#include "ParticleSystem.hpp"
 
 class InitialConditionGenerator {
 public:
+    virtual ~InitialConditionGenerator() = default;
+
     // initial conditions for the simulation
     virtual std::vector<Particle> generateInitialConditions() = 0;
+
+    // initial conditions in structure-of-arrays layout, generators may override to fill the arrays directly
+    virtual ParticleSystem generateParticleSystem() {
+        return ParticleSystem(generateInitialConditions());
+    }
 };
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "AlignedAllocator.hpp"
+#include "ForceSolver.hpp"
+#include "ParticleSystem.hpp"
+
+class Integrator {
+public:
+    virtual ~Integrator() = default;
+
+    // advance every body of the system by one step of size dt
+    virtual void step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) = 0;
+
+    // short name of the scheme, the one makeIntegrator takes, recorded in checkpoints
+    virtual std::string name() const = 0;
+
+    // forget cached accelerations, must be called when positions or masses are changed between steps
+    virtual void reset();
+
+    // allocate the workspace for systems of up to num_particles bodies ahead of the first step
+    virtual void reserve(std::size_t num_particles);
+
+    // true if ax/ay/az and the solver's potential belong to the current positions of system
+    bool forcesCurrent(const ParticleSystem& system) const;
+
+    // Append what the integrator carries from one step to the next, beyond the arrays of system, for a checkpoint
+    virtual void saveState(const ParticleSystem& system, std::vector<double>& state) const;
+    // Take up a saved state again from state[pos], advancing pos. system must hold the arrays it was saved with.
+    // Throws std::invalid_argument if the state is too short.
+    virtual void restoreState(ParticleSystem& system, const ForceSolver& solver, double epsilon, const std::vector<double>& state, std::size_t& pos);
+
+    // number of force evaluations requested so far
+    long forceEvaluations() const;
+    // number of accelerations of single bodies computed so far
+    long bodyForceEvaluations() const;
+
+protected:
+    // v += h a and x += h v for every body
+    static void kick(ParticleSystem& system, double h);
+    static void drift(ParticleSystem& system, double h);
+
+    void computeForces(ParticleSystem& system, ForceSolver& solver, double epsilon);
+    void computeForces(ParticleSystem& system, const std::vector<int>& active, ForceSolver& solver, double epsilon);
+    // make sure ax/ay/az belong to the current positions, reusing the last evaluation of the previous step
+    void ensureForces(ParticleSystem& system, ForceSolver& solver, double epsilon);
+    // treat ax/ay/az of system as an evaluation by solver, for accelerations restored from a checkpoint
+    void adoptForces(const ParticleSystem& system, const ForceSolver& solver, double epsilon);
+
+    static void appendState(std::vector<double>& state, const AlignedVector& array);
+    static double readState(const std::vector<double>& state, std::size_t& pos);
+    static void readState(const std::vector<double>& state, std::size_t& pos, AlignedVector& array, std::size_t count);
+
+private:
+    const ParticleSystem* cached_system_ = nullptr;
+    const ForceSolver* cached_solver_ = nullptr;
+    std::size_t cached_size_ = 0;
+    double cached_epsilon_ = 0.0;
+    long force_evaluations_ = 0;
+    long body_force_evaluations_ = 0;
+};
+
+// First order explicit Euler, the scheme of Particle::update
+class EulerIntegrator : public Integrator {
+public:
+    void step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) override;
+    std::string name() const override;
+};
+
+// Second order kick-drift-kick leapfrog, one force evaluation per step
+class LeapfrogIntegrator : public Integrator {
+public:
+    void step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) override;
+    std::string name() const override;
+};
+
+// Second order velocity Verlet: x += v dt + a dt^2 / 2, v += (a + a') dt / 2, one force evaluation per step
+class VelocityVerletIntegrator : public Integrator {
+public:
+    void step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) override;
+    std::string name() const override;
+    void reserve(std::size_t num_particles) override;
+
+private:
+    AlignedVector old_ax_, old_ay_, old_az_;
+};
+
+// Fourth order Yoshida composition of three leapfrog steps, three force evaluations per step
+class YoshidaIntegrator : public Integrator {
+public:
+    void step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) override;
+    std::string name() const override;
+};
+
+// Throws std::invalid_argument for an unknown integrator name
+std::unique_ptr<Integrator> makeIntegrator(const std::string& name);
+
+void evolution_Solar_System(ParticleSystem& system, ForceSolver& solver, Integrator& integrator, double dt, int time_steps, double epsilon = 0.0);
@@ -0,0 +1,23 @@
+#pragma once
+
+// Stumpff functions c0..c3 of x, evaluated by series after reducing |x| below 0.1 with the
+// quadruple-angle formulas, so elliptic, parabolic and hyperbolic orbits share one code path
+void stumpff(double x, double* c);
+
+constexpr int kMaxKeplerHalvings = 40;
+
+// Advance a body on a two-body orbit by dt with Gauss' f and g functions in universal
+// variables. position and velocity are relative to the attracting mass mu and are updated
+// in place. Steps the Laguerre iteration cannot solve are split in half, at most kMaxKeplerHalvings
+// times deep. Throws std::runtime_error past that, e.g. for a body at the central mass or a NaN state.
+void keplerDrift(double mu, double dt, double* position, double* velocity);
+
+// Osculating semi-major axis, eccentricity and inclination to the x-y plane of a body relative to the
+// attracting mass mu. The semi-major axis is negative for hyperbolic orbits.
+struct OrbitalElements {
+    double semi_major_axis;
+    double eccentricity;
+    double inclination;
+};
+
+OrbitalElements orbitalElements(double mu, const double* position, const double* velocity);
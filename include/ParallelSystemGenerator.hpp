@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "InitialConditionGenerator.hpp"
+
+// Scale height of the thick disk relative to the distance from its centre
+constexpr double kDiskAspect = 0.05;
+// Plummer bodies are drawn out to this many scale radii
+constexpr double kPlummerCutoff = 10.0;
+
+// Initial conditions for millions of bodies, drawn in parallel straight into the particle arrays.
+// Body i takes its numbers from a Philox stream keyed by the seed with counter i, so the result is
+// bit-identical for any number of threads. Distributions:
+//   "disk"       a central unit mass and bodies on circular orbits in a plane, as RandomSystemGenerator
+//   "thick-disk" the same with gaussian heights and vertical velocities of relative size kDiskAspect
+//   "plummer"    a Plummer sphere of unit mass in equilibrium in Henon units (G = M = 1, E = -1/4),
+//                centre of mass at rest at the origin
+// Test particles follow the massive bodies, drawn from the same distribution with zero mass. Test
+// particle j takes its numbers from the stream keyed by seed + 1 with counter j, so adding them does
+// not change the massive bodies.
+class ParallelSystemGenerator : public InitialConditionGenerator {
+public:
+    // num_particles massive bodies and num_test test particles, throws std::invalid_argument for an unknown distribution
+    ParallelSystemGenerator(const std::string& distribution, std::size_t num_particles, std::uint64_t seed = 1, std::size_t num_test = 0);
+
+    std::vector<Particle> generateInitialConditions() override;
+    ParticleSystem generateParticleSystem() override;
+
+    static bool hasDistribution(const std::string& distribution);
+
+private:
+    enum class Distribution { Disk, ThickDisk, Plummer };
+
+    Distribution distribution_;
+    std::size_t num_particles_;
+    std::uint64_t seed_;
+    std::size_t num_test_;
+};
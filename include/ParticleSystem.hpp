@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <Eigen/Core>
+#include "AlignedAllocator.hpp"
+#include "particle.hpp"
+
+// Structure-of-arrays particle store. Every component lives in its own contiguous,
+// 64-byte aligned array so the force kernels can stream through them with SIMD loads.
+class ParticleSystem {
+public:
+    ParticleSystem() = default;
+    explicit ParticleSystem(std::size_t num_particles);
+    explicit ParticleSystem(const std::vector<Particle>& particles);
+
+    std::size_t size() const;
+    void resize(std::size_t num_particles);
+    // as resize, but the new bodies hold indeterminate values until written, so the threads that
+    // fill them in parallel are the first to touch their pages
+    void resizeForOverwrite(std::size_t num_particles);
+    void reserve(std::size_t num_particles);
+    // inserted after the last massive body, ahead of any test particles
+    void addParticle(double mass, const Eigen::Vector3d& position = Eigen::Vector3d::Zero(), const Eigen::Vector3d& velocity = Eigen::Vector3d::Zero());
+
+    // Bodies 0 .. numMassive() - 1 are the sources of gravity. The rest are test particles: they have
+    // zero mass and feel the massive bodies but not each other, so a force evaluation costs
+    // O(numMassive() x size()). Without test particles numMassive() == size().
+    std::size_t numMassive() const;
+    std::size_t numTest() const;
+    // appended as a massless body after all others
+    void addTestParticle(const Eigen::Vector3d& position, const Eigen::Vector3d& velocity = Eigen::Vector3d::Zero());
+    // Make bodies num_massive .. size() - 1 test particles.
+    // Throws std::invalid_argument if num_massive > size() or one of those bodies has mass.
+    void setNumMassive(std::size_t num_massive);
+    // Remove every body i with remove[i] != 0, keeping the order of the others.
+    // Throws std::invalid_argument unless remove has one flag per body.
+    void removeParticles(const std::vector<char>& remove);
+
+    Eigen::Vector3d getPosition(std::size_t i) const;
+    Eigen::Vector3d getVelocity(std::size_t i) const;
+    Eigen::Vector3d getAcceleration(std::size_t i) const;
+    double getMass(std::size_t i) const;
+    Particle getParticle(std::size_t i) const;
+    std::vector<Particle> toParticles() const;
+
+    // Positions, velocities, accelerations and masses, indexed by particle
+    AlignedVector x, y, z;
+    AlignedVector vx, vy, vz;
+    AlignedVector ax, ay, az;
+    AlignedVector m;
+
+private:
+    // every body is massive until test particles are added, also when the arrays are resized directly
+    static constexpr std::size_t kAllMassive = static_cast<std::size_t>(-1);
+    std::size_t num_massive_ = kAllMassive;
+};
+
+void evolution_Solar_System(ParticleSystem& system, double dt, int time_steps, double epsilon = 0.0);
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include "ParticleSystem.hpp"
+
+// true if advancePersistent can run the integrator of that name, "euler" or "leapfrog"
+bool hasPersistentKernel(const std::string& integrator);
+
+// Advance system by num_steps steps of "euler" or "leapfrog" with direct summation inside a single
+// OpenMP parallel region. Each thread owns a contiguous block of bodies for the whole run: it
+// first-touches that block's copy of the arrays, so with bound threads (OMP_PROC_BIND=close) the
+// pages of a block live on the socket of the thread that updates them. The update of a body is fused
+// into the tail of its force sweep, and the new positions go to a second buffer, so every step costs
+// one pass over the bodies and one barrier instead of a fork/join per phase. Gives the same result,
+// bit for bit, as the same integrator with DirectSolver in Simulation. ax/ay/az are left at the
+// final positions for leapfrog and at the positions before the last step for euler, as the
+// integrators leave them. Throws std::invalid_argument unless hasPersistentKernel(integrator).
+void advancePersistent(ParticleSystem& system, const std::string& integrator, double dt, long num_steps, double epsilon = 0.0);
@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+using PhiloxBlock = std::array<std::uint32_t, 4>;
+
+// Philox4x32-10 (Salmon et al. 2011), 128 random bits that are a pure function of a 128-bit counter
+// and a 64-bit key. Nothing is carried from one call to the next, so the numbers of any counter can
+// be drawn on any thread in any order and are the same integers on every machine.
+inline PhiloxBlock philox4x32(PhiloxBlock counter, std::uint64_t key) {
+    constexpr std::uint64_t kMultiplier0 = 0xD2511F53;
+    constexpr std::uint64_t kMultiplier1 = 0xCD9E8D57;
+    constexpr std::uint32_t kWeyl0 = 0x9E3779B9;
+    constexpr std::uint32_t kWeyl1 = 0xBB67AE85;
+    std::uint32_t k0 = static_cast<std::uint32_t>(key);
+    std::uint32_t k1 = static_cast<std::uint32_t>(key >> 32);
+    for (int round = 0; round < 10; round++) {
+        const std::uint64_t product0 = kMultiplier0 * counter[0];
+        const std::uint64_t product1 = kMultiplier1 * counter[2];
+        counter = {static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ k0, static_cast<std::uint32_t>(product1),
+                   static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ k1, static_cast<std::uint32_t>(product0)};
+        k0 += kWeyl0;
+        k1 += kWeyl1;
+    }
+    return counter;
+}
+
+// Uniform double in (0, 1) from 64 random bits, never 0 or 1 so it can go into log and pow
+inline double uniformOpen(std::uint32_t high, std::uint32_t low) {
+    const std::uint64_t bits = ((static_cast<std::uint64_t>(high) << 32) | low) >> 11;
+    return (static_cast<double>(bits) + 0.5) * 0x1.0p-53;
+}
+
+// The uniforms of one item, e.g. one body: block k of the stream is philox4x32({item, k}, key).
+// Streams of different items never overlap, however many numbers each one draws.
+class PhiloxStream {
+public:
+    PhiloxStream(std::uint64_t key, std::uint64_t item) :
+        key_(key), counter_{static_cast<std::uint32_t>(item), static_cast<std::uint32_t>(item >> 32), 0, 0} {}
+
+    double uniform() {
+        if (used_ == 2) {
+            block_ = philox4x32(counter_, key_);
+            if (++counter_[2] == 0) {
+                counter_[3]++;
+            }
+            used_ = 0;
+        }
+        const double u = uniformOpen(block_[2 * used_], block_[2 * used_ + 1]);
+        used_++;
+        return u;
+    }
+
+private:
+    std::uint64_t key_;
+    PhiloxBlock counter_;
+    PhiloxBlock block_{};
+    int used_ = 2;
+};
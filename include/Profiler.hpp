@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Phases timed by the profiler. The *Loop phases are timed by every thread of an OpenMP loop
+// separately, up to the point where it runs out of work, so their spread measures load imbalance.
+enum class ProfilePhase {
+    Force,
+    TreeBuild,
+    ForceLoop,
+    Kick,
+    Drift,
+    Kepler,
+    Diagnostics,
+    DiagnosticsLoop,
+    Output,
+    Checkpoint,
+    Encounters,
+    Subcycle,
+    Count
+};
+
+enum class ProfileCounter {
+    PairInteractions,
+    NodeVisits,
+    Count
+};
+
+// Per-thread phase times and counters, recorded while enabled. Timestamps come from the TSC on
+// x86-64 and from steady_clock elsewhere; the TSC rate is calibrated against steady_clock over the
+// profiled interval. Threads are told apart by their OpenMP thread number.
+class Profiler {
+public:
+    static constexpr int kMaxThreads = 256;
+
+    // true if the library was built with NBODY_PROFILING, otherwise the macros below record nothing
+    static bool compiledIn();
+
+    // clear all records and start profiling, with trace events for writeChromeTrace if trace is set
+    static void enable(bool trace = false);
+    static void disable();
+    static bool enabled() {
+        return enabled_;
+    }
+
+    static std::uint64_t now();
+    static void record(ProfilePhase phase, std::uint64_t start, std::uint64_t end);
+    static void count(ProfileCounter counter, std::uint64_t amount);
+
+    // totals over all threads since enable()
+    static std::uint64_t calls(ProfilePhase phase);
+    static std::uint64_t total(ProfileCounter counter);
+
+    // Calls, time and spread over the threads of every phase, and the counters with their rates
+    static void printSummary(std::ostream& out);
+    // Trace-event JSON for chrome://tracing or Perfetto. Throws std::runtime_error if the file cannot be written.
+    static void writeChromeTrace(const std::string& path);
+
+private:
+    inline static bool enabled_ = false;
+};
+
+// Times the enclosing scope as one call of phase on the calling thread
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePhase phase) : phase_(phase), active_(Profiler::enabled()) {
+        if (active_) {
+            start_ = Profiler::now();
+        }
+    }
+    ~ProfileScope() {
+        if (active_) {
+            Profiler::record(phase_, start_, Profiler::now());
+        }
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfilePhase phase_;
+    bool active_;
+    std::uint64_t start_ = 0;
+};
+
+#define NBODY_PROFILE_CONCAT_(a, b) a##b
+#define NBODY_PROFILE_CONCAT(a, b) NBODY_PROFILE_CONCAT_(a, b)
+
+#ifdef NBODY_PROFILING
+#define PROFILE_SCOPE(phase) ProfileScope NBODY_PROFILE_CONCAT(profile_scope_, __LINE__)(ProfilePhase::phase)
+#define PROFILE_COUNT(counter, amount) \
+    do { \
+        if (Profiler::enabled()) { \
+            Profiler::count(ProfileCounter::counter, amount); \
+        } \
+    } while (0)
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#endif
@@ -4,8 +4,12 @@
 class RandomSystemGenerator : public InitialConditionGenerator {
 public:
     std::vector<Particle> generateInitialConditions() override;
-    explicit RandomSystemGenerator(int num_particles);
+    ParticleSystem generateParticleSystem() override;
+    // num_particles massive bodies, followed by num_test test particles on circular orbits drawn from
+    // the same distance and angle distributions, from a stream of their own so the massive bodies do not change
+    explicit RandomSystemGenerator(int num_particles, int num_test = 0);
     
 private:
     int num_particles_;
+    int num_test_;
 };
\ No newline at end of file
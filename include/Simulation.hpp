@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <Eigen/Core>
+#include "Checkpoint.hpp"
+#include "Diagnostics.hpp"
+#include "ForceSolver.hpp"
+#include "Integrator.hpp"
+#include "ParticleSystem.hpp"
+
+// Read-only view of one vector quantity of every body, pointing straight into the arrays of a ParticleSystem
+struct VectorView {
+    const double* x;
+    const double* y;
+    const double* z;
+    std::size_t count;
+
+    Eigen::Vector3d operator[](std::size_t i) const {
+        return Eigen::Vector3d(x[i], y[i], z[i]);
+    }
+};
+
+// A run that owns its particles, solver and integrator and can be advanced a little at a time.
+// The workspaces are allocated in the constructor, so stepping does not touch the heap.
+class Simulation {
+public:
+    Simulation(ParticleSystem system, std::unique_ptr<ForceSolver> solver, std::unique_ptr<Integrator> integrator, double dt, double epsilon = 0.0);
+
+    void step();
+    void advance(long num_steps);
+    // take whole steps until time() reaches t, the last step is not shortened
+    void advance_until(double t);
+
+    double time() const;
+    long steps() const;
+    double timestep() const;
+    std::size_t size() const;
+
+    VectorView positions() const;
+    VectorView velocities() const;
+    const ParticleSystem& system() const;
+    const Integrator& integrator() const;
+
+    // Let the force solver return the potential with the accelerations, so diagnostics() can skip its pair sum
+    void setComputePotential(bool enable);
+    // Energy, momenta and centre of mass of the current state, softened with the simulation's epsilon
+    Diagnostics diagnostics() const;
+
+    // Save the particle arrays, step count and integrator state, see writeCheckpoint
+    void writeCheckpoint(const std::string& path) const;
+    // Continue from a checkpoint written by a simulation with the same integrator, timestep and softening.
+    // Throws std::invalid_argument if the timestep, softening, integrator or integrator state do not match.
+    void restore(const Checkpoint& checkpoint);
+
+private:
+    ParticleSystem system_;
+    std::unique_ptr<ForceSolver> solver_;
+    std::unique_ptr<Integrator> integrator_;
+    double dt_;
+    double epsilon_;
+    long steps_ = 0;
+};
@@ -1,7 +1,32 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <random>
 #include "InitialConditionGenerator.hpp"
 
+// Masses in solar masses and circular orbit radii in au of the Sun and the eight planets
+constexpr int kSolarBodies = 9;
+constexpr std::array<double, kSolarBodies> kSolarMasses = {1., 1. / 6023600, 1. / 408524, 1. / 332946.038, 1. / 3098710, 1. / 1047.55, 1. / 3499, 1. / 22962, 1. / 19352};
+constexpr std::array<double, kSolarBodies> kSolarDistances = {0.0, 0.4, 0.7, 1, 1.5, 5.2, 9.5, 19.2, 30.1};
+// Main asteroid belt in au
+constexpr double kBeltInner = 2.1;
+constexpr double kBeltOuter = 3.3;
+
 class SolarSystemGenerator : public InitialConditionGenerator {
 public:
+    // planet phases from std::rand
+    SolarSystemGenerator() = default;
+    // planet phases from an engine of its own, so members of an ensemble do not share a random stream
+    explicit SolarSystemGenerator(std::uint64_t seed);
+    // and num_asteroids test particles on circular orbits between kBeltInner and kBeltOuter
+    SolarSystemGenerator(std::uint64_t seed, int num_asteroids);
+
     std::vector<Particle> generateInitialConditions() override;
-};
\ No newline at end of file
+    // the Sun and planets massive, the asteroids test particles
+    ParticleSystem generateParticleSystem() override;
+
+private:
+    bool seeded_ = false;
+    int num_asteroids_ = 0;
+    std::mt19937_64 engine_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ParticleSystem.hpp"
+
+// Binary trajectory file, all values little-endian:
+//   header   TrajectoryHeader (40 bytes)
+//   masses   num_bodies doubles
+//   frames   double time, int64 step, then x, y, z and, with velocities, vx, vy, vz, num_bodies doubles each
+//   index    num_frames uint64 byte offsets of the frames, written when the file is closed
+// Every block is a multiple of 8 bytes long, so a mapped file can be read as doubles in place.
+struct TrajectoryHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint64_t num_bodies;
+    std::uint64_t num_frames;
+    std::uint64_t index_offset;
+};
+
+constexpr std::uint32_t kTrajectoryVersion = 1;
+constexpr std::uint32_t kTrajectoryVelocities = 1;
+
+// Snapshots are copied into one of two frame buffers and written by a background thread, so the
+// caller only waits when the thread is still busy with the frame before the previous one.
+class TrajectoryWriter {
+public:
+    // Creates path, or with resume_after >= 0 continues the trajectory in path after a restart from
+    // step resume_after: its frames up to that step are kept and those written after it are dropped.
+    // Throws std::runtime_error if the file cannot be created, or cannot be continued because it is not
+    // a trajectory of as many bodies with the same choice of velocities.
+    TrajectoryWriter(const std::string& path, const ParticleSystem& system, bool velocities = true, long resume_after = -1);
+    ~TrajectoryWriter();
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    void write(const ParticleSystem& system, double time, long step);
+    // wait for the queued frames, then write the index and the final header. Throws std::runtime_error on I/O errors.
+    void close();
+
+    // frames handed to write(), the writer thread may still hold up to two of them until close() returns
+    std::size_t framesQueued() const;
+
+private:
+    void run();
+    void writeHeader();
+
+    std::FILE* file_ = nullptr;
+    TrajectoryHeader header_;
+    std::size_t frame_doubles_;
+
+    // buffers_[k] holds a frame waiting for the writer when full_[k] is set
+    std::vector<double> buffers_[2];
+    bool full_[2] = {false, false};
+    int fill_ = 0;
+    int drain_ = 0;
+    bool closing_ = false;
+    bool failed_ = false;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::thread thread_;
+
+    std::size_t frames_queued_ = 0;
+    std::vector<std::uint64_t> offsets_;
+    std::uint64_t next_offset_;
+};
+
+// One frame of a mapped trajectory. vx, vy and vz are null if the file has no velocities.
+struct TrajectoryFrame {
+    double time;
+    long step;
+    const double* x;
+    const double* y;
+    const double* z;
+    const double* vx;
+    const double* vy;
+    const double* vz;
+};
+
+// Maps a trajectory file read-only and hands out frames that point into the mapping. A file
+// whose writer never closed it has no index; its complete frames are still found by their size.
+class TrajectoryReader {
+public:
+    // throws std::runtime_error if the file cannot be mapped or is not a trajectory
+    explicit TrajectoryReader(const std::string& path);
+    ~TrajectoryReader();
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    std::size_t numBodies() const;
+    std::size_t numFrames() const;
+    bool hasVelocities() const;
+    const double* masses() const;
+    // throws std::out_of_range for k >= numFrames()
+    TrajectoryFrame frame(std::size_t k) const;
+
+private:
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    TrajectoryHeader header_;
+    std::vector<std::uint64_t> offsets_;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// Message passing between the ranks of a distributed run, kept to what the ring algorithms need so
+// that an interconnect such as MPI (MPI_Sendrecv, MPI_Barrier) can stand in for the shared memory one
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual int rank() const = 0;
+    virtual int numRanks() const = 0;
+
+    // Ring step: send count doubles to rank + 1 and receive into receive what rank - 1 sent, returning
+    // its length. Every rank must call it the same number of times. receive may not alias send.
+    virtual std::size_t shift(const double* send, std::size_t count, double* receive) = 0;
+    // wait until every rank has arrived
+    virtual void barrier() = 0;
+    // largest message shift can carry, in doubles
+    virtual std::size_t capacity() const = 0;
+};
+
+// Ranks at most in one shared memory run
+constexpr int kMaxLocalRanks = 256;
+
+// Run worker in num_ranks processes on this machine: this process as rank 0 and num_ranks - 1 forked
+// children, connected by a ring of double-buffered mailboxes of capacity doubles in an anonymous shared
+// mapping. Children run their worker and exit, so only rank 0 returns with its results. If any rank
+// throws or dies, the others stop at their next transport call and this throws std::runtime_error
+// instead of waiting forever. The children must not open OpenMP parallel regions, the runtime's
+// threads are not carried over by fork.
+// Throws std::invalid_argument unless 1 <= num_ranks <= kMaxLocalRanks.
+void runLocalRanks(int num_ranks, std::size_t capacity, const std::function<void(Transport&)>& worker);
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include "Integrator.hpp"
+#include "ParticleSystem.hpp"
+
+// Second order Wisdom-Holman map in democratic heliocentric coordinates for systems dominated by
+// body 0. Each body follows its analytic Kepler orbit around the central mass, and only the
+// interactions between the other bodies are computed by the force solver.
+// If the Kepler drift of a body fails, step() throws std::runtime_error and leaves the system as it
+// was at the start of the step.
+class WisdomHolmanIntegrator : public Integrator {
+public:
+    void step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) override;
+    std::string name() const override;
+    void reset() override;
+    void reserve(std::size_t num_particles) override;
+    void saveState(const ParticleSystem& system, std::vector<double>& state) const override;
+    void restoreState(ParticleSystem& system, const ForceSolver& solver, double epsilon, const std::vector<double>& state, std::size_t& pos) override;
+
+private:
+    void toDemocraticHeliocentric(const ParticleSystem& system);
+    void toInertial(ParticleSystem& system) const;
+    void jump(double h);
+    void keplerStep(double h);
+
+    // heliocentric positions and barycentric velocities of bodies 1 .. n - 1
+    ParticleSystem bodies_;
+    double central_mass_ = 0.0;
+    double total_mass_ = 0.0;
+    double com_[3] = {0.0, 0.0, 0.0};
+    double com_velocity_[3] = {0.0, 0.0, 0.0};
+    const ParticleSystem* state_for_ = nullptr;
+};
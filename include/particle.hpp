@@ -21,9 +21,10 @@ class Particle {
 
 Eigen::Vector3d calcAcceleration(const Particle& i, const Particle& j, double epsilon = 0.0);
 Eigen::Vector3d calcTotalAcceleration(const Particle& particle, const std::vector<Particle>& particles, double epsilon = 0.0);
+Eigen::Vector3d calcTotalAcceleration(std::size_t index, const std::vector<Particle>& particles, double epsilon = 0.0);
 std::vector<Particle> initial_condition_generator();
 std::vector<Particle> evolution_Solar_System(std::vector<Particle> particles, double dt, int time_steps, double epsilon = 0.0);
-double getEnergy(Particle particle, std::vector<Particle> particles);
-double totalEnergy(std::vector<Particle> particles);
+double getEnergy(const Particle& particle, const std::vector<Particle>& particles);
+double totalEnergy(const std::vector<Particle>& particles);
 
 #endif
\ No newline at end of file
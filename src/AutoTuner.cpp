@@ -0,0 +1,260 @@
+#include "AutoTuner.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <omp.h>
+#include "ForceKernel.hpp"
+
+namespace {
+
+// Every candidate is evaluated once to allocate its buffers, then repeated for at least this long
+constexpr double kMinCalibrationSeconds = 0.02;
+
+constexpr int kPairTiles[] = {64, 128, 256, 512};
+constexpr int kLeafSizes[] = {8, 16, 32, 64, 128};
+constexpr int kChunks[] = {16, 64, 256, 1024};
+
+// A solver configuration with the system it is timed on and the factor from there to the whole system
+struct Candidate {
+    SolverConfig config;
+    const ParticleSystem* system;
+    double scale;
+    double seconds = 0.0;
+};
+
+// Function to copy the first count bodies of system, keeping its massive bodies ahead of its test particles.
+// Only the prefix is copied, a calibration of a huge system must not hold copies of all of it.
+ParticleSystem prefix(const ParticleSystem& system, std::size_t count) {
+    count = std::min(count, system.size());
+    ParticleSystem copy;
+    const AlignedVector* from[10] = {&system.x, &system.y, &system.z, &system.vx, &system.vy, &system.vz, &system.ax, &system.ay, &system.az, &system.m};
+    AlignedVector* to[10] = {&copy.x, &copy.y, &copy.z, &copy.vx, &copy.vy, &copy.vz, &copy.ax, &copy.ay, &copy.az, &copy.m};
+    for (int c = 0; c < 10; c++) {
+        to[c]->assign(from[c]->begin(), from[c]->begin() + count);
+    }
+    copy.setNumMassive(std::min(count, system.numMassive()));
+    return copy;
+}
+
+// Function to return the mean seconds of one force evaluation of candidate, scaled to the whole system
+double timeCandidate(const Candidate& candidate, double epsilon) {
+    ParticleSystem system = *candidate.system;
+    std::unique_ptr<ForceSolver> solver = makeForceSolver(candidate.config);
+    solver->computeAccelerations(system, epsilon);
+    const auto start = std::chrono::steady_clock::now();
+    int evaluations = 0;
+    double elapsed = 0.0;
+    do {
+        solver->computeAccelerations(system, epsilon);
+        evaluations++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < kMinCalibrationSeconds);
+    return candidate.scale * elapsed / evaluations;
+}
+
+// Function to time the candidates that have no time yet and return the fastest
+Candidate fastest(std::vector<Candidate> candidates, double epsilon) {
+    for (Candidate& candidate : candidates) {
+        if (candidate.seconds == 0.0) {
+            candidate.seconds = timeCandidate(candidate, epsilon);
+        }
+    }
+    return *std::min_element(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.seconds < b.seconds;
+    });
+}
+
+// Function to replace the whitespace of a string by underscores, so it is one field of a cache line
+std::string oneField(std::string text) {
+    std::replace_if(text.begin(), text.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }, '_');
+    return text;
+}
+
+}
+
+std::string describeChoice(const TuningChoice& choice) {
+    std::ostringstream out;
+    out << choice.solver.name;
+    if (choice.solver.name == "pairwise") {
+        out << " (tile " << choice.solver.tile << ")";
+    }
+    else if (choice.solver.name == "bh") {
+        out << " (theta " << choice.solver.theta << (choice.solver.quadrupole ? ", quadrupole" : "") << ", leaf " << choice.solver.leaf_size << ", chunk " << choice.solver.chunk << ")";
+    }
+    out << ", " << choice.threads << (choice.threads == 1 ? " thread, " : " threads, ") << choice.seconds * 1e3 << " ms per force evaluation";
+    return out.str();
+}
+
+AutoTuner::AutoTuner(std::string cache_path) : cache_path_(std::move(cache_path)) {}
+
+bool AutoTuner::calibrated() const {
+    return calibrated_;
+}
+
+int AutoTuner::band(std::size_t n) {
+    int b = 0;
+    while (n > 1) {
+        n >>= 1;
+        b++;
+    }
+    return b;
+}
+
+std::string AutoTuner::hostKey() {
+    std::string model = "unknown";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos) {
+            model = line.substr(line.find(':') + 1);
+            model.erase(0, model.find_first_not_of(" \t"));
+            break;
+        }
+    }
+    return oneField(model) + "/" + std::to_string(omp_get_num_procs()) + "/" + simdLevelName(detectSimdLevel());
+}
+
+// The O(N^2) solvers cost about numMassive() * size() pair terms and the tree size() log size()
+// interactions, which scales the times measured on a prefix up to the whole system.
+TuningChoice AutoTuner::calibrate(const ParticleSystem& system, double epsilon, const SolverConfig& base, int max_threads) {
+    if (base.precision != "double") {
+        throw std::invalid_argument("The auto-tuner chooses among the double precision solvers, not '" + base.precision + "'");
+    }
+    const ParticleSystem direct_system = prefix(system, kMaxDirectCalibrationBodies);
+    const ParticleSystem tree_system = prefix(system, kMaxTreeCalibrationBodies);
+    const double pairs = static_cast<double>(system.numMassive()) * system.size();
+    const double direct_pairs = static_cast<double>(direct_system.numMassive()) * direct_system.size();
+    const double direct_scale = direct_pairs > 0.0 ? pairs / direct_pairs : 1.0;
+    auto interactions = [](std::size_t n) {
+        return n * std::log2(std::max<std::size_t>(n, 2));
+    };
+    const double tree_scale = interactions(system.size()) / interactions(std::max<std::size_t>(tree_system.size(), 1));
+
+    const int threads_before = omp_get_max_threads();
+    omp_set_num_threads(max_threads);
+    std::vector<Candidate> best;
+    SolverConfig config = base;
+    config.name = "direct";
+    best.push_back(fastest({{config, &direct_system, direct_scale}}, epsilon));
+
+    std::vector<Candidate> tiles;
+    config.name = "pairwise";
+    for (int tile : kPairTiles) {
+        config.tile = tile;
+        tiles.push_back({config, &direct_system, direct_scale});
+    }
+    best.push_back(fastest(tiles, epsilon));
+
+    // the leaf size first, then the chunk for the fastest leaf
+    std::vector<Candidate> leaves;
+    config = base;
+    config.name = "bh";
+    for (int leaf_size : kLeafSizes) {
+        config.leaf_size = leaf_size;
+        leaves.push_back({config, &tree_system, tree_scale});
+    }
+    Candidate tree = fastest(leaves, epsilon);
+    std::vector<Candidate> chunks = {tree};
+    for (int chunk : kChunks) {
+        if (chunk != tree.config.chunk) {
+            config = tree.config;
+            config.chunk = chunk;
+            chunks.push_back({config, &tree_system, tree_scale});
+        }
+    }
+    best.push_back(fastest(chunks, epsilon));
+
+    TuningChoice choice;
+    choice.seconds = INFINITY;
+    std::vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+    for (int threads : thread_counts) {
+        omp_set_num_threads(threads);
+        for (Candidate& candidate : best) {
+            // the full thread count was timed already
+            const double seconds = threads == max_threads ? candidate.seconds : timeCandidate(candidate, epsilon);
+            if (seconds < choice.seconds) {
+                choice.solver = candidate.config;
+                choice.threads = threads;
+                choice.seconds = seconds;
+            }
+        }
+    }
+    omp_set_num_threads(threads_before);
+    return choice;
+}
+
+TuningChoice AutoTuner::tune(const ParticleSystem& system, double epsilon, const SolverConfig& base) {
+    if (base.precision != "double") {
+        throw std::invalid_argument("The auto-tuner chooses among the double precision solvers, not '" + base.precision + "'");
+    }
+    CacheKey key;
+    key.host = hostKey();
+    key.band = band(std::max<std::size_t>(system.size(), 1));
+    key.massive_band = band(std::max<std::size_t>(system.numMassive(), 1));
+    key.max_threads = omp_get_max_threads();
+    TuningChoice choice;
+    calibrated_ = !findEntry(key, base, choice);
+    if (calibrated_) {
+        choice = calibrate(system, epsilon, base, key.max_threads);
+        appendEntry(key, choice);
+    }
+    // a hand-edited cache may name more threads than this run has
+    choice.threads = std::min(choice.threads, key.max_threads);
+    return choice;
+}
+
+bool AutoTuner::findEntry(const CacheKey& key, const SolverConfig& base, TuningChoice& choice) const {
+    std::ifstream in(cache_path_);
+    if (!in) {
+        return false;
+    }
+    bool found = false;
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        CacheKey entry_key;
+        TuningChoice entry;
+        entry.solver = base;
+        if (!(fields >> entry_key.host >> entry_key.band >> entry_key.massive_band >> entry_key.max_threads >> entry.solver.theta >> entry.solver.quadrupole >> entry.solver.name >> entry.solver.tile >> entry.solver.leaf_size >> entry.solver.chunk >> entry.threads >> entry.seconds)
+            || entry.threads < 1) {
+            throw std::runtime_error("Line " + std::to_string(number) + " of the tuning cache '" + cache_path_ + "' is malformed");
+        }
+        if (entry_key.host == key.host && entry_key.band == key.band && entry_key.massive_band == key.massive_band && entry_key.max_threads == key.max_threads
+            && entry.solver.theta == base.theta && entry.solver.quadrupole == base.quadrupole) {
+            choice = entry;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void AutoTuner::appendEntry(const CacheKey& key, const TuningChoice& choice) const {
+    const bool exists = static_cast<bool>(std::ifstream(cache_path_));
+    std::ofstream out(cache_path_, std::ios::app);
+    if (!out) {
+        throw std::runtime_error("Cannot write the tuning cache '" + cache_path_ + "'");
+    }
+    out.precision(17);
+    if (!exists) {
+        out << "# host band massive_band max_threads theta quadrupole solver tile leaf_size chunk threads seconds\n";
+    }
+    out << key.host << " " << key.band << " " << key.massive_band << " " << key.max_threads << " " << choice.solver.theta << " " << choice.solver.quadrupole << " " << choice.solver.name << " " << choice.solver.tile << " "
+        << choice.solver.leaf_size << " " << choice.solver.chunk << " " << choice.threads << " " << choice.seconds << "\n";
+    if (!out.flush()) {
+        throw std::runtime_error("Writing the tuning cache '" + cache_path_ + "' failed");
+    }
+}
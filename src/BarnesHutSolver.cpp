@@ -0,0 +1,440 @@
+#include "BarnesHutSolver.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "ForceKernel.hpp"
+#include "Profiler.hpp"
+
+namespace {
+
+// Morton keys use 21 bits per axis, so a cell can be split at most this many times
+constexpr int kMaxLevel = 21;
+
+// Spread the low 21 bits of v so that there are two zero bits between each of them
+std::uint64_t spreadBits(std::uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+std::uint64_t mortonKey(std::uint64_t ix, std::uint64_t iy, std::uint64_t iz) {
+    return spreadBits(ix) << 2 | spreadBits(iy) << 1 | spreadBits(iz);
+}
+
+bool isLeaf(const BarnesHutSolver::Node& node, int leaf_size) {
+    return node.end - node.begin <= static_cast<std::uint32_t>(leaf_size) || node.level == kMaxLevel;
+}
+
+}
+
+BarnesHutSolver::BarnesHutSolver(double theta, bool quadrupole, int leaf_size, int chunk) :
+    theta_(theta), quadrupole_(quadrupole), leaf_size_(leaf_size), chunk_(chunk)
+{
+    if (leaf_size < 1 || chunk < 1) {
+        throw std::invalid_argument("A Barnes-Hut leaf and a chunk of the tree walk need at least one body");
+    }
+}
+
+std::size_t BarnesHutSolver::nodeCount() const {
+    return nodes_.size();
+}
+
+void BarnesHutSolver::reserve(std::size_t num_particles) {
+    keys_.reserve(num_particles);
+    keys_tmp_.reserve(num_particles);
+    order_.reserve(num_particles);
+    order_tmp_.reserve(num_particles);
+    rank_.reserve(num_particles);
+    x_.reserve(num_particles);
+    y_.reserve(num_particles);
+    z_.reserve(num_particles);
+    m_.reserve(num_particles);
+    nodes_.reserve(num_particles + 1);
+    level_begin_.reserve(kMaxLevel + 2);
+    child_offsets_.reserve(num_particles + 1);
+}
+
+void BarnesHutSolver::computeAccelerations(ParticleSystem& system, double epsilon) {
+    const int n = static_cast<int>(system.size());
+    if (n == 0) {
+        return;
+    }
+
+    {
+        PROFILE_SCOPE(TreeBuild);
+        sortBodies(system);
+        buildTree();
+        computeMoments();
+    }
+
+    const double epsilon2 = epsilon * epsilon;
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE(ForceLoop);
+        #pragma omp for schedule(dynamic, chunk_) nowait
+        for (int i = 0; i < n; i++) {
+            double acc[3];
+            walk(i, epsilon2, acc);
+            const std::uint32_t k = order_[i];
+            system.ax[k] = acc[0];
+            system.ay[k] = acc[1];
+            system.az[k] = acc[2];
+        }
+    }
+}
+
+void BarnesHutSolver::computeActiveAccelerations(ParticleSystem& system, const std::vector<int>& active, double epsilon) {
+    const int n = static_cast<int>(system.size());
+    if (n == 0) {
+        return;
+    }
+
+    {
+        PROFILE_SCOPE(TreeBuild);
+        sortBodies(system);
+        buildTree();
+        computeMoments();
+
+        rank_.resize(n);
+        #pragma omp parallel for
+        for (int i = 0; i < n; i++) {
+            rank_[order_[i]] = i;
+        }
+    }
+
+    const double epsilon2 = epsilon * epsilon;
+    const int num_active = static_cast<int>(active.size());
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE(ForceLoop);
+        #pragma omp for schedule(dynamic, chunk_) nowait
+        for (int k = 0; k < num_active; k++) {
+            const int i = active[k];
+            double acc[3];
+            walk(rank_[i], epsilon2, acc);
+            system.ax[i] = acc[0];
+            system.ay[i] = acc[1];
+            system.az[i] = acc[2];
+        }
+    }
+}
+
+// Function to compute the bounding cube and sort the bodies along the Morton curve
+void BarnesHutSolver::sortBodies(const ParticleSystem& system) {
+    const int n = static_cast<int>(system.size());
+    const double* x = system.x.data();
+    const double* y = system.y.data();
+    const double* z = system.z.data();
+
+    double min_x = x[0], min_y = y[0], min_z = z[0];
+    double max_x = x[0], max_y = y[0], max_z = z[0];
+    #pragma omp parallel for reduction(min:min_x, min_y, min_z) reduction(max:max_x, max_y, max_z)
+    for (int i = 0; i < n; i++) {
+        min_x = std::min(min_x, x[i]);
+        min_y = std::min(min_y, y[i]);
+        min_z = std::min(min_z, z[i]);
+        max_x = std::max(max_x, x[i]);
+        max_y = std::max(max_y, y[i]);
+        max_z = std::max(max_z, z[i]);
+    }
+
+    double extent = std::max({max_x - min_x, max_y - min_y, max_z - min_z});
+    root_half_size_ = extent > 0.0 ? 0.5 * extent * (1.0 + 1e-12) : 1.0;
+    root_center_[0] = 0.5 * (min_x + max_x);
+    root_center_[1] = 0.5 * (min_y + max_y);
+    root_center_[2] = 0.5 * (min_z + max_z);
+
+    const double cells = static_cast<double>(1 << kMaxLevel);
+    const double scale = cells / (2.0 * root_half_size_);
+    const double origin_x = root_center_[0] - root_half_size_;
+    const double origin_y = root_center_[1] - root_half_size_;
+    const double origin_z = root_center_[2] - root_half_size_;
+    auto cell = [cells](double u) {
+        return static_cast<std::uint64_t>(std::min(std::max(u, 0.0), cells - 1.0));
+    };
+
+    keys_.resize(n);
+    order_.resize(n);
+    keys_tmp_.resize(n);
+    order_tmp_.resize(n);
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        keys_[i] = mortonKey(cell((x[i] - origin_x) * scale), cell((y[i] - origin_y) * scale), cell((z[i] - origin_z) * scale));
+        order_[i] = i;
+    }
+
+    // LSD radix sort on 8-bit digits, stable so equal keys keep their input order
+    for (int shift = 0; shift < 3 * kMaxLevel; shift += 8) {
+        std::size_t counts[257] = {0};
+        for (int i = 0; i < n; i++) {
+            counts[((keys_[i] >> shift) & 0xff) + 1]++;
+        }
+        for (int d = 0; d < 256; d++) {
+            counts[d + 1] += counts[d];
+        }
+        for (int i = 0; i < n; i++) {
+            std::size_t dest = counts[(keys_[i] >> shift) & 0xff]++;
+            keys_tmp_[dest] = keys_[i];
+            order_tmp_[dest] = order_[i];
+        }
+        keys_.swap(keys_tmp_);
+        order_.swap(order_tmp_);
+    }
+
+    x_.resize(n);
+    y_.resize(n);
+    z_.resize(n);
+    m_.resize(n);
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        const std::uint32_t k = order_[i];
+        x_[i] = x[k];
+        y_[i] = y[k];
+        z_[i] = z[k];
+        m_[i] = system.m[k];
+    }
+}
+
+// Function to split a node's sorted range into its eight octants, bounds[d]..bounds[d + 1] holds octant d
+void BarnesHutSolver::childRanges(const Node& node, std::uint32_t* bounds) const {
+    const int shift = 3 * (kMaxLevel - node.level - 1);
+    auto first = keys_.begin() + node.begin;
+    auto last = keys_.begin() + node.end;
+    for (int d = 0; d < 8; d++) {
+        auto it = std::partition_point(first, last, [shift, d](std::uint64_t key) {
+            return static_cast<int>((key >> shift) & 7) < d;
+        });
+        bounds[d] = static_cast<std::uint32_t>(it - keys_.begin());
+        first = it;
+    }
+    bounds[8] = node.end;
+}
+
+// Function to build the octree breadth first. The children of every node are stored
+// contiguously in Morton order, and each level is split in parallel.
+void BarnesHutSolver::buildTree() {
+    nodes_.clear();
+    level_begin_.clear();
+
+    Node root{};
+    root.center[0] = root_center_[0];
+    root.center[1] = root_center_[1];
+    root.center[2] = root_center_[2];
+    root.half_size = root_half_size_;
+    root.begin = 0;
+    root.end = static_cast<std::uint32_t>(keys_.size());
+    root.first_child = -1;
+    nodes_.push_back(root);
+
+    std::size_t first = 0;
+    std::size_t last = 1;
+    level_begin_.push_back(0);
+    while (first < last) {
+        level_begin_.push_back(last);
+        const int width = static_cast<int>(last - first);
+        child_offsets_.assign(width + 1, 0);
+
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (int k = 0; k < width; k++) {
+            const Node& node = nodes_[first + k];
+            if (isLeaf(node, leaf_size_)) {
+                continue;
+            }
+            std::uint32_t bounds[9];
+            childRanges(node, bounds);
+            std::uint32_t count = 0;
+            for (int d = 0; d < 8; d++) {
+                count += bounds[d + 1] > bounds[d];
+            }
+            child_offsets_[k + 1] = count;
+        }
+
+        for (int k = 0; k < width; k++) {
+            child_offsets_[k + 1] += child_offsets_[k];
+        }
+        nodes_.resize(last + child_offsets_[width]);
+
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (int k = 0; k < width; k++) {
+            Node& node = nodes_[first + k];
+            node.num_children = static_cast<std::int32_t>(child_offsets_[k + 1] - child_offsets_[k]);
+            node.first_child = node.num_children > 0 ? static_cast<std::int32_t>(last + child_offsets_[k]) : -1;
+            if (node.num_children == 0) {
+                continue;
+            }
+            std::uint32_t bounds[9];
+            childRanges(node, bounds);
+            std::size_t c = node.first_child;
+            const double quarter = 0.5 * node.half_size;
+            for (int d = 0; d < 8; d++) {
+                if (bounds[d + 1] == bounds[d]) {
+                    continue;
+                }
+                Node& child = nodes_[c++];
+                child = Node{};
+                child.center[0] = node.center[0] + ((d & 4) ? quarter : -quarter);
+                child.center[1] = node.center[1] + ((d & 2) ? quarter : -quarter);
+                child.center[2] = node.center[2] + ((d & 1) ? quarter : -quarter);
+                child.half_size = quarter;
+                child.begin = bounds[d];
+                child.end = bounds[d + 1];
+                child.first_child = -1;
+                child.level = node.level + 1;
+            }
+        }
+
+        first = last;
+        last = nodes_.size();
+    }
+}
+
+// Function to fill mass, centre of mass and quadrupole of every node, deepest level first
+void BarnesHutSolver::computeMoments() {
+    for (std::size_t l = level_begin_.size() - 1; l-- > 0;) {
+        const int first = static_cast<int>(level_begin_[l]);
+        const int last = static_cast<int>(level_begin_[l + 1]);
+
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (int k = first; k < last; k++) {
+            Node& node = nodes_[k];
+            double mass = 0.0, cx = 0.0, cy = 0.0, cz = 0.0;
+            double q[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+            if (node.num_children == 0) {
+                for (std::uint32_t j = node.begin; j < node.end; j++) {
+                    mass += m_[j];
+                    cx += m_[j] * x_[j];
+                    cy += m_[j] * y_[j];
+                    cz += m_[j] * z_[j];
+                }
+            }
+            else {
+                for (int c = node.first_child; c < node.first_child + node.num_children; c++) {
+                    const Node& child = nodes_[c];
+                    mass += child.mass;
+                    cx += child.mass * child.com[0];
+                    cy += child.mass * child.com[1];
+                    cz += child.mass * child.com[2];
+                }
+            }
+
+            if (mass > 0.0) {
+                cx /= mass;
+                cy /= mass;
+                cz /= mass;
+            }
+            else {
+                cx = node.center[0];
+                cy = node.center[1];
+                cz = node.center[2];
+            }
+
+            // Q_ab = sum m (3 s_a s_b - s^2 delta_ab), shifted from the children with the parallel axis theorem
+            auto add_quadrupole = [&q](double w, double sx, double sy, double sz) {
+                double s2 = sx * sx + sy * sy + sz * sz;
+                q[0] += w * (3 * sx * sx - s2);
+                q[1] += w * 3 * sx * sy;
+                q[2] += w * 3 * sx * sz;
+                q[3] += w * (3 * sy * sy - s2);
+                q[4] += w * 3 * sy * sz;
+                q[5] += w * (3 * sz * sz - s2);
+            };
+            if (quadrupole_) {
+                if (node.num_children == 0) {
+                    for (std::uint32_t j = node.begin; j < node.end; j++) {
+                        add_quadrupole(m_[j], x_[j] - cx, y_[j] - cy, z_[j] - cz);
+                    }
+                }
+                else {
+                    for (int c = node.first_child; c < node.first_child + node.num_children; c++) {
+                        const Node& child = nodes_[c];
+                        for (int a = 0; a < 6; a++) {
+                            q[a] += child.quad[a];
+                        }
+                        add_quadrupole(child.mass, child.com[0] - cx, child.com[1] - cy, child.com[2] - cz);
+                    }
+                }
+            }
+
+            node.mass = mass;
+            node.com[0] = cx;
+            node.com[1] = cy;
+            node.com[2] = cz;
+            std::copy(q, q + 6, node.quad);
+        }
+    }
+}
+
+// Function to walk the tree for sorted body i. A node is accepted when the body lies outside
+// its cell and the cell size over the distance to its centre of mass is below theta.
+void BarnesHutSolver::walk(std::size_t i, double epsilon2, double* acc) const {
+    static const PointKernel kernel = selectKernel(detectSimdLevel());
+    const double px = x_[i], py = y_[i], pz = z_[i];
+    const double theta2 = theta_ * theta_;
+    double sx = 0.0, sy = 0.0, sz = 0.0;
+
+    std::int32_t stack[8 * kMaxLevel + 8];
+    int top = 0;
+    stack[top++] = 0;
+    std::uint64_t visits = 0, interactions = 0;
+    while (top > 0) {
+        const Node& node = nodes_[stack[--top]];
+        visits++;
+        if (node.mass == 0.0) {
+            continue;
+        }
+
+        const double dx = node.com[0] - px;
+        const double dy = node.com[1] - py;
+        const double dz = node.com[2] - pz;
+        const double d2 = dx * dx + dy * dy + dz * dz;
+        const double h = node.half_size;
+        const bool outside = std::abs(px - node.center[0]) > h || std::abs(py - node.center[1]) > h || std::abs(pz - node.center[2]) > h;
+
+        if (outside && 4.0 * h * h < theta2 * d2) {
+            const double r2 = d2 + epsilon2;
+            const double inv = 1.0 / std::sqrt(r2);
+            const double inv3 = inv * inv * inv;
+            double w = node.mass * inv3;
+            if (quadrupole_) {
+                const double* q = node.quad;
+                const double qx = q[0] * dx + q[1] * dy + q[2] * dz;
+                const double qy = q[1] * dx + q[3] * dy + q[4] * dz;
+                const double qz = q[2] * dx + q[4] * dy + q[5] * dz;
+                const double inv5 = inv3 * inv * inv;
+                w += 2.5 * (dx * qx + dy * qy + dz * qz) * inv5 * inv * inv;
+                sx -= qx * inv5;
+                sy -= qy * inv5;
+                sz -= qz * inv5;
+            }
+            sx += w * dx;
+            sy += w * dy;
+            sz += w * dz;
+            interactions++;
+        }
+        else if (node.num_children == 0) {
+            double leaf_acc[3];
+            SourceArrays sources{x_.data() + node.begin, y_.data() + node.begin, z_.data() + node.begin, m_.data() + node.begin, node.end - node.begin};
+            kernel(sources, px, py, pz, epsilon2, leaf_acc);
+            interactions += node.end - node.begin;
+            sx += leaf_acc[0];
+            sy += leaf_acc[1];
+            sz += leaf_acc[2];
+        }
+        else {
+            for (int c = node.first_child + node.num_children - 1; c >= node.first_child; c--) {
+                stack[top++] = c;
+            }
+        }
+    }
+
+    PROFILE_COUNT(NodeVisits, visits);
+    PROFILE_COUNT(PairInteractions, interactions);
+    acc[0] = sx;
+    acc[1] = sy;
+    acc[2] = sz;
+}
@@ -0,0 +1,180 @@
+#include "BlockTimestepIntegrator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+BlockTimestepIntegrator::BlockTimestepIntegrator(double eta, int max_level) :
+    eta_(eta), max_level_(max_level)
+{
+    if (max_level < 0 || max_level > 30) {
+        throw std::invalid_argument("The deepest block timestep level must be between 0 and 30");
+    }
+}
+
+void BlockTimestepIntegrator::reset() {
+    Integrator::reset();
+    state_for_ = nullptr;
+}
+
+void BlockTimestepIntegrator::reserve(std::size_t num_particles) {
+    level_.reserve(num_particles);
+    active_.reserve(num_particles);
+    start_ax_.reserve(num_particles);
+    start_ay_.reserve(num_particles);
+    start_az_.reserve(num_particles);
+    jerk_.reserve(num_particles);
+    probe_.reserve(num_particles);
+}
+
+// Levels and jerks carry over between steps, a fresh start-up would estimate the jerks again from a probe drift
+void BlockTimestepIntegrator::saveState(const ParticleSystem& system, std::vector<double>& state) const {
+    const bool has_state = state_for_ == &system && level_.size() == system.size();
+    state.push_back(has_state ? 1.0 : 0.0);
+    if (has_state) {
+        state.insert(state.end(), level_.begin(), level_.end());
+        appendState(state, jerk_);
+    }
+}
+
+void BlockTimestepIntegrator::restoreState(ParticleSystem& system, const ForceSolver& /*solver*/, double /*epsilon*/, const std::vector<double>& state, std::size_t& pos) {
+    reset();
+    if (readState(state, pos) == 0.0) {
+        return;
+    }
+    const std::size_t n = system.size();
+    level_.resize(n);
+    for (std::size_t i = 0; i < n; i++) {
+        level_[i] = static_cast<int>(readState(state, pos));
+        if (level_[i] < 0 || level_[i] > max_level_) {
+            throw std::invalid_argument("A saved block timestep level is outside 0 .. " + std::to_string(max_level_));
+        }
+    }
+    readState(state, pos, jerk_, n);
+    start_ax_.resize(n);
+    start_ay_.resize(n);
+    start_az_.resize(n);
+    state_for_ = &system;
+}
+
+const std::vector<int>& BlockTimestepIntegrator::levels() const {
+    return level_;
+}
+
+// Function to find the coarsest level whose step is below eta |a| / |da/dt|
+int BlockTimestepIntegrator::desiredLevel(const ParticleSystem& system, std::size_t i, double dt) const {
+    if (jerk_[i] == 0.0) {
+        return 0;
+    }
+    const double a = std::sqrt(system.ax[i] * system.ax[i] + system.ay[i] * system.ay[i] + system.az[i] * system.az[i]);
+    const double dt_max = eta_ * a / jerk_[i];
+    int level = 0;
+    for (double h = dt; level < max_level_ && h > dt_max; h *= 0.5) {
+        level++;
+    }
+    return level;
+}
+
+// Function to estimate da/dt of every body from the accelerations before and after a drift of the finest step
+void BlockTimestepIntegrator::startUp(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) {
+    const int n = static_cast<int>(system.size());
+    const double h = std::ldexp(dt, -max_level_);
+    probe_ = system;
+    drift(probe_, h);
+    computeForces(probe_, solver, epsilon);
+    computeForces(system, solver, epsilon);
+
+    level_.resize(n);
+    jerk_.resize(n);
+    start_ax_.resize(n);
+    start_ay_.resize(n);
+    start_az_.resize(n);
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        const double dx = probe_.ax[i] - system.ax[i];
+        const double dy = probe_.ay[i] - system.ay[i];
+        const double dz = probe_.az[i] - system.az[i];
+        jerk_[i] = std::sqrt(dx * dx + dy * dy + dz * dz) / h;
+        level_[i] = desiredLevel(system, i, dt);
+    }
+    state_for_ = &system;
+}
+
+std::string BlockTimestepIntegrator::name() const {
+    return "block";
+}
+
+void BlockTimestepIntegrator::step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) {
+    if (state_for_ != &system || level_.size() != system.size()) {
+        startUp(system, solver, dt, epsilon);
+    }
+
+    // time is counted in ticks of the deepest level, a body on level l steps block >> l ticks
+    const int n = static_cast<int>(system.size());
+    const long long block = 1LL << max_level_;
+    const double tick = dt / static_cast<double>(block);
+
+    auto begin_step = [&](int i) {
+        const double h = 0.5 * tick * static_cast<double>(block >> level_[i]);
+        system.vx[i] += h * system.ax[i];
+        system.vy[i] += h * system.ay[i];
+        system.vz[i] += h * system.az[i];
+        start_ax_[i] = system.ax[i];
+        start_ay_[i] = system.ay[i];
+        start_az_[i] = system.az[i];
+    };
+
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        begin_step(i);
+    }
+
+    long long t = 0;
+    while (t < block) {
+        int finest = 0;
+        #pragma omp parallel for reduction(max:finest)
+        for (int i = 0; i < n; i++) {
+            finest = std::max(finest, level_[i]);
+        }
+        const long long finest_span = block >> finest;
+        const long long next = (t / finest_span + 1) * finest_span;
+
+        drift(system, tick * static_cast<double>(next - t));
+
+        active_.clear();
+        for (int i = 0; i < n; i++) {
+            if (next % (block >> level_[i]) == 0) {
+                active_.push_back(i);
+            }
+        }
+        computeForces(system, active_, solver, epsilon);
+
+        const int num_active = static_cast<int>(active_.size());
+        #pragma omp parallel for
+        for (int k = 0; k < num_active; k++) {
+            const int i = active_[k];
+            const long long span = block >> level_[i];
+            const double h = tick * static_cast<double>(span);
+            system.vx[i] += 0.5 * h * system.ax[i];
+            system.vy[i] += 0.5 * h * system.ay[i];
+            system.vz[i] += 0.5 * h * system.az[i];
+
+            const double dx = system.ax[i] - start_ax_[i];
+            const double dy = system.ay[i] - start_ay_[i];
+            const double dz = system.az[i] - start_az_[i];
+            jerk_[i] = std::sqrt(dx * dx + dy * dy + dz * dz) / h;
+
+            // A body may move to any finer level, but only one level coarser and only where that level's steps begin
+            int level = desiredLevel(system, i, dt);
+            if (level < level_[i]) {
+                level = next % (2 * span) == 0 ? level_[i] - 1 : level_[i];
+            }
+            level_[i] = level;
+
+            if (next < block) {
+                begin_step(i);
+            }
+        }
+        t = next;
+    }
+}
@@ -0,0 +1,141 @@
+#include "Checkpoint.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kCheckpointMagic[8] = {'N', 'B', 'C', 'K', 'P', 'T', '\0', '\0'};
+const int kNumArrays = 10;
+
+// The format is little-endian and the arrays are copied as raw doubles
+void requireLittleEndian() {
+    if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+        throw std::runtime_error("Checkpoint files are only supported on little-endian hosts");
+    }
+}
+
+}
+
+void writeCheckpoint(const std::string& path, const ParticleSystem& system, long steps, double dt, double epsilon, const std::string& integrator, const std::vector<double>& integrator_state) {
+    requireLittleEndian();
+    CheckpointHeader header;
+    std::memcpy(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic));
+    header.version = kCheckpointVersion;
+    if (system.numTest() > UINT32_MAX) {
+        throw std::runtime_error("Checkpoints hold at most " + std::to_string(UINT32_MAX) + " test particles");
+    }
+    header.num_test = static_cast<std::uint32_t>(system.numTest());
+    header.num_bodies = system.size();
+    header.steps = steps;
+    header.time = static_cast<double>(steps) * dt;
+    header.dt = dt;
+    header.epsilon = epsilon;
+    header.state_size = integrator_state.size();
+    if (integrator.size() >= sizeof(header.integrator)) {
+        throw std::runtime_error("The integrator name '" + integrator + "' is too long for a checkpoint");
+    }
+    std::memset(header.integrator, 0, sizeof(header.integrator));
+    std::memcpy(header.integrator, integrator.data(), integrator.size());
+
+    const std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Cannot create checkpoint file '" + temporary + "'");
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    const AlignedVector* arrays[kNumArrays] = {&system.m, &system.x, &system.y, &system.z, &system.vx, &system.vy, &system.vz, &system.ax, &system.ay, &system.az};
+    for (const AlignedVector* array : arrays) {
+        ok = ok && std::fwrite(array->data(), sizeof(double), array->size(), file) == array->size();
+    }
+    ok = ok && std::fwrite(integrator_state.data(), sizeof(double), integrator_state.size(), file) == integrator_state.size();
+    // the data must be on disk before the rename makes it the checkpoint
+    ok = ok && std::fflush(file) == 0 && ::fsync(::fileno(file)) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Writing the checkpoint file '" + path + "' failed");
+    }
+}
+
+Checkpoint::Checkpoint(const std::string& path) {
+    requireLittleEndian();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open checkpoint file '" + path + "'");
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(CheckpointHeader)) {
+        ::close(fd);
+        throw std::runtime_error("'" + path + "' is too short to be a checkpoint file");
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map checkpoint file '" + path + "'");
+    }
+    data_ = static_cast<const unsigned char*>(mapping);
+
+    std::memcpy(&header_, data_, sizeof(header_));
+    const std::uint64_t expected = sizeof(CheckpointHeader) + (kNumArrays * header_.num_bodies + header_.state_size) * sizeof(double);
+    if (std::memcmp(header_.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) != 0 || header_.version != kCheckpointVersion || expected != size_) {
+        ::munmap(mapping, size_);
+        throw std::runtime_error("'" + path + "' is not a complete version " + std::to_string(kCheckpointVersion) + " checkpoint file");
+    }
+}
+
+Checkpoint::~Checkpoint() {
+    ::munmap(const_cast<unsigned char*>(data_), size_);
+}
+
+std::size_t Checkpoint::numBodies() const {
+    return header_.num_bodies;
+}
+
+long Checkpoint::steps() const {
+    return static_cast<long>(header_.steps);
+}
+
+double Checkpoint::time() const {
+    return header_.time;
+}
+
+double Checkpoint::timestep() const {
+    return header_.dt;
+}
+
+double Checkpoint::softening() const {
+    return header_.epsilon;
+}
+
+std::string Checkpoint::integrator() const {
+    const char* end = std::find(header_.integrator, header_.integrator + sizeof(header_.integrator), '\0');
+    return std::string(header_.integrator, end);
+}
+
+const double* Checkpoint::array(int k) const {
+    return reinterpret_cast<const double*>(data_ + sizeof(CheckpointHeader)) + k * header_.num_bodies;
+}
+
+void Checkpoint::loadInto(ParticleSystem& system) const {
+    const std::size_t n = header_.num_bodies;
+    system.resize(n);
+    AlignedVector* arrays[kNumArrays] = {&system.m, &system.x, &system.y, &system.z, &system.vx, &system.vy, &system.vz, &system.ax, &system.ay, &system.az};
+    for (int k = 0; k < kNumArrays; k++) {
+        std::memcpy(arrays[k]->data(), array(k), n * sizeof(double));
+    }
+    system.setNumMassive(n - std::min<std::size_t>(header_.num_test, n));
+}
+
+std::vector<double> Checkpoint::integratorState() const {
+    const double* state = array(kNumArrays);
+    return std::vector<double>(state, state + header_.state_size);
+}
@@ -0,0 +1,17 @@
+#include "CheckpointGenerator.hpp"
+
+CheckpointGenerator::CheckpointGenerator(const std::string& path) : checkpoint_(path) {}
+
+std::vector<Particle> CheckpointGenerator::generateInitialConditions() {
+    return generateParticleSystem().toParticles();
+}
+
+ParticleSystem CheckpointGenerator::generateParticleSystem() {
+    ParticleSystem system;
+    checkpoint_.loadInto(system);
+    return system;
+}
+
+const Checkpoint& CheckpointGenerator::checkpoint() const {
+    return checkpoint_;
+}
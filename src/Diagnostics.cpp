@@ -0,0 +1,152 @@
+#include "Diagnostics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <Eigen/Geometry>
+#include <omp.h>
+#include "ForceKernel.hpp"
+#include "Profiler.hpp"
+
+namespace {
+
+// Neumaier's variant of Kahan summation, also exact when an addend is larger than the running sum
+struct CompensatedSum {
+    double sum = 0.0;
+    double compensation = 0.0;
+
+    void add(double value) {
+        const double t = sum + value;
+        if (std::abs(sum) >= std::abs(value)) {
+            compensation += (sum - t) + value;
+        }
+        else {
+            compensation += (value - t) + sum;
+        }
+        sum = t;
+    }
+
+    double value() const {
+        return sum + compensation;
+    }
+};
+
+// Slots of the per-thread partial sums
+enum Quantity { kMass, kKinetic, kPotential, kMomentum, kAngularMomentum = kMomentum + 3, kMoment = kAngularMomentum + 3, kNumQuantities = kMoment + 3 };
+
+// Rows of the pair sum are cut into blocks of this many bodies, summed with SIMD and then added with compensation
+constexpr int kPotentialBlock = 512;
+
+struct PartialSums {
+    CompensatedSum q[kNumQuantities];
+};
+
+void addBody(PartialSums& part, const ParticleSystem& system, int i) {
+    const double m = system.m[i];
+    const Eigen::Vector3d r = system.getPosition(i);
+    const Eigen::Vector3d v = system.getVelocity(i);
+    const Eigen::Vector3d l = m * r.cross(v);
+    part.q[kMass].add(m);
+    part.q[kKinetic].add(0.5 * m * v.squaredNorm());
+    for (int k = 0; k < 3; k++) {
+        part.q[kMomentum + k].add(m * v[k]);
+        part.q[kAngularMomentum + k].add(l[k]);
+        part.q[kMoment + k].add(m * r[k]);
+    }
+}
+
+// Function to add up the per-thread sums in thread order, so the result does not depend on the schedule
+Diagnostics combine(const std::vector<PartialSums>& partials) {
+    double total[kNumQuantities];
+    for (int q = 0; q < kNumQuantities; q++) {
+        CompensatedSum sum;
+        for (const PartialSums& part : partials) {
+            sum.add(part.q[q].sum);
+            sum.add(part.q[q].compensation);
+        }
+        total[q] = sum.value();
+    }
+
+    Diagnostics result;
+    result.mass = total[kMass];
+    result.kinetic = total[kKinetic];
+    result.potential = total[kPotential];
+    result.momentum = Eigen::Vector3d(total[kMomentum], total[kMomentum + 1], total[kMomentum + 2]);
+    result.angular_momentum = Eigen::Vector3d(total[kAngularMomentum], total[kAngularMomentum + 1], total[kAngularMomentum + 2]);
+    if (result.mass > 0.0) {
+        result.centre_of_mass = Eigen::Vector3d(total[kMoment], total[kMoment + 1], total[kMoment + 2]) / result.mass;
+        result.centre_of_mass_velocity = result.momentum / result.mass;
+    }
+    return result;
+}
+
+}
+
+double Diagnostics::energy() const {
+    return kinetic + potential;
+}
+
+Diagnostics computeDiagnostics(const ParticleSystem& system, double epsilon) {
+    static const PointKernel kernel = selectPotentialKernel(detectSimdLevel());
+    const int num_bodies = static_cast<int>(system.size());
+    const double epsilon2 = epsilon * epsilon;
+    const SourceArrays bodies = sourceArrays(system);
+    // massless test particles add nothing to the pair sum
+    const int n = static_cast<int>(bodies.count);
+    std::vector<PartialSums> partials(omp_get_max_threads());
+    PROFILE_SCOPE(Diagnostics);
+
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE(DiagnosticsLoop);
+        PartialSums& part = partials[omp_get_thread_num()];
+
+        // The body terms of i and the pairs (i, j > i) in one sweep over row i, with the SIMD
+        // potential kernel of the force evaluation. Its accelerations are not needed here.
+        auto row = [&](int i) {
+            addBody(part, system, i);
+            for (int begin = i + 1; begin < n; begin += kPotentialBlock) {
+                const int end = std::min(begin + kPotentialBlock, n);
+                SourceArrays block{bodies.x + begin, bodies.y + begin, bodies.z + begin, bodies.m + begin, static_cast<std::size_t>(end - begin)};
+                double acc[4];
+                kernel(block, bodies.x[i], bodies.y[i], bodies.z[i], epsilon2, acc);
+                part.q[kPotential].add(-bodies.m[i] * acc[3]);
+            }
+        };
+
+        // Rows k and n - 1 - k together hold n - 1 pairs, so a static schedule is balanced
+        #pragma omp for schedule(static) nowait
+        for (int k = 0; k < (n + 1) / 2; k++) {
+            row(k);
+            if (n - 1 - k != k) {
+                row(n - 1 - k);
+            }
+        }
+        #pragma omp for schedule(static) nowait
+        for (int i = n; i < num_bodies; i++) {
+            addBody(part, system, i);
+        }
+    }
+    return combine(partials);
+}
+
+Diagnostics computeDiagnostics(const ParticleSystem& system, const AlignedVector& potential) {
+    const int n = static_cast<int>(system.size());
+    std::vector<PartialSums> partials(omp_get_max_threads());
+    PROFILE_SCOPE(Diagnostics);
+
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE(DiagnosticsLoop);
+        PartialSums& part = partials[omp_get_thread_num()];
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < n; i++) {
+            addBody(part, system, i);
+            part.q[kPotential].add(0.5 * system.m[i] * potential[i]);
+        }
+    }
+    return combine(partials);
+}
+
+double centreOfMassDrift(const Diagnostics& start, const Diagnostics& now, double elapsed) {
+    return (now.centre_of_mass - start.centre_of_mass - elapsed * start.centre_of_mass_velocity).norm();
+}
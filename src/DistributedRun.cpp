@@ -0,0 +1,145 @@
+#include "DistributedRun.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "ForceKernel.hpp"
+#include "Profiler.hpp"
+
+namespace {
+
+// Doubles of one body in the final gather: position, velocity and acceleration
+constexpr std::size_t kGatherComponents = 9;
+
+// The slice of a rank and its arrays
+struct Slice {
+    std::size_t begin;
+    std::size_t count;
+    // the massive bodies come first, test particles follow them
+    std::size_t num_massive;
+    AlignedVector x, y, z, vx, vy, vz, ax, ay, az, m;
+
+    Slice(const ParticleSystem& system, int rank, int num_ranks) {
+        const std::size_t n = system.size();
+        begin = n * rank / num_ranks;
+        count = n * (rank + 1) / num_ranks - begin;
+        num_massive = std::min(count, system.numMassive() - std::min(system.numMassive(), begin));
+        const AlignedVector* from[10] = {&system.x, &system.y, &system.z, &system.vx, &system.vy, &system.vz, &system.ax, &system.ay, &system.az, &system.m};
+        AlignedVector* to[10] = {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &m};
+        for (int c = 0; c < 10; c++) {
+            to[c]->assign(from[c]->begin() + begin, from[c]->begin() + begin + count);
+        }
+    }
+};
+
+// Function to overwrite the accelerations of the slice, the massive bodies of every slice passing through once
+void ringAccelerations(Transport& transport, Slice& s, AlignedVector& travelling, AlignedVector& arriving, double epsilon2) {
+    PROFILE_SCOPE(ForceLoop);
+    static const PointKernel kernel = selectKernel(detectSimdLevel());
+    std::size_t c = s.num_massive;
+    std::copy(s.x.begin(), s.x.begin() + c, travelling.begin());
+    std::copy(s.y.begin(), s.y.begin() + c, travelling.begin() + c);
+    std::copy(s.z.begin(), s.z.begin() + c, travelling.begin() + 2 * c);
+    std::copy(s.m.begin(), s.m.begin() + c, travelling.begin() + 3 * c);
+    std::fill(s.ax.begin(), s.ax.end(), 0.0);
+    std::fill(s.ay.begin(), s.ay.end(), 0.0);
+    std::fill(s.az.begin(), s.az.end(), 0.0);
+
+    for (int hop = 0; hop < transport.numRanks(); hop++) {
+        const double* block = travelling.data();
+        const SourceArrays sources{block, block + c, block + 2 * c, block + 3 * c, c};
+        PROFILE_COUNT(PairInteractions, c * s.count);
+        for (std::size_t i = 0; i < s.count; i++) {
+            double acc[3];
+            kernel(sources, s.x[i], s.y[i], s.z[i], epsilon2, acc);
+            s.ax[i] += acc[0];
+            s.ay[i] += acc[1];
+            s.az[i] += acc[2];
+        }
+        if (hop + 1 < transport.numRanks()) {
+            c = transport.shift(travelling.data(), 4 * c, arriving.data()) / 4;
+            std::swap(travelling, arriving);
+        }
+    }
+}
+
+void kick(Slice& s, double h) {
+    PROFILE_SCOPE(Kick);
+    for (std::size_t i = 0; i < s.count; i++) {
+        s.vx[i] += h * s.ax[i];
+        s.vy[i] += h * s.ay[i];
+        s.vz[i] += h * s.az[i];
+    }
+}
+
+void drift(Slice& s, double h) {
+    PROFILE_SCOPE(Drift);
+    for (std::size_t i = 0; i < s.count; i++) {
+        s.x[i] += h * s.vx[i];
+        s.y[i] += h * s.vy[i];
+        s.z[i] += h * s.vz[i];
+    }
+}
+
+// Function to pack the state of a slice as its first body, its length and the components one after the other
+void packState(const Slice& s, AlignedVector& message) {
+    message[0] = static_cast<double>(s.begin);
+    message[1] = static_cast<double>(s.count);
+    const AlignedVector* arrays[kGatherComponents] = {&s.x, &s.y, &s.z, &s.vx, &s.vy, &s.vz, &s.ax, &s.ay, &s.az};
+    for (std::size_t c = 0; c < kGatherComponents; c++) {
+        std::copy(arrays[c]->begin(), arrays[c]->end(), message.begin() + 2 + c * s.count);
+    }
+}
+
+void unpackState(const AlignedVector& message, ParticleSystem& system) {
+    const std::size_t begin = static_cast<std::size_t>(message[0]);
+    const std::size_t count = static_cast<std::size_t>(message[1]);
+    AlignedVector* arrays[kGatherComponents] = {&system.x, &system.y, &system.z, &system.vx, &system.vy, &system.vz, &system.ax, &system.ay, &system.az};
+    for (std::size_t c = 0; c < kGatherComponents; c++) {
+        const auto first = message.begin() + 2 + c * count;
+        std::copy(first, first + count, arrays[c]->begin() + begin);
+    }
+}
+
+}
+
+std::size_t distributedCapacity(std::size_t num_bodies, int num_ranks) {
+    const std::size_t largest_slice = (num_bodies + num_ranks - 1) / num_ranks;
+    return 2 + kGatherComponents * largest_slice;
+}
+
+void runDistributedLeapfrog(Transport& transport, ParticleSystem& system, double dt, long num_steps, double epsilon) {
+    const std::size_t capacity = distributedCapacity(system.size(), transport.numRanks());
+    if (transport.capacity() < capacity) {
+        throw std::invalid_argument("The transport carries " + std::to_string(transport.capacity()) + " doubles, the run needs " + std::to_string(capacity));
+    }
+    const double epsilon2 = epsilon * epsilon;
+    Slice slice(system, transport.rank(), transport.numRanks());
+    AlignedVector travelling(capacity), arriving(capacity);
+
+    ringAccelerations(transport, slice, travelling, arriving, epsilon2);
+    for (long step = 0; step < num_steps; step++) {
+        kick(slice, 0.5 * dt);
+        drift(slice, dt);
+        ringAccelerations(transport, slice, travelling, arriving, epsilon2);
+        kick(slice, 0.5 * dt);
+    }
+
+    // every slice travels to rank 0, the ranks in between pass on what they receive
+    packState(slice, travelling);
+    unpackState(travelling, system);
+    std::size_t length = 2 + kGatherComponents * slice.count;
+    for (int hop = 1; hop < transport.numRanks(); hop++) {
+        length = transport.shift(travelling.data(), length, arriving.data());
+        std::swap(travelling, arriving);
+        if (transport.rank() == 0) {
+            unpackState(travelling, system);
+        }
+    }
+}
+
+void advanceDistributed(ParticleSystem& system, int num_ranks, double dt, long num_steps, double epsilon) {
+    runLocalRanks(num_ranks, distributedCapacity(system.size(), num_ranks), [&](Transport& transport) {
+        runDistributedLeapfrog(transport, system, dt, num_steps, epsilon);
+    });
+}
@@ -0,0 +1,197 @@
+#include "EncounterIntegrator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <Eigen/Geometry>
+#include "Profiler.hpp"
+
+EncounterIntegrator::EncounterIntegrator(double encounter_radius, double merge_radius, double eta, int max_substeps) :
+    grid_(encounter_radius), merge_radius_(merge_radius), eta_(eta), max_substeps_(max_substeps)
+{
+    if (merge_radius < 0.0 || merge_radius > encounter_radius || !(eta > 0.0) || max_substeps < 1) {
+        throw std::invalid_argument("The merge radius must lie between 0 and the encounter radius, eta must be positive and at least one substep is needed");
+    }
+}
+
+long EncounterIntegrator::encounterPairs() const {
+    return encounter_pairs_;
+}
+
+long EncounterIntegrator::substeps() const {
+    return substeps_;
+}
+
+long EncounterIntegrator::mergedBodies() const {
+    return merged_bodies_;
+}
+
+namespace {
+
+// The pair potential is handed from the groups to the kicks between these fractions of the encounter
+// radius. A wide changeover keeps the share of the kicks smooth, and the share of the groups is still
+// small for pairs that come within the radius during a step rather than at its start.
+constexpr double kChangeoverInner = 0.1;
+constexpr double kChangeoverOuter = 1.0;
+
+}
+
+// Overwrite the accelerations of the members of group g from the other members. The group takes the share
+// 1 - K(r) of the softened pair potential, where K rises smoothly from 0 to 1 across the changeover, and the
+// force follows from that share of the potential, so the split between the groups and the kicks is a
+// Hamiltonian one at every distance.
+void EncounterIntegrator::groupAccelerations(const ParticleSystem& system, int g, double epsilon2) {
+    const double inner = kChangeoverInner * grid_.radius();
+    const double width = (kChangeoverOuter - kChangeoverInner) * grid_.radius();
+    for (int a = group_begin_[g]; a < group_begin_[g + 1]; a++) {
+        const int i = members_[a];
+        double acc[3] = {0.0, 0.0, 0.0};
+        for (int b = group_begin_[g]; b < group_begin_[g + 1]; b++) {
+            const int j = members_[b];
+            const double dx = system.x[j] - system.x[i];
+            const double dy = system.y[j] - system.y[i];
+            const double dz = system.z[j] - system.z[i];
+            const double d2 = dx * dx + dy * dy + dz * dz;
+            if (d2 == 0.0) {
+                continue;
+            }
+            const double r = std::sqrt(d2);
+            const double y = (r - inner) / width;
+            if (y >= 1.0) {
+                continue;
+            }
+            // K = 10 y^3 - 15 y^4 + 6 y^5 and its derivative by r
+            const double k = y <= 0.0 ? 0.0 : y * y * y * (10.0 - 15.0 * y + 6.0 * y * y);
+            const double dk = y <= 0.0 ? 0.0 : 30.0 * y * y * (1.0 - y) * (1.0 - y) / width;
+            const double inv = 1.0 / std::sqrt(d2 + epsilon2);
+            const double w = system.m[j] * ((1.0 - k) * inv * inv * inv + dk * inv / r);
+            acc[0] += w * dx;
+            acc[1] += w * dy;
+            acc[2] += w * dz;
+        }
+        group_ax_[a] = acc[0];
+        group_ay_[a] = acc[1];
+        group_az_[a] = acc[2];
+    }
+}
+
+// The time scale of a pair is the free-fall time at the pericentre of its two-body orbit, which is as
+// short near a flyby as on a tight binary. The pericentre hardly changes during an encounter, so neither
+// does the number of substeps, which keeps the step close to time symmetric. A head-on pair without
+// softening takes the most substeps.
+int EncounterIntegrator::groupSubsteps(const ParticleSystem& system, int g, double dt, double epsilon2) const {
+    double shortest = INFINITY;
+    for (int a = group_begin_[g]; a < group_begin_[g + 1]; a++) {
+        for (int b = a + 1; b < group_begin_[g + 1]; b++) {
+            const int i = members_[a];
+            const int j = members_[b];
+            const double mu = system.m[i] + system.m[j];
+            if (mu <= 0.0) {
+                continue;
+            }
+            const Eigen::Vector3d r = system.getPosition(j) - system.getPosition(i);
+            const Eigen::Vector3d v = system.getVelocity(j) - system.getVelocity(i);
+            const double h2 = r.cross(v).squaredNorm();
+            const double energy = 0.5 * v.squaredNorm() - mu / r.norm();
+            const double e = std::sqrt(std::max(0.0, 1.0 + 2.0 * energy * h2 / (mu * mu)));
+            const double pericentre = h2 / (mu * (1.0 + e));
+            const double pericentre2 = pericentre * pericentre + epsilon2;
+            shortest = std::min(shortest, std::sqrt(pericentre2 * std::sqrt(pericentre2) / mu));
+        }
+    }
+    const double substeps = std::ceil(dt / (eta_ * shortest));
+    return substeps >= max_substeps_ ? max_substeps_ : std::max(1, static_cast<int>(substeps));
+}
+
+void EncounterIntegrator::removeGroupKick(ParticleSystem& system, double h) {
+    for (std::size_t a = 0; a < members_.size(); a++) {
+        const int i = members_[a];
+        system.vx[i] -= h * group_ax_[a];
+        system.vy[i] -= h * group_ay_[a];
+        system.vz[i] -= h * group_az_[a];
+    }
+}
+
+std::string EncounterIntegrator::name() const {
+    return "encounter";
+}
+
+// The Hamiltonian is split into the forces between groups, which kick as in the leapfrog, and the
+// motion plus the forces inside the groups, which the substeps integrate. Bodies outside a group
+// just drift, so both parts are integrated symplectically and the step stays second order.
+void EncounterIntegrator::step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) {
+    const std::vector<EncounterPair>& pairs = grid_.findPairs(system);
+    if (merge_radius_ > 0.0) {
+        const std::size_t merged = mergeCollisions(system, pairs, merge_radius_);
+        if (merged > 0) {
+            // the bodies are renumbered, so the encounters are searched again
+            merged_bodies_ += static_cast<long>(merged);
+            reset();
+            grid_.findPairs(system);
+        }
+    }
+    ensureForces(system, solver, epsilon);
+    if (pairs.empty()) {
+        kick(system, 0.5 * dt);
+        drift(system, dt);
+        computeForces(system, solver, epsilon);
+        kick(system, 0.5 * dt);
+        return;
+    }
+    encounter_pairs_ += static_cast<long>(pairs.size());
+    encounterGroups(pairs, members_, group_begin_);
+    const int num_groups = static_cast<int>(group_begin_.size()) - 1;
+    const double epsilon2 = epsilon * epsilon;
+    for (std::vector<double>* array : {&group_ax_, &group_ay_, &group_az_, &start_x_, &start_y_, &start_z_}) {
+        array->resize(members_.size());
+    }
+
+    for (int g = 0; g < num_groups; g++) {
+        groupAccelerations(system, g, epsilon2);
+    }
+    kick(system, 0.5 * dt);
+    removeGroupKick(system, 0.5 * dt);
+    for (std::size_t a = 0; a < members_.size(); a++) {
+        start_x_[a] = system.x[members_[a]];
+        start_y_[a] = system.y[members_[a]];
+        start_z_[a] = system.z[members_[a]];
+    }
+    drift(system, dt);
+
+    {
+        PROFILE_SCOPE(Subcycle);
+        for (int g = 0; g < num_groups; g++) {
+            for (int a = group_begin_[g]; a < group_begin_[g + 1]; a++) {
+                system.x[members_[a]] = start_x_[a];
+                system.y[members_[a]] = start_y_[a];
+                system.z[members_[a]] = start_z_[a];
+            }
+            const int k = groupSubsteps(system, g, dt, epsilon2);
+            const double h = dt / k;
+            substeps_ += k;
+            for (int s = 0; s < k; s++) {
+                for (int a = group_begin_[g]; a < group_begin_[g + 1]; a++) {
+                    const int i = members_[a];
+                    system.vx[i] += 0.5 * h * group_ax_[a];
+                    system.vy[i] += 0.5 * h * group_ay_[a];
+                    system.vz[i] += 0.5 * h * group_az_[a];
+                    system.x[i] += h * system.vx[i];
+                    system.y[i] += h * system.vy[i];
+                    system.z[i] += h * system.vz[i];
+                }
+                groupAccelerations(system, g, epsilon2);
+                for (int a = group_begin_[g]; a < group_begin_[g + 1]; a++) {
+                    const int i = members_[a];
+                    system.vx[i] += 0.5 * h * group_ax_[a];
+                    system.vy[i] += 0.5 * h * group_ay_[a];
+                    system.vz[i] += 0.5 * h * group_az_[a];
+                }
+            }
+        }
+    }
+
+    // the last substep left the forces inside each group at the new positions
+    computeForces(system, solver, epsilon);
+    kick(system, 0.5 * dt);
+    removeGroupKick(system, 0.5 * dt);
+}
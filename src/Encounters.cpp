@@ -0,0 +1,224 @@
+#include "Encounters.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <omp.h>
+#include "Profiler.hpp"
+
+namespace {
+
+// Cell coordinates are clamped, so bodies far out share the outermost cells instead of overflowing
+constexpr double kMaxCell = 1e15;
+
+// The own cell and the 13 neighbours after it in lexicographic order, the other 13 see this cell ahead of them
+constexpr int kHalfStencil = 14;
+constexpr int kStencil[kHalfStencil][3] = {
+    {0, 0, 0}, {0, 0, 1}, {0, 1, -1}, {0, 1, 0}, {0, 1, 1},
+    {1, -1, -1}, {1, -1, 0}, {1, -1, 1}, {1, 0, -1}, {1, 0, 0}, {1, 0, 1}, {1, 1, -1}, {1, 1, 0}, {1, 1, 1}
+};
+
+// Function to find the representative of the group of body i, halving the path on the way
+int findGroup(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+}
+
+EncounterGrid::EncounterGrid(double radius) : radius_(radius) {
+    if (!(radius > 0.0)) {
+        throw std::invalid_argument("The encounter radius must be positive, not " + std::to_string(radius));
+    }
+}
+
+double EncounterGrid::radius() const {
+    return radius_;
+}
+
+const std::vector<EncounterPair>& EncounterGrid::pairs() const {
+    return pairs_;
+}
+
+std::int64_t EncounterGrid::cellOf(double coordinate) const {
+    return static_cast<std::int64_t>(std::max(-kMaxCell, std::min(kMaxCell, std::floor(coordinate / radius_))));
+}
+
+std::uint32_t EncounterGrid::bucketOf(std::int64_t cx, std::int64_t cy, std::int64_t cz) const {
+    std::uint64_t h = static_cast<std::uint64_t>(cx) * 0x9E3779B97F4A7C15ull;
+    h ^= static_cast<std::uint64_t>(cy) * 0xC2B2AE3D27D4EB4Full;
+    h ^= static_cast<std::uint64_t>(cz) * 0x165667B19E3779F9ull;
+    h ^= h >> 29;
+    return static_cast<std::uint32_t>(h & mask_);
+}
+
+// Cells and buckets are found in one pass and a counting sort groups the bodies by bucket. Every body
+// then scans its own cell and the half of its 26 neighbours that lie ahead of it, so each pair of cells
+// and with it each pair of bodies is visited once.
+const std::vector<EncounterPair>& EncounterGrid::findPairs(const ParticleSystem& system) {
+    PROFILE_SCOPE(Encounters);
+    const int n = static_cast<int>(system.size());
+    const int num_massive = static_cast<int>(system.numMassive());
+    std::size_t buckets = 64;
+    while (buckets < 2 * static_cast<std::size_t>(n)) {
+        buckets *= 2;
+    }
+    mask_ = buckets - 1;
+    cell_.resize(3 * static_cast<std::size_t>(n));
+    bucket_.resize(n);
+    order_.resize(n);
+    start_.assign(buckets + 1, 0);
+
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        cell_[3 * i] = cellOf(system.x[i]);
+        cell_[3 * i + 1] = cellOf(system.y[i]);
+        cell_[3 * i + 2] = cellOf(system.z[i]);
+        bucket_[i] = bucketOf(cell_[3 * i], cell_[3 * i + 1], cell_[3 * i + 2]);
+    }
+    for (int i = 0; i < n; i++) {
+        start_[bucket_[i] + 1]++;
+    }
+    std::partial_sum(start_.begin(), start_.end(), start_.begin());
+    // start_[b] is the insertion point of bucket b, afterwards it is where bucket b + 1 starts
+    for (int i = 0; i < n; i++) {
+        order_[start_[bucket_[i]]++] = i;
+    }
+    for (std::size_t b = buckets; b > 0; b--) {
+        start_[b] = start_[b - 1];
+    }
+    start_[0] = 0;
+
+    const double radius2 = radius_ * radius_;
+    thread_pairs_.resize(omp_get_max_threads());
+    #pragma omp parallel
+    {
+        std::vector<EncounterPair>& found = thread_pairs_[omp_get_thread_num()];
+        found.clear();
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            for (int c = 0; c < kHalfStencil; c++) {
+                const std::int64_t cx = cell_[3 * i] + kStencil[c][0];
+                const std::int64_t cy = cell_[3 * i + 1] + kStencil[c][1];
+                const std::int64_t cz = cell_[3 * i + 2] + kStencil[c][2];
+                const std::uint32_t b = bucketOf(cx, cy, cz);
+                for (std::uint32_t k = start_[b]; k < start_[b + 1]; k++) {
+                    const int j = order_[k];
+                    // cells can share a bucket, and in its own cell a body only pairs with the ones after it
+                    if ((c == 0 && j <= i) || (i >= num_massive && j >= num_massive) || cell_[3 * j] != cx || cell_[3 * j + 1] != cy || cell_[3 * j + 2] != cz) {
+                        continue;
+                    }
+                    const double dx = system.x[j] - system.x[i];
+                    const double dy = system.y[j] - system.y[i];
+                    const double dz = system.z[j] - system.z[i];
+                    if (dx * dx + dy * dy + dz * dz < radius2) {
+                        found.emplace_back(std::min(i, j), std::max(i, j));
+                    }
+                }
+            }
+        }
+    }
+
+    pairs_.clear();
+    for (const std::vector<EncounterPair>& found : thread_pairs_) {
+        pairs_.insert(pairs_.end(), found.begin(), found.end());
+    }
+    std::sort(pairs_.begin(), pairs_.end());
+    return pairs_;
+}
+
+// Union-find over the bodies that appear in a pair, so the cost follows the number of pairs and not of bodies
+void encounterGroups(const std::vector<EncounterPair>& pairs, std::vector<int>& members, std::vector<int>& group_begin) {
+    std::vector<int> bodies;
+    bodies.reserve(2 * pairs.size());
+    for (const EncounterPair& pair : pairs) {
+        bodies.push_back(pair.first);
+        bodies.push_back(pair.second);
+    }
+    std::sort(bodies.begin(), bodies.end());
+    bodies.erase(std::unique(bodies.begin(), bodies.end()), bodies.end());
+    auto slot = [&](int body) {
+        return static_cast<int>(std::lower_bound(bodies.begin(), bodies.end(), body) - bodies.begin());
+    };
+
+    const int count = static_cast<int>(bodies.size());
+    std::vector<int> parent(count);
+    std::iota(parent.begin(), parent.end(), 0);
+    // the lower slot becomes the representative, so it is the first body of its group
+    for (const EncounterPair& pair : pairs) {
+        const int a = findGroup(parent, slot(pair.first));
+        const int b = findGroup(parent, slot(pair.second));
+        parent[std::max(a, b)] = std::min(a, b);
+    }
+    std::vector<int> group(count);
+    group_begin.assign(1, 0);
+    for (int k = 0; k < count; k++) {
+        const int root = findGroup(parent, k);
+        if (root == k) {
+            group[k] = static_cast<int>(group_begin.size()) - 1;
+            group_begin.push_back(0);
+        }
+        else {
+            group[k] = group[root];
+        }
+        group_begin[group[k] + 1]++;
+    }
+    std::partial_sum(group_begin.begin(), group_begin.end(), group_begin.begin());
+    members.resize(count);
+    std::vector<int> next(group_begin.begin(), group_begin.end() - 1);
+    for (int k = 0; k < count; k++) {
+        members[next[group[k]]++] = bodies[k];
+    }
+}
+
+// The first body of a group collects mass weighted sums of position and velocity, divided by the total mass
+// at the end. Test particles come after the massive bodies, so a group that has any mass keeps a massive body.
+std::size_t mergeCollisions(ParticleSystem& system, const std::vector<EncounterPair>& pairs, double radius) {
+    std::vector<EncounterPair> close;
+    for (const EncounterPair& pair : pairs) {
+        if ((system.getPosition(pair.second) - system.getPosition(pair.first)).squaredNorm() < radius * radius) {
+            close.push_back(pair);
+        }
+    }
+    if (close.empty()) {
+        return 0;
+    }
+    std::vector<int> members, group_begin;
+    encounterGroups(close, members, group_begin);
+
+    std::vector<char> remove(system.size(), 0);
+    for (std::size_t g = 0; g + 1 < group_begin.size(); g++) {
+        const int first = members[group_begin[g]];
+        double mass = system.m[first];
+        double sums[6] = {};
+        AlignedVector* arrays[6] = {&system.x, &system.y, &system.z, &system.vx, &system.vy, &system.vz};
+        for (int c = 0; c < 6; c++) {
+            sums[c] = mass * (*arrays[c])[first];
+        }
+        for (int k = group_begin[g] + 1; k < group_begin[g + 1]; k++) {
+            const int i = members[k];
+            for (int c = 0; c < 6; c++) {
+                sums[c] += system.m[i] * (*arrays[c])[i];
+            }
+            mass += system.m[i];
+            remove[i] = 1;
+        }
+        if (mass > 0.0) {
+            for (int c = 0; c < 6; c++) {
+                (*arrays[c])[first] = sums[c] / mass;
+            }
+        }
+        system.m[first] = mass;
+        system.ax[first] = system.ay[first] = system.az[first] = 0.0;
+    }
+    system.removeParticles(remove);
+    return members.size() - (group_begin.size() - 1);
+}
+
+std::size_t mergeCollisions(ParticleSystem& system, EncounterGrid& grid) {
+    return mergeCollisions(system, grid.findPairs(system), grid.radius());
+}
@@ -0,0 +1,226 @@
+#include "Ensemble.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// One batch of members, component c of body i of lane s at c[i * width + s]
+struct Batch {
+    int bodies = 0;
+    int width = 0;
+    AlignedVector x, y, z, vx, vy, vz, ax, ay, az, m;
+
+    void resize(int num_bodies, int num_lanes) {
+        bodies = num_bodies;
+        width = num_lanes;
+        for (AlignedVector* array : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &m}) {
+            array->resize(static_cast<std::size_t>(num_bodies) * num_lanes);
+        }
+    }
+
+    void load(int lane, const ParticleSystem& system) {
+        for (int i = 0; i < bodies; i++) {
+            const std::size_t k = static_cast<std::size_t>(i) * width + lane;
+            x[k] = system.x[i];
+            y[k] = system.y[i];
+            z[k] = system.z[i];
+            vx[k] = system.vx[i];
+            vy[k] = system.vy[i];
+            vz[k] = system.vz[i];
+            m[k] = system.m[i];
+        }
+    }
+};
+
+// Function to compute the accelerations of every lane, each unordered pair once with equal and opposite contributions
+void accelerations(Batch& b, double epsilon2) {
+    const int w = b.width;
+    std::fill(b.ax.begin(), b.ax.end(), 0.0);
+    std::fill(b.ay.begin(), b.ay.end(), 0.0);
+    std::fill(b.az.begin(), b.az.end(), 0.0);
+    for (int i = 0; i < b.bodies; i++) {
+        const double* xi = b.x.data() + i * w;
+        const double* yi = b.y.data() + i * w;
+        const double* zi = b.z.data() + i * w;
+        const double* mi = b.m.data() + i * w;
+        double* axi = b.ax.data() + i * w;
+        double* ayi = b.ay.data() + i * w;
+        double* azi = b.az.data() + i * w;
+        for (int j = i + 1; j < b.bodies; j++) {
+            const double* xj = b.x.data() + j * w;
+            const double* yj = b.y.data() + j * w;
+            const double* zj = b.z.data() + j * w;
+            const double* mj = b.m.data() + j * w;
+            double* axj = b.ax.data() + j * w;
+            double* ayj = b.ay.data() + j * w;
+            double* azj = b.az.data() + j * w;
+
+            #pragma omp simd
+            for (int s = 0; s < w; s++) {
+                const double dx = xj[s] - xi[s];
+                const double dy = yj[s] - yi[s];
+                const double dz = zj[s] - zi[s];
+                const double d2 = dx * dx + dy * dy + dz * dz;
+                const double inv = 1.0 / std::sqrt(d2 + epsilon2);
+                const double inv3 = d2 > 0.0 ? inv * inv * inv : 0.0;
+                axi[s] += mj[s] * inv3 * dx;
+                ayi[s] += mj[s] * inv3 * dy;
+                azi[s] += mj[s] * inv3 * dz;
+                axj[s] -= mi[s] * inv3 * dx;
+                ayj[s] -= mi[s] * inv3 * dy;
+                azj[s] -= mi[s] * inv3 * dz;
+            }
+        }
+    }
+}
+
+// Function to add h times the second group of arrays to the first for every body of every lane
+void advance(AlignedVector& x, AlignedVector& y, AlignedVector& z, const AlignedVector& dx, const AlignedVector& dy, const AlignedVector& dz, double h) {
+    const std::size_t n = x.size();
+    #pragma omp simd
+    for (std::size_t k = 0; k < n; k++) {
+        x[k] += h * dx[k];
+        y[k] += h * dy[k];
+        z[k] += h * dz[k];
+    }
+}
+
+// Function to compute the softened total energy of every lane
+void energies(const Batch& b, double epsilon2, double* energy) {
+    const int w = b.width;
+    std::fill(energy, energy + w, 0.0);
+    for (int i = 0; i < b.bodies; i++) {
+        const int oi = i * w;
+        #pragma omp simd
+        for (int s = 0; s < w; s++) {
+            const double v2 = b.vx[oi + s] * b.vx[oi + s] + b.vy[oi + s] * b.vy[oi + s] + b.vz[oi + s] * b.vz[oi + s];
+            energy[s] += 0.5 * b.m[oi + s] * v2;
+        }
+        for (int j = i + 1; j < b.bodies; j++) {
+            const int oj = j * w;
+            #pragma omp simd
+            for (int s = 0; s < w; s++) {
+                const double dx = b.x[oj + s] - b.x[oi + s];
+                const double dy = b.y[oj + s] - b.y[oi + s];
+                const double dz = b.z[oj + s] - b.z[oi + s];
+                energy[s] -= b.m[oi + s] * b.m[oj + s] / std::sqrt(dx * dx + dy * dy + dz * dz + epsilon2);
+            }
+        }
+    }
+}
+
+}
+
+double EnsembleSummary::relativeEnergyError() const {
+    return std::abs((energy_end - energy_start) / energy_start);
+}
+
+std::uint64_t ensembleMemberSeed(std::uint64_t base_seed, long member) {
+    std::uint64_t z = base_seed + 0x9e3779b97f4a7c15ULL * (static_cast<std::uint64_t>(member) + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+EnsembleRunner::EnsembleRunner(MemberFactory make_member, double dt, double epsilon, int batch_width) :
+    make_member_(std::move(make_member)), dt_(dt), epsilon_(epsilon), batch_width_(batch_width)
+{
+    if (batch_width < 1) {
+        throw std::invalid_argument("The ensemble batch width must be at least 1");
+    }
+}
+
+void EnsembleRunner::run(long num_members, std::uint64_t base_seed, long steps, const SummarySink& sink) const {
+    if (num_members <= 0) {
+        return;
+    }
+    const int num_bodies = static_cast<int>(make_member_(ensembleMemberSeed(base_seed, 0)).size());
+    const long num_batches = (num_members + batch_width_ - 1) / batch_width_;
+    const double epsilon2 = epsilon_ * epsilon_;
+    // exceptions cannot leave the parallel region, the first one is kept and the remaining batches are skipped
+    std::exception_ptr failure;
+    std::atomic<bool> failed(false);
+    auto keep_failure = [&] {
+        #pragma omp critical(ensemble_failure)
+        if (!failure) {
+            failure = std::current_exception();
+        }
+        failed = true;
+    };
+
+    #pragma omp parallel
+    {
+        Batch batch;
+        batch.resize(num_bodies, batch_width_);
+        std::vector<double> energy_start(batch_width_), energy_end(batch_width_);
+        std::vector<std::uint64_t> seeds(batch_width_);
+        EnsembleSummary summary;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (long b = 0; b < num_batches; b++) {
+            if (failed) {
+                continue;
+            }
+            try {
+                const long first = b * batch_width_;
+                const int lanes = static_cast<int>(std::min<long>(batch_width_, num_members - first));
+                ParticleSystem member;
+                for (int s = 0; s < lanes; s++) {
+                    seeds[s] = ensembleMemberSeed(base_seed, first + s);
+                    member = make_member_(seeds[s]);
+                    if (static_cast<int>(member.size()) != num_bodies) {
+                        throw std::invalid_argument("Every ensemble member must have the same number of bodies");
+                    }
+                    batch.load(s, member);
+                }
+                // the lanes of a short last batch repeat its last member and are not reported
+                for (int s = lanes; s < batch_width_; s++) {
+                    batch.load(s, member);
+                }
+
+                energies(batch, epsilon2, energy_start.data());
+                accelerations(batch, epsilon2);
+                for (long step = 0; step < steps; step++) {
+                    advance(batch.vx, batch.vy, batch.vz, batch.ax, batch.ay, batch.az, 0.5 * dt_);
+                    advance(batch.x, batch.y, batch.z, batch.vx, batch.vy, batch.vz, dt_);
+                    accelerations(batch, epsilon2);
+                    advance(batch.vx, batch.vy, batch.vz, batch.ax, batch.ay, batch.az, 0.5 * dt_);
+                }
+                energies(batch, epsilon2, energy_end.data());
+
+                for (int s = 0; s < lanes; s++) {
+                    summary.member = first + s;
+                    summary.seed = seeds[s];
+                    summary.energy_start = energy_start[s];
+                    summary.energy_end = energy_end[s];
+                    summary.elements.resize(num_bodies > 0 ? num_bodies - 1 : 0);
+                    for (int i = 1; i < num_bodies; i++) {
+                        const int o = i * batch_width_ + s;
+                        const double position[3] = {batch.x[o] - batch.x[s], batch.y[o] - batch.y[s], batch.z[o] - batch.z[s]};
+                        const double velocity[3] = {batch.vx[o] - batch.vx[s], batch.vy[o] - batch.vy[s], batch.vz[o] - batch.vz[s]};
+                        summary.elements[i - 1] = orbitalElements(batch.m[s] + batch.m[o], position, velocity);
+                    }
+                    #pragma omp critical(ensemble_sink)
+                    {
+                        try {
+                            sink(summary);
+                        }
+                        catch (...) {
+                            keep_failure();
+                        }
+                    }
+                }
+            }
+            catch (...) {
+                keep_failure();
+            }
+        }
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
@@ -0,0 +1,59 @@
+#include "FixedSystem.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+enum class FixedScheme { Leapfrog, Yoshida4 };
+
+using AdvanceFunction = void (*)(ParticleSystem& system, FixedScheme scheme, double dt, long num_steps, double epsilon2);
+
+template <int N, class Masses>
+void advanceFixedSystem(ParticleSystem& system, FixedScheme scheme, double dt, long num_steps, double epsilon2) {
+    FixedSystem<N, Masses> fixed;
+    fixed.load(system);
+    fixed.computeAccelerations(epsilon2);
+    if (scheme == FixedScheme::Leapfrog) {
+        for (long step = 0; step < num_steps; step++) {
+            fixed.leapfrogStep(dt, epsilon2);
+        }
+    }
+    else {
+        for (long step = 0; step < num_steps; step++) {
+            fixed.yoshidaStep(dt, epsilon2);
+        }
+    }
+    fixed.store(system);
+}
+
+// Entry k runs systems of kMinFixedBodies + k bodies
+template <int... K>
+constexpr std::array<AdvanceFunction, sizeof...(K)> makeAdvanceTable(std::integer_sequence<int, K...>) {
+    return {&advanceFixedSystem<kMinFixedBodies + K, RuntimeMasses<kMinFixedBodies + K>>...};
+}
+
+constexpr auto kAdvanceTable = makeAdvanceTable(std::make_integer_sequence<int, kMaxFixedBodies - kMinFixedBodies + 1>());
+
+bool hasSolarMasses(const ParticleSystem& system) {
+    return system.size() == kSolarBodies && std::equal(kSolarMasses.begin(), kSolarMasses.end(), system.m.begin());
+}
+
+}
+
+bool hasFixedKernel(std::size_t num_bodies, const std::string& integrator) {
+    return num_bodies >= kMinFixedBodies && num_bodies <= kMaxFixedBodies && (integrator == "leapfrog" || integrator == "yoshida4");
+}
+
+void advanceFixed(ParticleSystem& system, const std::string& integrator, double dt, long num_steps, double epsilon) {
+    if (!hasFixedKernel(system.size(), integrator)) {
+        throw std::invalid_argument("The fixed-size kernels run 'leapfrog' or 'yoshida4' with " + std::to_string(kMinFixedBodies) + " to " +
+                                    std::to_string(kMaxFixedBodies) + " bodies, not '" + integrator + "' with " + std::to_string(system.size()));
+    }
+    const FixedScheme scheme = integrator == "leapfrog" ? FixedScheme::Leapfrog : FixedScheme::Yoshida4;
+    if (hasSolarMasses(system)) {
+        advanceFixedSystem<kSolarBodies, SolarMasses>(system, scheme, dt, num_steps, epsilon * epsilon);
+    }
+    else {
+        kAdvanceTable[system.size() - kMinFixedBodies](system, scheme, dt, num_steps, epsilon * epsilon);
+    }
+}
@@ -0,0 +1,533 @@
+#include "ForceKernel.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include "Profiler.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define NBODY_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Portable kernel, also used for the tails of the vector kernels. With Potential, acc[3] receives sum m_j / r
+template <bool Potential>
+void pointKernelScalar(const SourceArrays& s, double px, double py, double pz, double epsilon2, double* acc) {
+    double sx = 0.0, sy = 0.0, sz = 0.0, sp = 0.0;
+    #pragma omp simd reduction(+:sx, sy, sz, sp)
+    for (std::size_t j = 0; j < s.count; j++) {
+        double dx = s.x[j] - px;
+        double dy = s.y[j] - py;
+        double dz = s.z[j] - pz;
+        double d2 = dx * dx + dy * dy + dz * dz;
+        double r2 = d2 + epsilon2;
+        double w;
+        if constexpr (Potential) {
+            double mr = d2 > 0.0 ? s.m[j] / std::sqrt(r2) : 0.0;
+            w = mr / r2;
+            sp += mr;
+        }
+        else {
+            w = d2 > 0.0 ? s.m[j] / (r2 * std::sqrt(r2)) : 0.0;
+        }
+        sx += w * dx;
+        sy += w * dy;
+        sz += w * dz;
+    }
+    acc[0] = sx;
+    acc[1] = sy;
+    acc[2] = sz;
+    if constexpr (Potential) {
+        acc[3] = sp;
+    }
+}
+
+void pairRowScalar(const SourceArrays& s, std::size_t i, std::size_t begin, std::size_t end, double epsilon2, double* bx, double* by, double* bz) {
+    const double xi = s.x[i], yi = s.y[i], zi = s.z[i], mi = s.m[i];
+    double sx = 0.0, sy = 0.0, sz = 0.0;
+    #pragma omp simd reduction(+:sx, sy, sz)
+    for (std::size_t j = begin; j < end; j++) {
+        double dx = s.x[j] - xi;
+        double dy = s.y[j] - yi;
+        double dz = s.z[j] - zi;
+        double d2 = dx * dx + dy * dy + dz * dz;
+        double r2 = d2 + epsilon2;
+        // coincident bodies exert no force on each other, as in the point kernel
+        double inv3 = d2 > 0.0 ? 1.0 / (r2 * std::sqrt(r2)) : 0.0;
+        sx += s.m[j] * inv3 * dx;
+        sy += s.m[j] * inv3 * dy;
+        sz += s.m[j] * inv3 * dz;
+        bx[j] -= mi * inv3 * dx;
+        by[j] -= mi * inv3 * dy;
+        bz[j] -= mi * inv3 * dz;
+    }
+    bx[i] += sx;
+    by[i] += sy;
+    bz[i] += sz;
+}
+
+// Portable mixed precision kernel, also used for the tails of the AVX2 one
+void mixedKernelScalar(const SourceArraysFloat& s, float px, float py, float pz, float epsilon2, double* acc) {
+    double sx = 0.0, sy = 0.0, sz = 0.0;
+    for (std::size_t begin = 0; begin < s.count; begin += kMixedTile) {
+        const std::size_t end = std::min(begin + kMixedTile, s.count);
+        float tx = 0.0f, ty = 0.0f, tz = 0.0f;
+        #pragma omp simd reduction(+:tx, ty, tz)
+        for (std::size_t j = begin; j < end; j++) {
+            float dx = s.x[j] - px;
+            float dy = s.y[j] - py;
+            float dz = s.z[j] - pz;
+            float d2 = dx * dx + dy * dy + dz * dz;
+            float inv = 1.0f / std::sqrt(d2 + epsilon2);
+            float w = d2 > 0.0f ? s.m[j] * inv * inv * inv : 0.0f;
+            tx += w * dx;
+            ty += w * dy;
+            tz += w * dz;
+        }
+        sx += tx;
+        sy += ty;
+        sz += tz;
+    }
+    acc[0] = sx;
+    acc[1] = sy;
+    acc[2] = sz;
+}
+
+#ifdef NBODY_X86_KERNELS
+
+// 1/sqrt(r2) from the 12-bit single precision estimate, refined by three Newton steps to full double precision
+__attribute__((target("avx2,fma")))
+inline __m256d rsqrtAvx2(__m256d r2) {
+    __m128 r2f = _mm_max_ps(_mm256_cvtpd_ps(r2), _mm_set1_ps(FLT_MIN));
+    __m256d y = _mm256_cvtps_pd(_mm_rsqrt_ps(r2f));
+    const __m256d half_r2 = _mm256_mul_pd(_mm256_set1_pd(0.5), r2);
+    const __m256d three_halves = _mm256_set1_pd(1.5);
+    for (int k = 0; k < 3; k++) {
+        y = _mm256_mul_pd(y, _mm256_fnmadd_pd(half_r2, _mm256_mul_pd(y, y), three_halves));
+    }
+    return y;
+}
+
+template <bool Potential>
+__attribute__((target("avx2,fma")))
+void pointKernelAvx2(const SourceArrays& s, double px, double py, double pz, double epsilon2, double* acc) {
+    const __m256d vpx = _mm256_set1_pd(px);
+    const __m256d vpy = _mm256_set1_pd(py);
+    const __m256d vpz = _mm256_set1_pd(pz);
+    const __m256d veps2 = _mm256_set1_pd(epsilon2);
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d sx = zero, sy = zero, sz = zero, sp = zero;
+
+    std::size_t j = 0;
+    for (; j + 4 <= s.count; j += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(s.x + j), vpx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(s.y + j), vpy);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(s.z + j), vpz);
+        __m256d d2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dz, dz)));
+        __m256d inv = rsqrtAvx2(_mm256_add_pd(d2, veps2));
+        __m256d w = _mm256_mul_pd(_mm256_loadu_pd(s.m + j), _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv)));
+        const __m256d outside = _mm256_cmp_pd(d2, zero, _CMP_GT_OQ);
+        w = _mm256_and_pd(w, outside);
+        sx = _mm256_fmadd_pd(w, dx, sx);
+        sy = _mm256_fmadd_pd(w, dy, sy);
+        sz = _mm256_fmadd_pd(w, dz, sz);
+        if constexpr (Potential) {
+            sp = _mm256_add_pd(sp, _mm256_and_pd(_mm256_mul_pd(_mm256_loadu_pd(s.m + j), inv), outside));
+        }
+    }
+
+    constexpr int components = Potential ? 4 : 3;
+    alignas(32) double lanes[4][4];
+    _mm256_store_pd(lanes[0], sx);
+    _mm256_store_pd(lanes[1], sy);
+    _mm256_store_pd(lanes[2], sz);
+    _mm256_store_pd(lanes[3], sp);
+
+    SourceArrays tail{s.x + j, s.y + j, s.z + j, s.m + j, s.count - j};
+    pointKernelScalar<Potential>(tail, px, py, pz, epsilon2, acc);
+    for (int c = 0; c < components; c++) {
+        acc[c] += (lanes[c][0] + lanes[c][1]) + (lanes[c][2] + lanes[c][3]);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void pairRowAvx2(const SourceArrays& s, std::size_t i, std::size_t begin, std::size_t end, double epsilon2, double* bx, double* by, double* bz) {
+    const __m256d vxi = _mm256_set1_pd(s.x[i]);
+    const __m256d vyi = _mm256_set1_pd(s.y[i]);
+    const __m256d vzi = _mm256_set1_pd(s.z[i]);
+    const __m256d vmi = _mm256_set1_pd(s.m[i]);
+    const __m256d veps2 = _mm256_set1_pd(epsilon2);
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d sx = zero, sy = zero, sz = zero;
+
+    std::size_t j = begin;
+    for (; j + 4 <= end; j += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(s.x + j), vxi);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(s.y + j), vyi);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(s.z + j), vzi);
+        __m256d d2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dz, dz)));
+        __m256d inv = rsqrtAvx2(_mm256_add_pd(d2, veps2));
+        __m256d inv3 = _mm256_and_pd(_mm256_mul_pd(inv, _mm256_mul_pd(inv, inv)), _mm256_cmp_pd(d2, zero, _CMP_GT_OQ));
+        __m256d wj = _mm256_mul_pd(_mm256_loadu_pd(s.m + j), inv3);
+        __m256d wi = _mm256_mul_pd(vmi, inv3);
+        sx = _mm256_fmadd_pd(wj, dx, sx);
+        sy = _mm256_fmadd_pd(wj, dy, sy);
+        sz = _mm256_fmadd_pd(wj, dz, sz);
+        _mm256_storeu_pd(bx + j, _mm256_fnmadd_pd(wi, dx, _mm256_loadu_pd(bx + j)));
+        _mm256_storeu_pd(by + j, _mm256_fnmadd_pd(wi, dy, _mm256_loadu_pd(by + j)));
+        _mm256_storeu_pd(bz + j, _mm256_fnmadd_pd(wi, dz, _mm256_loadu_pd(bz + j)));
+    }
+
+    alignas(32) double lanes[3][4];
+    _mm256_store_pd(lanes[0], sx);
+    _mm256_store_pd(lanes[1], sy);
+    _mm256_store_pd(lanes[2], sz);
+    bx[i] += (lanes[0][0] + lanes[0][1]) + (lanes[0][2] + lanes[0][3]);
+    by[i] += (lanes[1][0] + lanes[1][1]) + (lanes[1][2] + lanes[1][3]);
+    bz[i] += (lanes[2][0] + lanes[2][1]) + (lanes[2][2] + lanes[2][3]);
+
+    // Scalar tail for the last end - j < 4 bodies
+    for (; j < end; j++) {
+        double dx = s.x[j] - s.x[i];
+        double dy = s.y[j] - s.y[i];
+        double dz = s.z[j] - s.z[i];
+        double d2 = dx * dx + dy * dy + dz * dz;
+        double r2 = d2 + epsilon2;
+        double inv3 = d2 > 0.0 ? 1.0 / (r2 * std::sqrt(r2)) : 0.0;
+        bx[i] += s.m[j] * inv3 * dx;
+        by[i] += s.m[j] * inv3 * dy;
+        bz[i] += s.m[j] * inv3 * dz;
+        bx[j] -= s.m[i] * inv3 * dx;
+        by[j] -= s.m[i] * inv3 * dy;
+        bz[j] -= s.m[i] * inv3 * dz;
+    }
+}
+
+// 12-bit single precision estimate and one Newton step, about 23 bits
+__attribute__((target("avx2,fma")))
+inline __m256 rsqrtAvx2Float(__m256 r2) {
+    __m256 y = _mm256_rsqrt_ps(r2);
+    const __m256 half_r2 = _mm256_mul_ps(_mm256_set1_ps(0.5f), r2);
+    return _mm256_mul_ps(y, _mm256_fnmadd_ps(half_r2, _mm256_mul_ps(y, y), _mm256_set1_ps(1.5f)));
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256d addWidened(__m256d sum, __m256 partial) {
+    return _mm256_add_pd(_mm256_add_pd(sum, _mm256_cvtps_pd(_mm256_castps256_ps128(partial))), _mm256_cvtps_pd(_mm256_extractf128_ps(partial, 1)));
+}
+
+__attribute__((target("avx2,fma")))
+void mixedKernelAvx2(const SourceArraysFloat& s, float px, float py, float pz, float epsilon2, double* acc) {
+    const __m256 vpx = _mm256_set1_ps(px);
+    const __m256 vpy = _mm256_set1_ps(py);
+    const __m256 vpz = _mm256_set1_ps(pz);
+    const __m256 veps2 = _mm256_set1_ps(epsilon2);
+    const __m256 zero = _mm256_setzero_ps();
+    __m256d sx = _mm256_setzero_pd(), sy = _mm256_setzero_pd(), sz = _mm256_setzero_pd();
+
+    const std::size_t vector_end = s.count - s.count % 8;
+    for (std::size_t begin = 0; begin < vector_end; begin += kMixedTile) {
+        const std::size_t end = std::min(begin + kMixedTile, vector_end);
+        __m256 tx = zero, ty = zero, tz = zero;
+        for (std::size_t j = begin; j < end; j += 8) {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(s.x + j), vpx);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(s.y + j), vpy);
+            __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(s.z + j), vpz);
+            __m256 d2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+            __m256 inv = rsqrtAvx2Float(_mm256_add_ps(d2, veps2));
+            __m256 w = _mm256_mul_ps(_mm256_loadu_ps(s.m + j), _mm256_mul_ps(inv, _mm256_mul_ps(inv, inv)));
+            w = _mm256_and_ps(w, _mm256_cmp_ps(d2, zero, _CMP_GT_OQ));
+            tx = _mm256_fmadd_ps(w, dx, tx);
+            ty = _mm256_fmadd_ps(w, dy, ty);
+            tz = _mm256_fmadd_ps(w, dz, tz);
+        }
+        sx = addWidened(sx, tx);
+        sy = addWidened(sy, ty);
+        sz = addWidened(sz, tz);
+    }
+
+    alignas(32) double lanes[3][4];
+    _mm256_store_pd(lanes[0], sx);
+    _mm256_store_pd(lanes[1], sy);
+    _mm256_store_pd(lanes[2], sz);
+
+    SourceArraysFloat tail{s.x + vector_end, s.y + vector_end, s.z + vector_end, s.m + vector_end, s.count - vector_end};
+    mixedKernelScalar(tail, px, py, pz, epsilon2, acc);
+    for (int c = 0; c < 3; c++) {
+        acc[c] += (lanes[c][0] + lanes[c][1]) + (lanes[c][2] + lanes[c][3]);
+    }
+}
+
+// GCC 12's avx512fintrin.h starts some intrinsics from an uninitialised __Y, a false (maybe-)uninitialized warning
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// 14-bit estimate, two Newton steps
+__attribute__((target("avx512f")))
+inline __m512d rsqrtAvx512(__m512d r2) {
+    const __m512d half_r2 = _mm512_mul_pd(_mm512_set1_pd(0.5), r2);
+    const __m512d three_halves = _mm512_set1_pd(1.5);
+    __m512d y = _mm512_rsqrt14_pd(r2);
+    y = _mm512_mul_pd(y, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(y, y), three_halves));
+    y = _mm512_mul_pd(y, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(y, y), three_halves));
+    return y;
+}
+
+template <bool Potential>
+__attribute__((target("avx512f")))
+void pointKernelAvx512(const SourceArrays& s, double px, double py, double pz, double epsilon2, double* acc) {
+    const __m512d vpx = _mm512_set1_pd(px);
+    const __m512d vpy = _mm512_set1_pd(py);
+    const __m512d vpz = _mm512_set1_pd(pz);
+    const __m512d veps2 = _mm512_set1_pd(epsilon2);
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d sx = zero, sy = zero, sz = zero, sp = zero;
+
+    for (std::size_t j = 0; j < s.count; j += 8) {
+        // The last block is handled with a masked load instead of a scalar tail
+        std::size_t remaining = s.count - j;
+        __mmask8 lanes = remaining >= 8 ? __mmask8(0xFF) : __mmask8((1u << remaining) - 1);
+        __m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.x + j), vpx);
+        __m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.y + j), vpy);
+        __m512d dz = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.z + j), vpz);
+        __m512d d2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz)));
+        __m512d inv = rsqrtAvx512(_mm512_add_pd(d2, veps2));
+
+        __mmask8 active = _mm512_mask_cmp_pd_mask(lanes, d2, zero, _CMP_GT_OQ);
+        __m512d w = _mm512_maskz_mul_pd(active, _mm512_maskz_loadu_pd(lanes, s.m + j), _mm512_mul_pd(inv, _mm512_mul_pd(inv, inv)));
+        sx = _mm512_fmadd_pd(w, dx, sx);
+        sy = _mm512_fmadd_pd(w, dy, sy);
+        sz = _mm512_fmadd_pd(w, dz, sz);
+        if constexpr (Potential) {
+            sp = _mm512_add_pd(sp, _mm512_maskz_mul_pd(active, _mm512_maskz_loadu_pd(lanes, s.m + j), inv));
+        }
+    }
+
+    acc[0] = _mm512_reduce_add_pd(sx);
+    acc[1] = _mm512_reduce_add_pd(sy);
+    acc[2] = _mm512_reduce_add_pd(sz);
+    if constexpr (Potential) {
+        acc[3] = _mm512_reduce_add_pd(sp);
+    }
+}
+
+__attribute__((target("avx512f")))
+void pairRowAvx512(const SourceArrays& s, std::size_t i, std::size_t begin, std::size_t end, double epsilon2, double* bx, double* by, double* bz) {
+    const __m512d vxi = _mm512_set1_pd(s.x[i]);
+    const __m512d vyi = _mm512_set1_pd(s.y[i]);
+    const __m512d vzi = _mm512_set1_pd(s.z[i]);
+    const __m512d vmi = _mm512_set1_pd(s.m[i]);
+    const __m512d veps2 = _mm512_set1_pd(epsilon2);
+    __m512d sx = _mm512_setzero_pd(), sy = _mm512_setzero_pd(), sz = _mm512_setzero_pd();
+
+    for (std::size_t j = begin; j < end; j += 8) {
+        std::size_t remaining = end - j;
+        __mmask8 lanes = remaining >= 8 ? __mmask8(0xFF) : __mmask8((1u << remaining) - 1);
+        __m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.x + j), vxi);
+        __m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.y + j), vyi);
+        __m512d dz = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, s.z + j), vzi);
+        __m512d d2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz)));
+        __m512d inv = rsqrtAvx512(_mm512_add_pd(d2, veps2));
+        __mmask8 active = _mm512_mask_cmp_pd_mask(lanes, d2, _mm512_setzero_pd(), _CMP_GT_OQ);
+        __m512d inv3 = _mm512_maskz_mul_pd(active, inv, _mm512_mul_pd(inv, inv));
+        __m512d wj = _mm512_mul_pd(_mm512_maskz_loadu_pd(lanes, s.m + j), inv3);
+        __m512d wi = _mm512_mul_pd(vmi, inv3);
+        sx = _mm512_fmadd_pd(wj, dx, sx);
+        sy = _mm512_fmadd_pd(wj, dy, sy);
+        sz = _mm512_fmadd_pd(wj, dz, sz);
+        _mm512_mask_storeu_pd(bx + j, lanes, _mm512_fnmadd_pd(wi, dx, _mm512_maskz_loadu_pd(lanes, bx + j)));
+        _mm512_mask_storeu_pd(by + j, lanes, _mm512_fnmadd_pd(wi, dy, _mm512_maskz_loadu_pd(lanes, by + j)));
+        _mm512_mask_storeu_pd(bz + j, lanes, _mm512_fnmadd_pd(wi, dz, _mm512_maskz_loadu_pd(lanes, bz + j)));
+    }
+
+    bx[i] += _mm512_reduce_add_pd(sx);
+    by[i] += _mm512_reduce_add_pd(sy);
+    bz[i] += _mm512_reduce_add_pd(sz);
+}
+
+// 14-bit estimate and one Newton step, full single precision
+__attribute__((target("avx512f")))
+inline __m512 rsqrtAvx512Float(__m512 r2) {
+    __m512 y = _mm512_rsqrt14_ps(r2);
+    const __m512 half_r2 = _mm512_mul_ps(_mm512_set1_ps(0.5f), r2);
+    return _mm512_mul_ps(y, _mm512_fnmadd_ps(half_r2, _mm512_mul_ps(y, y), _mm512_set1_ps(1.5f)));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d addWidened(__m512d sum, __m512 partial) {
+    const __m256 low = _mm512_castps512_ps256(partial);
+    const __m256 high = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(partial), 1));
+    return _mm512_add_pd(_mm512_add_pd(sum, _mm512_cvtps_pd(low)), _mm512_cvtps_pd(high));
+}
+
+__attribute__((target("avx512f")))
+void mixedKernelAvx512(const SourceArraysFloat& s, float px, float py, float pz, float epsilon2, double* acc) {
+    const __m512 vpx = _mm512_set1_ps(px);
+    const __m512 vpy = _mm512_set1_ps(py);
+    const __m512 vpz = _mm512_set1_ps(pz);
+    const __m512 veps2 = _mm512_set1_ps(epsilon2);
+    const __m512 zero = _mm512_setzero_ps();
+    __m512d sx = _mm512_setzero_pd(), sy = _mm512_setzero_pd(), sz = _mm512_setzero_pd();
+
+    for (std::size_t begin = 0; begin < s.count; begin += kMixedTile) {
+        const std::size_t end = std::min(begin + kMixedTile, s.count);
+        __m512 tx = zero, ty = zero, tz = zero;
+        for (std::size_t j = begin; j < end; j += 16) {
+            // The last block is handled with a masked load instead of a scalar tail
+            std::size_t remaining = end - j;
+            __mmask16 lanes = remaining >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << remaining) - 1);
+            __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, s.x + j), vpx);
+            __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, s.y + j), vpy);
+            __m512 dz = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, s.z + j), vpz);
+            __m512 d2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz)));
+            __m512 inv = rsqrtAvx512Float(_mm512_add_ps(d2, veps2));
+            __mmask16 active = _mm512_mask_cmp_ps_mask(lanes, d2, zero, _CMP_GT_OQ);
+            __m512 w = _mm512_maskz_mul_ps(active, _mm512_maskz_loadu_ps(lanes, s.m + j), _mm512_mul_ps(inv, _mm512_mul_ps(inv, inv)));
+            tx = _mm512_fmadd_ps(w, dx, tx);
+            ty = _mm512_fmadd_ps(w, dy, ty);
+            tz = _mm512_fmadd_ps(w, dz, tz);
+        }
+        sx = addWidened(sx, tx);
+        sy = addWidened(sy, ty);
+        sz = addWidened(sz, tz);
+    }
+
+    acc[0] = _mm512_reduce_add_pd(sx);
+    acc[1] = _mm512_reduce_add_pd(sy);
+    acc[2] = _mm512_reduce_add_pd(sz);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+}
+
+// Function to find the widest instruction set supported by both this build and the running CPU
+SimdLevel detectSimdLevel() {
+#ifdef NBODY_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "avx512";
+        case SimdLevel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+PointKernel selectKernel(SimdLevel level) {
+#ifdef NBODY_X86_KERNELS
+    if (level == SimdLevel::AVX512) {
+        return pointKernelAvx512<false>;
+    }
+    if (level == SimdLevel::AVX2) {
+        return pointKernelAvx2<false>;
+    }
+#endif
+    return pointKernelScalar<false>;
+}
+
+PointKernel selectPotentialKernel(SimdLevel level) {
+#ifdef NBODY_X86_KERNELS
+    if (level == SimdLevel::AVX512) {
+        return pointKernelAvx512<true>;
+    }
+    if (level == SimdLevel::AVX2) {
+        return pointKernelAvx2<true>;
+    }
+#endif
+    return pointKernelScalar<true>;
+}
+
+PairRowKernel selectPairRowKernel(SimdLevel level) {
+#ifdef NBODY_X86_KERNELS
+    if (level == SimdLevel::AVX512) {
+        return pairRowAvx512;
+    }
+    if (level == SimdLevel::AVX2) {
+        return pairRowAvx2;
+    }
+#endif
+    return pairRowScalar;
+}
+
+MixedPointKernel selectMixedKernel(SimdLevel level) {
+#ifdef NBODY_X86_KERNELS
+    if (level == SimdLevel::AVX512) {
+        return mixedKernelAvx512;
+    }
+    if (level == SimdLevel::AVX2) {
+        return mixedKernelAvx2;
+    }
+#endif
+    return mixedKernelScalar;
+}
+
+SourceArrays sourceArrays(const ParticleSystem& system) {
+    return SourceArrays{system.x.data(), system.y.data(), system.z.data(), system.m.data(), system.numMassive()};
+}
+
+void computeAccelerations(ParticleSystem& system, double epsilon) {
+    static const SimdLevel level = detectSimdLevel();
+    computeAccelerations(system, epsilon, level);
+}
+
+void computeAccelerations(ParticleSystem& system, double epsilon, SimdLevel level) {
+    const SourceArrays sources = sourceArrays(system);
+    const PointKernel kernel = selectKernel(level);
+    const double epsilon2 = epsilon * epsilon;
+    const int n = static_cast<int>(system.size());
+
+    PROFILE_COUNT(PairInteractions, sources.count * (n - 1));
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE(ForceLoop);
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < n; i++) {
+            double acc[3];
+            kernel(sources, system.x[i], system.y[i], system.z[i], epsilon2, acc);
+            system.ax[i] = acc[0];
+            system.ay[i] = acc[1];
+            system.az[i] = acc[2];
+        }
+    }
+}
+
+void computeAccelerationsAndPotential(ParticleSystem& system, double epsilon, double* potential) {
+    static const PointKernel kernel = selectPotentialKernel(detectSimdLevel());
+    const SourceArrays sources = sourceArrays(system);
+    const double epsilon2 = epsilon * epsilon;
+    const int n = static_cast<int>(system.size());
+
+    PROFILE_COUNT(PairInteractions, sources.count * (n - 1));
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE(ForceLoop);
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < n; i++) {
+            double acc[4];
+            kernel(sources, system.x[i], system.y[i], system.z[i], epsilon2, acc);
+            system.ax[i] = acc[0];
+            system.ay[i] = acc[1];
+            system.az[i] = acc[2];
+            potential[i] = -acc[3];
+        }
+    }
+}
@@ -0,0 +1,273 @@
+#include "ForceSolver.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <omp.h>
+#include "BarnesHutSolver.hpp"
+#include "ForceKernel.hpp"
+#include "Integrator.hpp"
+#include "Profiler.hpp"
+
+void ForceSolver::computeActiveAccelerations(ParticleSystem& system, const std::vector<int>& /*active*/, double epsilon) {
+    computeAccelerations(system, epsilon);
+}
+
+void ForceSolver::reserve(std::size_t /*num_particles*/) {}
+
+void ForceSolver::setComputePotential(bool enable) {
+    compute_potential_ = enable;
+    potential_available_ = false;
+}
+
+bool ForceSolver::potentialAvailable() const {
+    return potential_available_;
+}
+
+const AlignedVector& ForceSolver::potential() const {
+    return potential_;
+}
+
+void DirectSolver::computeAccelerations(ParticleSystem& system, double epsilon) {
+    if (compute_potential_) {
+        potential_.resize(system.size());
+        computeAccelerationsAndPotential(system, epsilon, potential_.data());
+        potential_available_ = true;
+    }
+    else {
+        ::computeAccelerations(system, epsilon);
+    }
+}
+
+void DirectSolver::reserve(std::size_t num_particles) {
+    potential_.reserve(num_particles);
+}
+
+void DirectSolver::computeActiveAccelerations(ParticleSystem& system, const std::vector<int>& active, double epsilon) {
+    static const PointKernel kernel = selectKernel(detectSimdLevel());
+    const SourceArrays sources = sourceArrays(system);
+    const double epsilon2 = epsilon * epsilon;
+    const int n = static_cast<int>(active.size());
+    potential_available_ = false;
+
+    PROFILE_COUNT(PairInteractions, static_cast<std::uint64_t>(n) * sources.count);
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE(ForceLoop);
+        #pragma omp for schedule(static) nowait
+        for (int k = 0; k < n; k++) {
+            const int i = active[k];
+            double acc[3];
+            kernel(sources, system.x[i], system.y[i], system.z[i], epsilon2, acc);
+            system.ax[i] = acc[0];
+            system.ay[i] = acc[1];
+            system.az[i] = acc[2];
+        }
+    }
+}
+
+void MixedPrecisionSolver::convert(const ParticleSystem& system) {
+    const int n = static_cast<int>(system.size());
+    x_.resize(n);
+    y_.resize(n);
+    z_.resize(n);
+    m_.resize(n);
+    double lo[3] = {0.0, 0.0, 0.0}, hi[3] = {0.0, 0.0, 0.0};
+    if (n > 0) {
+        lo[0] = hi[0] = system.x[0];
+        lo[1] = hi[1] = system.y[0];
+        lo[2] = hi[2] = system.z[0];
+    }
+    #pragma omp parallel for reduction(min:lo[:3]) reduction(max:hi[:3])
+    for (int i = 0; i < n; i++) {
+        lo[0] = std::min(lo[0], system.x[i]);
+        lo[1] = std::min(lo[1], system.y[i]);
+        lo[2] = std::min(lo[2], system.z[i]);
+        hi[0] = std::max(hi[0], system.x[i]);
+        hi[1] = std::max(hi[1], system.y[i]);
+        hi[2] = std::max(hi[2], system.z[i]);
+    }
+    // the reference point, near which float positions are finest
+    const double cx = 0.5 * (lo[0] + hi[0]);
+    const double cy = 0.5 * (lo[1] + hi[1]);
+    const double cz = 0.5 * (lo[2] + hi[2]);
+
+    #pragma omp parallel for simd
+    for (int i = 0; i < n; i++) {
+        x_[i] = static_cast<float>(system.x[i] - cx);
+        y_[i] = static_cast<float>(system.y[i] - cy);
+        z_[i] = static_cast<float>(system.z[i] - cz);
+        m_[i] = static_cast<float>(system.m[i]);
+    }
+}
+
+void MixedPrecisionSolver::computeAccelerations(ParticleSystem& system, double epsilon) {
+    static const MixedPointKernel kernel = selectMixedKernel(detectSimdLevel());
+    convert(system);
+    const SourceArraysFloat sources{x_.data(), y_.data(), z_.data(), m_.data(), system.numMassive()};
+    const float epsilon2 = static_cast<float>(epsilon * epsilon);
+    const int n = static_cast<int>(system.size());
+    potential_available_ = false;
+
+    PROFILE_COUNT(PairInteractions, sources.count * (n - 1));
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE(ForceLoop);
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < n; i++) {
+            double acc[3];
+            kernel(sources, x_[i], y_[i], z_[i], epsilon2, acc);
+            system.ax[i] = acc[0];
+            system.ay[i] = acc[1];
+            system.az[i] = acc[2];
+        }
+    }
+}
+
+void MixedPrecisionSolver::computeActiveAccelerations(ParticleSystem& system, const std::vector<int>& active, double epsilon) {
+    static const MixedPointKernel kernel = selectMixedKernel(detectSimdLevel());
+    convert(system);
+    const SourceArraysFloat sources{x_.data(), y_.data(), z_.data(), m_.data(), system.numMassive()};
+    const float epsilon2 = static_cast<float>(epsilon * epsilon);
+    const int n = static_cast<int>(active.size());
+    potential_available_ = false;
+
+    PROFILE_COUNT(PairInteractions, static_cast<std::uint64_t>(n) * sources.count);
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE(ForceLoop);
+        #pragma omp for schedule(static) nowait
+        for (int k = 0; k < n; k++) {
+            const int i = active[k];
+            double acc[3];
+            kernel(sources, x_[i], y_[i], z_[i], epsilon2, acc);
+            system.ax[i] = acc[0];
+            system.ay[i] = acc[1];
+            system.az[i] = acc[2];
+        }
+    }
+}
+
+void MixedPrecisionSolver::reserve(std::size_t num_particles) {
+    x_.reserve(num_particles);
+    y_.reserve(num_particles);
+    z_.reserve(num_particles);
+    m_.reserve(num_particles);
+}
+
+PairwiseSolver::PairwiseSolver(int tile) : tile_(tile) {
+    if (tile < 1) {
+        throw std::invalid_argument("The pair tile must hold at least one body, not " + std::to_string(tile));
+    }
+}
+
+void PairwiseSolver::computeAccelerations(ParticleSystem& system, double epsilon) {
+    const int num_bodies = static_cast<int>(system.size());
+    const double epsilon2 = epsilon * epsilon;
+    const SourceArrays bodies = sourceArrays(system);
+    // the pairs run over the massive bodies, the test particles take the point kernel
+    const int n = static_cast<int>(bodies.count);
+    static const PairRowKernel row = selectPairRowKernel(detectSimdLevel());
+    static const PointKernel point = selectKernel(detectSimdLevel());
+
+    buffers_.resize(omp_get_max_threads());
+    for (AlignedVector& buffer : buffers_) {
+        buffer.resize(3 * static_cast<std::size_t>(n));
+    }
+
+    PROFILE_COUNT(PairInteractions, bodies.count * (num_bodies - 1));
+    #pragma omp parallel
+    {
+        const int num_threads = omp_get_num_threads();
+        double* bx = buffers_[omp_get_thread_num()].data();
+        double* by = bx + n;
+        double* bz = by + n;
+        std::fill(bx, bx + 3 * static_cast<std::size_t>(n), 0.0);
+
+        // The upper triangle is cut into square tiles so the reaction buffers of a column tile stay
+        // in L1 while every row of the row tile streams past them. Row tiles k and last - k together
+        // cover the same number of tiles, so a static schedule is balanced.
+        const int tiles = (n + tile_ - 1) / tile_;
+        auto row_tile = [&](int tile) {
+            const int row_begin = tile * tile_;
+            const int row_end = std::min(row_begin + tile_, n);
+            for (int col_begin = row_begin; col_begin < n; col_begin += tile_) {
+                const int col_end = std::min(col_begin + tile_, n);
+                for (int i = row_begin; i < row_end; i++) {
+                    const int begin = std::max(col_begin, i + 1);
+                    if (begin < col_end) {
+                        row(bodies, i, begin, col_end, epsilon2, bx, by, bz);
+                    }
+                }
+            }
+        };
+
+        {
+            PROFILE_SCOPE(ForceLoop);
+            #pragma omp for schedule(static) nowait
+            for (int k = 0; k < (tiles + 1) / 2; k++) {
+                row_tile(k);
+                if (tiles - 1 - k != k) {
+                    row_tile(tiles - 1 - k);
+                }
+            }
+            #pragma omp for schedule(static) nowait
+            for (int i = n; i < num_bodies; i++) {
+                double acc[3];
+                point(bodies, system.x[i], system.y[i], system.z[i], epsilon2, acc);
+                system.ax[i] = acc[0];
+                system.ay[i] = acc[1];
+                system.az[i] = acc[2];
+            }
+        }
+        #pragma omp barrier
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            double sx = 0.0, sy = 0.0, sz = 0.0;
+            for (int t = 0; t < num_threads; t++) {
+                const double* b = buffers_[t].data();
+                sx += b[i];
+                sy += b[n + i];
+                sz += b[2 * n + i];
+            }
+            system.ax[i] = sx;
+            system.ay[i] = sy;
+            system.az[i] = sz;
+        }
+    }
+}
+
+void PairwiseSolver::reserve(std::size_t num_particles) {
+    buffers_.resize(omp_get_max_threads());
+    for (AlignedVector& buffer : buffers_) {
+        buffer.reserve(3 * num_particles);
+    }
+}
+
+std::unique_ptr<ForceSolver> makeForceSolver(const SolverConfig& config) {
+    if (config.precision == "mixed") {
+        if (config.name != "direct") {
+            throw std::invalid_argument("Mixed precision is available for the direct solver only, not '" + config.name + "'");
+        }
+        return std::make_unique<MixedPrecisionSolver>();
+    }
+    if (config.precision != "double") {
+        throw std::invalid_argument("Unknown precision '" + config.precision + "', expected 'double' or 'mixed'");
+    }
+    if (config.name == "direct") {
+        return std::make_unique<DirectSolver>();
+    }
+    if (config.name == "pairwise") {
+        return std::make_unique<PairwiseSolver>(config.tile);
+    }
+    if (config.name == "bh") {
+        return std::make_unique<BarnesHutSolver>(config.theta, config.quadrupole, config.leaf_size, config.chunk);
+    }
+    throw std::invalid_argument("Unknown solver '" + config.name + "', expected 'direct', 'pairwise' or 'bh'");
+}
+
+// Function to evolve a structure-of-arrays system in place with accelerations from any solver
+void evolution_Solar_System(ParticleSystem& system, ForceSolver& solver, double dt, int time_steps, double epsilon) {
+    EulerIntegrator integrator;
+    evolution_Solar_System(system, solver, integrator, dt, time_steps, epsilon);
+}
@@ -0,0 +1,236 @@
+#include "Integrator.hpp"
+#include <cmath>
+#include <stdexcept>
+#include "BlockTimestepIntegrator.hpp"
+#include "Profiler.hpp"
+#include "WisdomHolmanIntegrator.hpp"
+
+void Integrator::kick(ParticleSystem& system, double h) {
+    PROFILE_SCOPE(Kick);
+    const int n = static_cast<int>(system.size());
+    double* vx = system.vx.data();
+    double* vy = system.vy.data();
+    double* vz = system.vz.data();
+    const double* ax = system.ax.data();
+    const double* ay = system.ay.data();
+    const double* az = system.az.data();
+
+    #pragma omp parallel for simd
+    for (int k = 0; k < n; k++) {
+        vx[k] += h * ax[k];
+        vy[k] += h * ay[k];
+        vz[k] += h * az[k];
+    }
+}
+
+void Integrator::drift(ParticleSystem& system, double h) {
+    PROFILE_SCOPE(Drift);
+    const int n = static_cast<int>(system.size());
+    double* x = system.x.data();
+    double* y = system.y.data();
+    double* z = system.z.data();
+    const double* vx = system.vx.data();
+    const double* vy = system.vy.data();
+    const double* vz = system.vz.data();
+
+    #pragma omp parallel for simd
+    for (int k = 0; k < n; k++) {
+        x[k] += h * vx[k];
+        y[k] += h * vy[k];
+        z[k] += h * vz[k];
+    }
+}
+
+void Integrator::reset() {
+    cached_system_ = nullptr;
+}
+
+void Integrator::reserve(std::size_t /*num_particles*/) {}
+
+bool Integrator::forcesCurrent(const ParticleSystem& system) const {
+    return cached_system_ == &system && cached_size_ == system.size();
+}
+
+// The base state is whether the accelerations in the arrays are current, so a restart can skip their evaluation
+void Integrator::saveState(const ParticleSystem& system, std::vector<double>& state) const {
+    state.push_back(forcesCurrent(system) ? 1.0 : 0.0);
+}
+
+void Integrator::restoreState(ParticleSystem& system, const ForceSolver& solver, double epsilon, const std::vector<double>& state, std::size_t& pos) {
+    reset();
+    if (readState(state, pos) != 0.0) {
+        adoptForces(system, solver, epsilon);
+    }
+}
+
+void Integrator::adoptForces(const ParticleSystem& system, const ForceSolver& solver, double epsilon) {
+    cached_system_ = &system;
+    cached_solver_ = &solver;
+    cached_size_ = system.size();
+    cached_epsilon_ = epsilon;
+}
+
+void Integrator::appendState(std::vector<double>& state, const AlignedVector& array) {
+    state.insert(state.end(), array.begin(), array.end());
+}
+
+double Integrator::readState(const std::vector<double>& state, std::size_t& pos) {
+    if (pos >= state.size()) {
+        throw std::invalid_argument("The saved integrator state is too short, it may belong to a different integrator");
+    }
+    return state[pos++];
+}
+
+void Integrator::readState(const std::vector<double>& state, std::size_t& pos, AlignedVector& array, std::size_t count) {
+    if (count > state.size() - pos) {
+        throw std::invalid_argument("The saved integrator state is too short, it may belong to a different integrator");
+    }
+    array.assign(state.begin() + pos, state.begin() + pos + count);
+    pos += count;
+}
+
+long Integrator::forceEvaluations() const {
+    return force_evaluations_;
+}
+
+long Integrator::bodyForceEvaluations() const {
+    return body_force_evaluations_;
+}
+
+void Integrator::computeForces(ParticleSystem& system, ForceSolver& solver, double epsilon) {
+    PROFILE_SCOPE(Force);
+    solver.computeAccelerations(system, epsilon);
+    force_evaluations_++;
+    body_force_evaluations_ += static_cast<long>(system.size());
+    cached_system_ = &system;
+    cached_solver_ = &solver;
+    cached_size_ = system.size();
+    cached_epsilon_ = epsilon;
+}
+
+// Only the accelerations of the active bodies are fresh afterwards, so nothing is cached
+void Integrator::computeForces(ParticleSystem& system, const std::vector<int>& active, ForceSolver& solver, double epsilon) {
+    PROFILE_SCOPE(Force);
+    solver.computeActiveAccelerations(system, active, epsilon);
+    force_evaluations_++;
+    body_force_evaluations_ += static_cast<long>(active.size());
+    cached_system_ = nullptr;
+}
+
+void Integrator::ensureForces(ParticleSystem& system, ForceSolver& solver, double epsilon) {
+    if (cached_system_ != &system || cached_solver_ != &solver || cached_size_ != system.size() || cached_epsilon_ != epsilon) {
+        computeForces(system, solver, epsilon);
+    }
+}
+
+std::string EulerIntegrator::name() const {
+    return "euler";
+}
+
+void EulerIntegrator::step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) {
+    computeForces(system, solver, epsilon);
+    drift(system, dt);
+    kick(system, dt);
+    // the accelerations now lag behind the positions
+    reset();
+}
+
+std::string LeapfrogIntegrator::name() const {
+    return "leapfrog";
+}
+
+void LeapfrogIntegrator::step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) {
+    ensureForces(system, solver, epsilon);
+    kick(system, 0.5 * dt);
+    drift(system, dt);
+    computeForces(system, solver, epsilon);
+    kick(system, 0.5 * dt);
+}
+
+std::string VelocityVerletIntegrator::name() const {
+    return "verlet";
+}
+
+void VelocityVerletIntegrator::step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) {
+    ensureForces(system, solver, epsilon);
+    const int n = static_cast<int>(system.size());
+    old_ax_.resize(n);
+    old_ay_.resize(n);
+    old_az_.resize(n);
+
+    #pragma omp parallel for simd
+    for (int k = 0; k < n; k++) {
+        system.x[k] += dt * system.vx[k] + 0.5 * dt * dt * system.ax[k];
+        system.y[k] += dt * system.vy[k] + 0.5 * dt * dt * system.ay[k];
+        system.z[k] += dt * system.vz[k] + 0.5 * dt * dt * system.az[k];
+        old_ax_[k] = system.ax[k];
+        old_ay_[k] = system.ay[k];
+        old_az_[k] = system.az[k];
+    }
+
+    computeForces(system, solver, epsilon);
+
+    #pragma omp parallel for simd
+    for (int k = 0; k < n; k++) {
+        system.vx[k] += 0.5 * dt * (old_ax_[k] + system.ax[k]);
+        system.vy[k] += 0.5 * dt * (old_ay_[k] + system.ay[k]);
+        system.vz[k] += 0.5 * dt * (old_az_[k] + system.az[k]);
+    }
+}
+
+void VelocityVerletIntegrator::reserve(std::size_t num_particles) {
+    old_ax_.reserve(num_particles);
+    old_ay_.reserve(num_particles);
+    old_az_.reserve(num_particles);
+}
+
+std::string YoshidaIntegrator::name() const {
+    return "yoshida4";
+}
+
+void YoshidaIntegrator::step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) {
+    // Yoshida (1990) triple jump weights
+    static const double w1 = 1.0 / (2.0 - std::cbrt(2.0));
+    static const double w0 = -std::cbrt(2.0) / (2.0 - std::cbrt(2.0));
+
+    ensureForces(system, solver, epsilon);
+    kick(system, 0.5 * w1 * dt);
+    drift(system, w1 * dt);
+    computeForces(system, solver, epsilon);
+    kick(system, 0.5 * (w1 + w0) * dt);
+    drift(system, w0 * dt);
+    computeForces(system, solver, epsilon);
+    kick(system, 0.5 * (w0 + w1) * dt);
+    drift(system, w1 * dt);
+    computeForces(system, solver, epsilon);
+    kick(system, 0.5 * w1 * dt);
+}
+
+std::unique_ptr<Integrator> makeIntegrator(const std::string& name) {
+    if (name == "euler") {
+        return std::make_unique<EulerIntegrator>();
+    }
+    if (name == "leapfrog") {
+        return std::make_unique<LeapfrogIntegrator>();
+    }
+    if (name == "verlet") {
+        return std::make_unique<VelocityVerletIntegrator>();
+    }
+    if (name == "yoshida4") {
+        return std::make_unique<YoshidaIntegrator>();
+    }
+    if (name == "wh") {
+        return std::make_unique<WisdomHolmanIntegrator>();
+    }
+    if (name == "block") {
+        return std::make_unique<BlockTimestepIntegrator>();
+    }
+    throw std::invalid_argument("Unknown integrator '" + name + "', expected 'euler', 'leapfrog', 'verlet', 'yoshida4', 'wh' or 'block'");
+}
+
+// Function to evolve a structure-of-arrays system in place with any solver and integrator
+void evolution_Solar_System(ParticleSystem& system, ForceSolver& solver, Integrator& integrator, double dt, int time_steps, double epsilon) {
+    for (int i = 0; i < time_steps; i++) {
+        integrator.step(system, solver, dt, epsilon);
+    }
+}
@@ -0,0 +1,122 @@
+#include "KeplerSolver.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+void stumpff(double x, double* c) {
+    int n = 0;
+    while (std::abs(x) > 0.1) {
+        x *= 0.25;
+        n++;
+    }
+    double c2 = (1 - x / 12 * (1 - x / 30 * (1 - x / 56 * (1 - x / 90 * (1 - x / 132 * (1 - x / 182)))))) / 2;
+    double c3 = (1 - x / 20 * (1 - x / 42 * (1 - x / 72 * (1 - x / 110 * (1 - x / 156 * (1 - x / 210)))))) / 6;
+    double c1 = 1 - x * c3;
+    double c0 = 1 - x * c2;
+    for (; n > 0; n--) {
+        c3 = (c2 + c0 * c3) / 4;
+        c2 = c1 * c1 / 2;
+        c1 = c0 * c1;
+        c0 = 2 * c0 * c0 - 1;
+    }
+    c[0] = c0;
+    c[1] = c1;
+    c[2] = c2;
+    c[3] = c3;
+}
+
+namespace {
+
+// Function to solve r0 G1 + eta G2 + mu G3 = dt for the universal anomaly s and apply the f and g functions.
+// Returns false if the iteration has not converged.
+bool solveKepler(double mu, double dt, double* position, double* velocity) {
+    const double r0 = std::sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+    const double v2 = velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2];
+    const double eta = position[0] * velocity[0] + position[1] * velocity[1] + position[2] * velocity[2];
+    const double beta = 2 * mu / r0 - v2;
+    const double zeta = mu - beta * r0;
+
+    double s = dt / r0;
+    double c[4];
+    double g0, g1, g2, g3;
+    bool converged = false;
+    // a body at the central mass or a NaN state gives no finite start, and stumpff would not return for an infinite argument
+    for (int iteration = 0; iteration < 50 && !converged && std::isfinite(beta * s * s); iteration++) {
+        stumpff(beta * s * s, c);
+        g0 = c[0];
+        g1 = s * c[1];
+        g2 = s * s * c[2];
+        g3 = s * s * s * c[3];
+        double f = r0 * g1 + eta * g2 + mu * g3 - dt;
+        double fp = r0 * g0 + eta * g1 + mu * g2;
+        double fpp = eta * g0 + zeta * g1;
+
+        // Laguerre-Conway step with n = 5
+        double root = std::sqrt(std::abs(16 * fp * fp - 20 * f * fpp));
+        double ds = -5 * f / (fp + std::copysign(root, fp));
+        s += ds;
+        converged = std::abs(ds) <= 1e-15 * std::abs(s) || ds == 0.0;
+    }
+    if (!converged || !std::isfinite(s)) {
+        return false;
+    }
+
+    stumpff(beta * s * s, c);
+    g0 = c[0];
+    g1 = s * c[1];
+    g2 = s * s * c[2];
+    g3 = s * s * s * c[3];
+    const double r = r0 * g0 + eta * g1 + mu * g2;
+
+    // f - 1 and g' - 1 are used directly to keep the rounding error of small steps low
+    const double f_m1 = -mu * g2 / r0;
+    const double g = dt - mu * g3;
+    const double fdot = -mu * g1 / (r * r0);
+    const double gdot_m1 = -mu * g2 / r;
+    for (int k = 0; k < 3; k++) {
+        double p = position[k], v = velocity[k];
+        position[k] = p + f_m1 * p + g * v;
+        velocity[k] = v + fdot * p + gdot_m1 * v;
+    }
+    return true;
+}
+
+// Function to drift by dt, splitting a step the iteration cannot solve into halves at most halvings_left more times
+void keplerDriftSplit(double mu, double dt, double* position, double* velocity, int halvings_left) {
+    double saved_position[3] = {position[0], position[1], position[2]};
+    double saved_velocity[3] = {velocity[0], velocity[1], velocity[2]};
+    if (!solveKepler(mu, dt, position, velocity)) {
+        for (int k = 0; k < 3; k++) {
+            position[k] = saved_position[k];
+            velocity[k] = saved_velocity[k];
+        }
+        if (halvings_left == 0) {
+            throw std::runtime_error("The Kepler drift does not converge for a body at distance " + std::to_string(std::sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2])) + " from the central mass");
+        }
+        keplerDriftSplit(mu, 0.5 * dt, position, velocity, halvings_left - 1);
+        keplerDriftSplit(mu, 0.5 * dt, position, velocity, halvings_left - 1);
+    }
+}
+
+}
+
+void keplerDrift(double mu, double dt, double* position, double* velocity) {
+    keplerDriftSplit(mu, dt, position, velocity, kMaxKeplerHalvings);
+}
+
+OrbitalElements orbitalElements(double mu, const double* position, const double* velocity) {
+    const double r = std::sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+    const double v2 = velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2];
+    const double energy = 0.5 * v2 - mu / r;
+    const double hx = position[1] * velocity[2] - position[2] * velocity[1];
+    const double hy = position[2] * velocity[0] - position[0] * velocity[2];
+    const double hz = position[0] * velocity[1] - position[1] * velocity[0];
+    const double h2 = hx * hx + hy * hy + hz * hz;
+
+    OrbitalElements elements;
+    elements.semi_major_axis = -mu / (2 * energy);
+    elements.eccentricity = std::sqrt(std::max(0.0, 1 + 2 * energy * h2 / (mu * mu)));
+    elements.inclination = h2 > 0.0 ? std::acos(std::clamp(hz / std::sqrt(h2), -1.0, 1.0)) : 0.0;
+    return elements;
+}
@@ -0,0 +1,185 @@
+#include "ParallelSystemGenerator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "Philox.hpp"
+
+namespace {
+
+// Plummer scale radius in Henon units
+const double kPlummerRadius = 3 * M_PI / 16;
+// Bodies per partial sum of the centre of mass, fixed so the sum does not depend on the threads
+constexpr long kSumChunk = 1 << 16;
+
+struct BodyState {
+    double m, x, y, z, vx, vy, vz;
+};
+
+// Function to draw two independent standard normals by the Box-Muller transform
+void normalPair(PhiloxStream& stream, double& a, double& b) {
+    const double radius = std::sqrt(-2.0 * std::log(stream.uniform()));
+    const double angle = 2 * M_PI * stream.uniform();
+    a = radius * std::cos(angle);
+    b = radius * std::sin(angle);
+}
+
+// Function to draw a unit vector uniformly on the sphere
+void isotropic(PhiloxStream& stream, double length, double& x, double& y, double& z) {
+    const double cos_theta = 1.0 - 2.0 * stream.uniform();
+    const double sin_theta = std::sqrt(1.0 - cos_theta * cos_theta);
+    const double phi = 2 * M_PI * stream.uniform();
+    x = length * sin_theta * std::cos(phi);
+    y = length * sin_theta * std::sin(phi);
+    z = length * cos_theta;
+}
+
+// Function to draw body i > 0 of a disk around a unit mass, with the distributions of RandomSystemGenerator
+BodyState diskBody(PhiloxStream& stream, bool thick) {
+    BodyState b;
+    b.m = 1. / 6000000 + (1. / 1000 - 1. / 6000000) * stream.uniform();
+    const double r = 0.4 + (30. - 0.4) * stream.uniform();
+    const double theta = 2 * M_PI * stream.uniform();
+    b.x = r * std::sin(theta);
+    b.y = r * std::cos(theta);
+    b.vx = -1 / std::sqrt(r) * std::cos(theta);
+    b.vy = 1 / std::sqrt(r) * std::sin(theta);
+    b.z = 0.0;
+    b.vz = 0.0;
+    if (thick) {
+        double height, vertical;
+        normalPair(stream, height, vertical);
+        b.z = kDiskAspect * r * height;
+        b.vz = kDiskAspect / std::sqrt(r) * vertical;
+    }
+    return b;
+}
+
+// Function to draw a body of a Plummer sphere by the method of Aarseth, Henon & Wielen (1974)
+BodyState plummerBody(PhiloxStream& stream, double mass) {
+    BodyState b;
+    b.m = mass;
+    double r;
+    do {
+        const double u = stream.uniform();
+        r = kPlummerRadius / std::sqrt(1.0 / std::cbrt(u * u) - 1.0);
+    } while (r > kPlummerCutoff * kPlummerRadius);
+    isotropic(stream, r, b.x, b.y, b.z);
+
+    // speed as a fraction q of the escape speed, from g(q) = q^2 (1 - q^2)^3.5 by rejection
+    double q, g, t;
+    do {
+        q = stream.uniform();
+        g = 0.1 * stream.uniform();
+        t = 1.0 - q * q;
+    } while (g > q * q * t * t * t * std::sqrt(t));
+    const double escape = std::sqrt(2.0 / std::sqrt(r * r + kPlummerRadius * kPlummerRadius));
+    isotropic(stream, q * escape, b.vx, b.vy, b.vz);
+    return b;
+}
+
+// Function to move the system to its centre of mass frame, summing in fixed chunks so the result does not depend on the threads
+void toCentreOfMassFrame(ParticleSystem& system) {
+    const long n = static_cast<long>(system.size());
+    const long num_chunks = (n + kSumChunk - 1) / kSumChunk;
+    std::vector<double> sums(7 * num_chunks);
+    #pragma omp parallel for schedule(static)
+    for (long c = 0; c < num_chunks; c++) {
+        double s[7] = {};
+        const long end = std::min(n, (c + 1) * kSumChunk);
+        for (long i = c * kSumChunk; i < end; i++) {
+            s[0] += system.m[i];
+            s[1] += system.m[i] * system.x[i];
+            s[2] += system.m[i] * system.y[i];
+            s[3] += system.m[i] * system.z[i];
+            s[4] += system.m[i] * system.vx[i];
+            s[5] += system.m[i] * system.vy[i];
+            s[6] += system.m[i] * system.vz[i];
+        }
+        std::copy(s, s + 7, sums.begin() + 7 * c);
+    }
+    double total[7] = {};
+    for (long c = 0; c < num_chunks; c++) {
+        for (int k = 0; k < 7; k++) {
+            total[k] += sums[7 * c + k];
+        }
+    }
+    const double shift[6] = {total[1] / total[0], total[2] / total[0], total[3] / total[0], total[4] / total[0], total[5] / total[0], total[6] / total[0]};
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) {
+        system.x[i] -= shift[0];
+        system.y[i] -= shift[1];
+        system.z[i] -= shift[2];
+        system.vx[i] -= shift[3];
+        system.vy[i] -= shift[4];
+        system.vz[i] -= shift[5];
+    }
+}
+
+}
+
+ParallelSystemGenerator::ParallelSystemGenerator(const std::string& distribution, std::size_t num_particles, std::uint64_t seed, std::size_t num_test) :
+    num_particles_(num_particles), seed_(seed), num_test_(num_test)
+{
+    if (distribution == "disk") {
+        distribution_ = Distribution::Disk;
+    }
+    else if (distribution == "thick-disk") {
+        distribution_ = Distribution::ThickDisk;
+    }
+    else if (distribution == "plummer") {
+        distribution_ = Distribution::Plummer;
+    }
+    else {
+        throw std::invalid_argument("Unknown distribution '" + distribution + "', expected 'disk', 'thick-disk' or 'plummer'");
+    }
+}
+
+bool ParallelSystemGenerator::hasDistribution(const std::string& distribution) {
+    return distribution == "disk" || distribution == "thick-disk" || distribution == "plummer";
+}
+
+std::vector<Particle> ParallelSystemGenerator::generateInitialConditions() {
+    return generateParticleSystem().toParticles();
+}
+
+ParticleSystem ParallelSystemGenerator::generateParticleSystem() {
+    ParticleSystem system;
+    system.resizeForOverwrite(num_particles_ + num_test_);
+    const long n = static_cast<long>(num_particles_ + num_test_);
+    const long num_massive = static_cast<long>(num_particles_);
+    const double plummer_mass = 1.0 / static_cast<double>(num_particles_);
+
+    // static schedule, so with the same threads a later parallel loop over the bodies finds its pages local
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) {
+        const bool test = i >= num_massive;
+        PhiloxStream stream(test ? seed_ + 1 : seed_, static_cast<std::uint64_t>(test ? i - num_massive : i));
+        BodyState b{1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        if (distribution_ == Distribution::Plummer) {
+            b = plummerBody(stream, test ? 0.0 : plummer_mass);
+        }
+        else if (test || i > 0) {
+            b = diskBody(stream, distribution_ == Distribution::ThickDisk);
+            if (test) {
+                b.m = 0.0;
+            }
+        }
+        system.m[i] = b.m;
+        system.x[i] = b.x;
+        system.y[i] = b.y;
+        system.z[i] = b.z;
+        system.vx[i] = b.vx;
+        system.vy[i] = b.vy;
+        system.vz[i] = b.vz;
+        system.ax[i] = 0.0;
+        system.ay[i] = 0.0;
+        system.az[i] = 0.0;
+    }
+    system.setNumMassive(num_particles_);
+    // the test particles have no mass, so they move with the massive bodies without shifting their centre
+    if (distribution_ == Distribution::Plummer) {
+        toCentreOfMassFrame(system);
+    }
+    return system;
+}
@@ -0,0 +1,144 @@
+#include "ParticleSystem.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "ForceSolver.hpp"
+
+ParticleSystem::ParticleSystem(std::size_t num_particles) {
+    resize(num_particles);
+}
+
+ParticleSystem::ParticleSystem(const std::vector<Particle>& particles) {
+    reserve(particles.size());
+    for (const Particle& p : particles) {
+        addParticle(p.getMass(), p.getPosition(), p.getVelocity());
+        Eigen::Vector3d acc = p.getAcceleration();
+        ax.back() = acc.x();
+        ay.back() = acc.y();
+        az.back() = acc.z();
+    }
+}
+
+std::size_t ParticleSystem::size() const {
+    return m.size();
+}
+
+void ParticleSystem::resize(std::size_t num_particles) {
+    // with test particles, new bodies are massless test particles
+    if (num_massive_ != kAllMassive) {
+        num_massive_ = std::min(num_massive_, num_particles);
+    }
+    for (AlignedVector* array : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &m}) {
+        array->resize(num_particles, 0.0);
+    }
+}
+
+void ParticleSystem::resizeForOverwrite(std::size_t num_particles) {
+    if (num_massive_ != kAllMassive) {
+        num_massive_ = std::min(num_massive_, num_particles);
+    }
+    for (AlignedVector* array : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &m}) {
+        array->resize(num_particles);
+    }
+}
+
+void ParticleSystem::reserve(std::size_t num_particles) {
+    for (AlignedVector* array : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &m}) {
+        array->reserve(num_particles);
+    }
+}
+
+void ParticleSystem::addParticle(double mass, const Eigen::Vector3d& position, const Eigen::Vector3d& velocity) {
+    const std::size_t k = numMassive();
+    const double values[10] = {position.x(), position.y(), position.z(), velocity.x(), velocity.y(), velocity.z(), 0.0, 0.0, 0.0, mass};
+    AlignedVector* arrays[10] = {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &m};
+    for (int c = 0; c < 10; c++) {
+        arrays[c]->insert(arrays[c]->begin() + k, values[c]);
+    }
+    if (num_massive_ != kAllMassive) {
+        num_massive_ = k + 1;
+    }
+}
+
+std::size_t ParticleSystem::numMassive() const {
+    return std::min(num_massive_, size());
+}
+
+std::size_t ParticleSystem::numTest() const {
+    return size() - numMassive();
+}
+
+void ParticleSystem::addTestParticle(const Eigen::Vector3d& position, const Eigen::Vector3d& velocity) {
+    num_massive_ = numMassive();
+    const double values[10] = {position.x(), position.y(), position.z(), velocity.x(), velocity.y(), velocity.z(), 0.0, 0.0, 0.0, 0.0};
+    AlignedVector* arrays[10] = {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &m};
+    for (int c = 0; c < 10; c++) {
+        arrays[c]->push_back(values[c]);
+    }
+}
+
+void ParticleSystem::setNumMassive(std::size_t num_massive) {
+    if (num_massive > size()) {
+        throw std::invalid_argument("Cannot make " + std::to_string(num_massive) + " of " + std::to_string(size()) + " bodies massive");
+    }
+    for (std::size_t i = num_massive; i < size(); i++) {
+        if (m[i] != 0.0) {
+            throw std::invalid_argument("Test particle " + std::to_string(i) + " has mass " + std::to_string(m[i]));
+        }
+    }
+    num_massive_ = num_massive == size() ? kAllMassive : num_massive;
+}
+
+void ParticleSystem::removeParticles(const std::vector<char>& remove) {
+    if (remove.size() != size()) {
+        throw std::invalid_argument("Expected " + std::to_string(size()) + " removal flags, not " + std::to_string(remove.size()));
+    }
+    if (num_massive_ != kAllMassive) {
+        num_massive_ -= std::count_if(remove.begin(), remove.begin() + numMassive(), [](char flag) { return flag != 0; });
+    }
+    const std::size_t n = size();
+    for (AlignedVector* array : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &m}) {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            if (remove[i] == 0) {
+                (*array)[kept++] = (*array)[i];
+            }
+        }
+        array->resize(kept);
+    }
+}
+
+Eigen::Vector3d ParticleSystem::getPosition(std::size_t i) const {
+    return Eigen::Vector3d(x[i], y[i], z[i]);
+}
+
+Eigen::Vector3d ParticleSystem::getVelocity(std::size_t i) const {
+    return Eigen::Vector3d(vx[i], vy[i], vz[i]);
+}
+
+Eigen::Vector3d ParticleSystem::getAcceleration(std::size_t i) const {
+    return Eigen::Vector3d(ax[i], ay[i], az[i]);
+}
+
+double ParticleSystem::getMass(std::size_t i) const {
+    return m[i];
+}
+
+Particle ParticleSystem::getParticle(std::size_t i) const {
+    return Particle(m[i], getPosition(i), getVelocity(i), getAcceleration(i));
+}
+
+std::vector<Particle> ParticleSystem::toParticles() const {
+    std::vector<Particle> particles;
+    particles.reserve(size());
+    for (std::size_t i = 0; i < size(); i++) {
+        particles.push_back(getParticle(i));
+    }
+    return particles;
+}
+
+// Function to evolve a structure-of-arrays system in place with the same explicit Euler step as the Particle path
+void evolution_Solar_System(ParticleSystem& system, double dt, int time_steps, double epsilon) {
+    DirectSolver solver;
+    evolution_Solar_System(system, solver, dt, time_steps, epsilon);
+}
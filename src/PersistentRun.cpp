@@ -0,0 +1,131 @@
+#include "PersistentRun.hpp"
+#include <stdexcept>
+#include <omp.h>
+#include "ForceKernel.hpp"
+#include "Profiler.hpp"
+
+namespace {
+
+// Copy of the system for one run, with the positions twice so a step can write the new positions
+// while other threads still read the old ones
+struct RunArrays {
+    AlignedVector x[2], y[2], z[2];
+    AlignedVector vx, vy, vz, ax, ay, az, m;
+
+    // left unwritten, so each page is first touched by the thread that owns its bodies
+    explicit RunArrays(std::size_t n) {
+        for (AlignedVector* array : {&x[0], &y[0], &z[0], &x[1], &y[1], &z[1], &vx, &vy, &vz, &ax, &ay, &az, &m}) {
+            array->resize(n);
+        }
+    }
+};
+
+}
+
+bool hasPersistentKernel(const std::string& integrator) {
+    return integrator == "euler" || integrator == "leapfrog";
+}
+
+void advancePersistent(ParticleSystem& system, const std::string& integrator, double dt, long num_steps, double epsilon) {
+    if (!hasPersistentKernel(integrator)) {
+        throw std::invalid_argument("The persistent parallel region runs 'euler' or 'leapfrog', not '" + integrator + "'");
+    }
+    static const PointKernel kernel = selectKernel(detectSimdLevel());
+    const bool leapfrog = integrator == "leapfrog";
+    const long n = static_cast<long>(system.size());
+    const std::size_t num_sources = system.numMassive();
+    const double epsilon2 = epsilon * epsilon;
+    RunArrays run(system.size());
+
+    #pragma omp parallel
+    {
+        const int thread = omp_get_thread_num();
+        const int num_threads = omp_get_num_threads();
+        const long begin = n * thread / num_threads;
+        const long end = n * (thread + 1) / num_threads;
+
+        for (long i = begin; i < end; i++) {
+            run.x[0][i] = run.x[1][i] = system.x[i];
+            run.y[0][i] = run.y[1][i] = system.y[i];
+            run.z[0][i] = run.z[1][i] = system.z[i];
+            run.vx[i] = system.vx[i];
+            run.vy[i] = system.vy[i];
+            run.vz[i] = system.vz[i];
+            run.ax[i] = system.ax[i];
+            run.ay[i] = system.ay[i];
+            run.az[i] = system.az[i];
+            run.m[i] = system.m[i];
+        }
+        #pragma omp barrier
+
+        // Function to sweep the block: overwrite its accelerations from positions buffer b, then update
+        // each body while its acceleration is still in registers. Leapfrog applies the closing half kick,
+        // Euler drifts into the other buffer with the old velocity and then kicks by dt.
+        auto forceSweep = [&](int b, bool update) {
+            PROFILE_SCOPE(ForceLoop);
+            PROFILE_COUNT(PairInteractions, num_sources * static_cast<std::uint64_t>(end - begin));
+            const SourceArrays sources{run.x[b].data(), run.y[b].data(), run.z[b].data(), run.m.data(), num_sources};
+            const double h = leapfrog ? 0.5 * dt : dt;
+            for (long i = begin; i < end; i++) {
+                double acc[3];
+                kernel(sources, run.x[b][i], run.y[b][i], run.z[b][i], epsilon2, acc);
+                run.ax[i] = acc[0];
+                run.ay[i] = acc[1];
+                run.az[i] = acc[2];
+                if (!update) {
+                    continue;
+                }
+                if (!leapfrog) {
+                    run.x[1 - b][i] = run.x[b][i] + dt * run.vx[i];
+                    run.y[1 - b][i] = run.y[b][i] + dt * run.vy[i];
+                    run.z[1 - b][i] = run.z[b][i] + dt * run.vz[i];
+                }
+                run.vx[i] += h * run.ax[i];
+                run.vy[i] += h * run.ay[i];
+                run.vz[i] += h * run.az[i];
+            }
+        };
+
+        // The barrier of a step separates the writes of the new positions from the force sweep that
+        // reads them. Writes only ever go to the buffer nobody is reading, so one barrier is enough.
+        int current = 0;
+        if (leapfrog) {
+            forceSweep(current, false);
+            for (long step = 0; step < num_steps; step++) {
+                {
+                    PROFILE_SCOPE(Drift);
+                    for (long i = begin; i < end; i++) {
+                        run.vx[i] += 0.5 * dt * run.ax[i];
+                        run.vy[i] += 0.5 * dt * run.ay[i];
+                        run.vz[i] += 0.5 * dt * run.az[i];
+                        run.x[1 - current][i] = run.x[current][i] + dt * run.vx[i];
+                        run.y[1 - current][i] = run.y[current][i] + dt * run.vy[i];
+                        run.z[1 - current][i] = run.z[current][i] + dt * run.vz[i];
+                    }
+                }
+                current = 1 - current;
+                #pragma omp barrier
+                forceSweep(current, true);
+            }
+        }
+        else {
+            for (long step = 0; step < num_steps; step++) {
+                forceSweep(current, true);
+                current = 1 - current;
+                #pragma omp barrier
+            }
+        }
+
+        for (long i = begin; i < end; i++) {
+            system.x[i] = run.x[current][i];
+            system.y[i] = run.y[current][i];
+            system.z[i] = run.z[current][i];
+            system.vx[i] = run.vx[i];
+            system.vy[i] = run.vy[i];
+            system.vz[i] = run.vz[i];
+            system.ax[i] = run.ax[i];
+            system.ay[i] = run.ay[i];
+            system.az[i] = run.az[i];
+        }
+    }
+}
@@ -0,0 +1,230 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <omp.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+constexpr int kNumPhases = static_cast<int>(ProfilePhase::Count);
+constexpr int kNumCounters = static_cast<int>(ProfileCounter::Count);
+// Trace events kept per thread, later ones are counted as dropped
+constexpr std::size_t kMaxEvents = 1 << 20;
+// Flops of one pair interaction, as in nbody_bench
+constexpr double kFlopsPerInteraction = 20.0;
+
+const char* const kPhaseNames[kNumPhases] = {"Force", "TreeBuild", "ForceLoop", "Kick", "Drift", "Kepler", "Diagnostics", "DiagnosticsLoop", "Output", "Checkpoint", "Encounters", "Subcycle"};
+
+struct TraceEvent {
+    std::uint64_t start;
+    std::uint64_t end;
+    ProfilePhase phase;
+};
+
+// One cache line aligned record per thread, so threads never write to the same line
+struct alignas(64) ThreadRecord {
+    std::uint64_t ticks[kNumPhases];
+    std::uint64_t calls[kNumPhases];
+    std::uint64_t counters[kNumCounters];
+    std::vector<TraceEvent> events;
+    std::uint64_t dropped;
+};
+
+ThreadRecord records[Profiler::kMaxThreads];
+bool trace_events = false;
+std::uint64_t start_ticks = 0;
+std::chrono::steady_clock::time_point start_time;
+std::uint64_t stop_ticks = 0;
+std::chrono::steady_clock::time_point stop_time;
+
+ThreadRecord& threadRecord() {
+    return records[std::min(omp_get_thread_num(), Profiler::kMaxThreads - 1)];
+}
+
+// Function to finish the profiled interval if it is still running and return its ticks per second
+double ticksPerSecond(double& elapsed) {
+    std::uint64_t ticks = stop_ticks;
+    std::chrono::steady_clock::time_point time = stop_time;
+    if (Profiler::enabled()) {
+        ticks = Profiler::now();
+        time = std::chrono::steady_clock::now();
+    }
+    elapsed = std::chrono::duration<double>(time - start_time).count();
+    return elapsed > 0.0 ? static_cast<double>(ticks - start_ticks) / elapsed : 1.0;
+}
+
+}
+
+bool Profiler::compiledIn() {
+#ifdef NBODY_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Profiler::enable(bool trace) {
+    for (ThreadRecord& record : records) {
+        std::fill(record.ticks, record.ticks + kNumPhases, 0);
+        std::fill(record.calls, record.calls + kNumPhases, 0);
+        std::fill(record.counters, record.counters + kNumCounters, 0);
+        record.events.clear();
+        record.dropped = 0;
+    }
+    trace_events = trace;
+    if (trace) {
+        for (int t = 0; t < omp_get_max_threads() && t < kMaxThreads; t++) {
+            records[t].events.reserve(4096);
+        }
+    }
+    start_time = std::chrono::steady_clock::now();
+    start_ticks = now();
+    enabled_ = true;
+}
+
+void Profiler::disable() {
+    if (enabled_) {
+        stop_ticks = now();
+        stop_time = std::chrono::steady_clock::now();
+        enabled_ = false;
+    }
+}
+
+std::uint64_t Profiler::now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void Profiler::record(ProfilePhase phase, std::uint64_t start, std::uint64_t end) {
+    ThreadRecord& record = threadRecord();
+    const int p = static_cast<int>(phase);
+    record.ticks[p] += end - start;
+    record.calls[p]++;
+    if (trace_events) {
+        if (record.events.size() < kMaxEvents) {
+            record.events.push_back(TraceEvent{start, end, phase});
+        }
+        else {
+            record.dropped++;
+        }
+    }
+}
+
+void Profiler::count(ProfileCounter counter, std::uint64_t amount) {
+    threadRecord().counters[static_cast<int>(counter)] += amount;
+}
+
+std::uint64_t Profiler::calls(ProfilePhase phase) {
+    std::uint64_t sum = 0;
+    for (const ThreadRecord& record : records) {
+        sum += record.calls[static_cast<int>(phase)];
+    }
+    return sum;
+}
+
+std::uint64_t Profiler::total(ProfileCounter counter) {
+    std::uint64_t sum = 0;
+    for (const ThreadRecord& record : records) {
+        sum += record.counters[static_cast<int>(counter)];
+    }
+    return sum;
+}
+
+// The time of a phase is that of its slowest thread, which is the wall time for the *Loop phases.
+// Nested phases (TreeBuild and ForceLoop inside Force) are counted in both.
+void Profiler::printSummary(std::ostream& out) {
+    double elapsed;
+    const double rate = ticksPerSecond(elapsed);
+    out << "Profile of " << elapsed << " s";
+    if (!compiledIn()) {
+        out << ", built without NBODY_PROFILING so no phase was recorded";
+    }
+    out << "\n";
+    out << "| Phase | Calls | Time (s) | Share | Threads | Max / mean thread time |\n";
+    out << "|---|---|---|---|---|---|\n";
+
+    double force_loop_seconds = 0.0;
+    for (int p = 0; p < kNumPhases; p++) {
+        std::uint64_t calls = 0, total = 0, slowest = 0;
+        int threads = 0;
+        for (const ThreadRecord& record : records) {
+            if (record.calls[p] > 0) {
+                calls += record.calls[p];
+                total += record.ticks[p];
+                slowest = std::max(slowest, record.ticks[p]);
+                threads++;
+            }
+        }
+        if (calls == 0) {
+            continue;
+        }
+        const double seconds = static_cast<double>(slowest) / rate;
+        const double mean = static_cast<double>(total) / threads;
+        if (static_cast<ProfilePhase>(p) == ProfilePhase::ForceLoop) {
+            force_loop_seconds = seconds;
+        }
+        out << "| " << kPhaseNames[p] << " | " << calls << " | " << seconds << " | " << 100.0 * seconds / elapsed << "% | " << threads << " | ";
+        if (threads > 1) {
+            out << static_cast<double>(slowest) / mean << " |\n";
+        }
+        else {
+            out << "- |\n";
+        }
+    }
+
+    std::uint64_t totals[kNumCounters] = {};
+    std::uint64_t dropped = 0;
+    for (const ThreadRecord& record : records) {
+        for (int c = 0; c < kNumCounters; c++) {
+            totals[c] += record.counters[c];
+        }
+        dropped += record.dropped;
+    }
+    const double interactions = static_cast<double>(totals[static_cast<int>(ProfileCounter::PairInteractions)]);
+    const double visits = static_cast<double>(totals[static_cast<int>(ProfileCounter::NodeVisits)]);
+    out << "Pair interactions: " << interactions;
+    if (force_loop_seconds > 0.0) {
+        out << ", " << interactions / force_loop_seconds << " per second of force loop, " << interactions * kFlopsPerInteraction / force_loop_seconds * 1e-9 << " GFLOP/s";
+    }
+    out << "\n";
+    if (visits > 0.0) {
+        out << "Tree node visits: " << visits;
+        if (force_loop_seconds > 0.0) {
+            out << ", " << visits / force_loop_seconds << " per second of force loop";
+        }
+        out << "\n";
+    }
+    if (dropped > 0) {
+        out << "Trace events dropped after " << kMaxEvents << " per thread: " << dropped << "\n";
+    }
+}
+
+void Profiler::writeChromeTrace(const std::string& path) {
+    double elapsed;
+    const double rate = ticksPerSecond(elapsed);
+    std::ofstream out(path);
+    out.precision(15);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (int t = 0; t < kMaxThreads; t++) {
+        for (const TraceEvent& event : records[t].events) {
+            const double begin_us = static_cast<double>(event.start - start_ticks) / rate * 1e6;
+            const double duration_us = static_cast<double>(event.end - event.start) / rate * 1e6;
+            out << (first ? "" : ",\n") << "{\"name\": \"" << kPhaseNames[static_cast<int>(event.phase)] << "\", \"cat\": \"nbody\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << t
+                << ", \"ts\": " << begin_us << ", \"dur\": " << duration_us << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        throw std::runtime_error("Cannot write the trace file '" + path + "'");
+    }
+}
@@ -1,7 +1,24 @@
 #include <random>
 #include "RandomSystemGenerator.hpp"
 
-RandomSystemGenerator::RandomSystemGenerator(int num_particles) : num_particles_(num_particles) {}
+RandomSystemGenerator::RandomSystemGenerator(int num_particles, int num_test) : num_particles_(num_particles), num_test_(num_test) {}
+
+namespace {
+
+// Function to draw the test particles, massless bodies on circular orbits around the central mass
+template <typename AddBody>
+void drawTestParticles(int num_test, AddBody add) {
+    std::mt19937 gen(43);
+    std::uniform_real_distribution<> distance_distribution(0.4, 30.);
+    std::uniform_real_distribution<> angle_distribution(0., 2 * M_PI);
+    for (int i = 0; i < num_test; i++) {
+        double r = distance_distribution(gen);
+        double theta = angle_distribution(gen);
+        add(Eigen::Vector3d(r * std::sin(theta), r * std::cos(theta), 0.0), Eigen::Vector3d(-1 / std::sqrt(r) * std::cos(theta), 1 / std::sqrt(r) * std::sin(theta), 0.0));
+    }
+}
+
+}
 
 std::vector<Particle> RandomSystemGenerator::generateInitialConditions() {
     std::vector<Particle> particles {Particle(1.0)};
@@ -30,6 +47,35 @@ std::vector<Particle> RandomSystemGenerator::generateInitialConditions() {
         Particle p(m, Eigen::Vector3d(x_x, x_y, x_z), Eigen::Vector3d(v_x, v_y, v_z));
         particles.push_back(p);
     }
+    drawTestParticles(num_test_, [&](const Eigen::Vector3d& position, const Eigen::Vector3d& velocity) {
+        particles.push_back(Particle(0.0, position, velocity));
+    });
 
     return particles;
+}
+
+ParticleSystem RandomSystemGenerator::generateParticleSystem() {
+    ParticleSystem system;
+    system.reserve(num_particles_ + num_test_);
+    system.addParticle(1.0);
+
+    // Same random stream as generateInitialConditions, written straight into the arrays
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> mass_distribution(1. / 6000000, 1. / 1000);
+    std::uniform_real_distribution<> distance_distribution(0.4, 30.);
+    std::uniform_real_distribution<> angle_distribution(0., 2 * M_PI);
+
+    for (int i = 1; i < num_particles_; i++) {
+        double m = mass_distribution(gen);
+        double r = distance_distribution(gen);
+        double theta = angle_distribution(gen);
+        Eigen::Vector3d position(r * std::sin(theta), r * std::cos(theta), 0.0);
+        Eigen::Vector3d velocity(-1 / std::sqrt(r) * std::cos(theta), 1 / std::sqrt(r) * std::sin(theta), 0.0);
+        system.addParticle(m, position, velocity);
+    }
+    drawTestParticles(num_test_, [&](const Eigen::Vector3d& position, const Eigen::Vector3d& velocity) {
+        system.addTestParticle(position, velocity);
+    });
+
+    return system;
 }
\ No newline at end of file
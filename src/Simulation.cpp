@@ -0,0 +1,102 @@
+#include "Simulation.hpp"
+#include <cmath>
+#include <stdexcept>
+#include "Profiler.hpp"
+#include <utility>
+
+Simulation::Simulation(ParticleSystem system, std::unique_ptr<ForceSolver> solver, std::unique_ptr<Integrator> integrator, double dt, double epsilon) :
+    system_(std::move(system)), solver_(std::move(solver)), integrator_(std::move(integrator)), dt_(dt), epsilon_(epsilon)
+{
+    solver_->reserve(system_.size());
+    integrator_->reserve(system_.size());
+}
+
+void Simulation::step() {
+    integrator_->step(system_, *solver_, dt_, epsilon_);
+    steps_++;
+}
+
+void Simulation::advance(long num_steps) {
+    for (long i = 0; i < num_steps; i++) {
+        step();
+    }
+}
+
+void Simulation::advance_until(double t) {
+    // the tolerance keeps a t that is a whole number of steps away from costing one more step through rounding
+    const double remaining = (t - time()) / dt_;
+    if (remaining > 0.0) {
+        advance(static_cast<long>(std::ceil(remaining - 1e-9)));
+    }
+}
+
+// Time is computed from the step count, so it does not pick up the rounding error of repeated additions
+double Simulation::time() const {
+    return static_cast<double>(steps_) * dt_;
+}
+
+long Simulation::steps() const {
+    return steps_;
+}
+
+double Simulation::timestep() const {
+    return dt_;
+}
+
+std::size_t Simulation::size() const {
+    return system_.size();
+}
+
+VectorView Simulation::positions() const {
+    return VectorView{system_.x.data(), system_.y.data(), system_.z.data(), system_.size()};
+}
+
+VectorView Simulation::velocities() const {
+    return VectorView{system_.vx.data(), system_.vy.data(), system_.vz.data(), system_.size()};
+}
+
+const ParticleSystem& Simulation::system() const {
+    return system_;
+}
+
+const Integrator& Simulation::integrator() const {
+    return *integrator_;
+}
+
+void Simulation::setComputePotential(bool enable) {
+    solver_->setComputePotential(enable);
+}
+
+// The potential of the last force evaluation is only used if that evaluation saw every body at its current position
+Diagnostics Simulation::diagnostics() const {
+    if (solver_->potentialAvailable() && solver_->potential().size() == system_.size() && integrator_->forcesCurrent(system_)) {
+        return computeDiagnostics(system_, solver_->potential());
+    }
+    return computeDiagnostics(system_, epsilon_);
+}
+
+void Simulation::writeCheckpoint(const std::string& path) const {
+    PROFILE_SCOPE(Checkpoint);
+    std::vector<double> state;
+    integrator_->saveState(system_, state);
+    ::writeCheckpoint(path, system_, steps_, dt_, epsilon_, integrator_->name(), state);
+}
+
+void Simulation::restore(const Checkpoint& checkpoint) {
+    if (checkpoint.timestep() != dt_ || checkpoint.softening() != epsilon_) {
+        throw std::invalid_argument("The checkpoint was written with a different timestep or softening");
+    }
+    if (checkpoint.integrator() != integrator_->name()) {
+        throw std::invalid_argument("The checkpoint was written by the '" + checkpoint.integrator() + "' integrator, not '" + integrator_->name() + "'");
+    }
+    checkpoint.loadInto(system_);
+    steps_ = checkpoint.steps();
+    const std::vector<double> state = checkpoint.integratorState();
+    std::size_t pos = 0;
+    integrator_->restoreState(system_, *solver_, epsilon_, state, pos);
+    if (pos != state.size()) {
+        throw std::invalid_argument("The checkpoint holds the state of a different integrator");
+    }
+    solver_->reserve(system_.size());
+    integrator_->reserve(system_.size());
+}
@@ -1,17 +1,18 @@
 #include "SolarSystemGenerator.hpp"
 
+SolarSystemGenerator::SolarSystemGenerator(std::uint64_t seed) : seeded_(true), engine_(seed) {}
+
+SolarSystemGenerator::SolarSystemGenerator(std::uint64_t seed, int num_asteroids) : seeded_(true), num_asteroids_(num_asteroids), engine_(seed) {}
+
 std::vector<Particle> SolarSystemGenerator::generateInitialConditions() {
     
     // Refactor the existing Solar System initial conditions generator
-    const std::vector<double> masses = {1.,1./6023600,1./408524,1./332946.038,1./3098710,1./1047.55,1./3499,1./22962,1./19352};
-    const std::vector<double> distances = {0.0, 0.4, 0.7, 1, 1.5, 5.2, 9.5, 19.2, 30.1};
-
-    std::vector<Particle> particles {Particle(1.0)};
+    std::vector<Particle> particles {Particle(kSolarMasses[0])};
 
-    for (int i = 1; i < masses.size(); i++) {
-        double m = masses[i];
-        double theta = ((double)std::rand() / RAND_MAX) * 2 * M_PI;
-        double r = distances[i];
+    for (int i = 1; i < kSolarBodies; i++) {
+        double m = kSolarMasses[i];
+        double theta = seeded_ ? std::uniform_real_distribution<>(0., 2 * M_PI)(engine_) : ((double)std::rand() / RAND_MAX) * 2 * M_PI;
+        double r = kSolarDistances[i];
         double x_x = r * std::sin(theta);
         double x_y = r * std::cos(theta);
         double x_z = 0.0;
@@ -22,5 +23,21 @@ std::vector<Particle> SolarSystemGenerator::generateInitialConditions() {
         particles.push_back(p);
     }
 
+    std::uniform_real_distribution<> belt_distribution(kBeltInner, kBeltOuter);
+    std::uniform_real_distribution<> angle_distribution(0., 2 * M_PI);
+    for (int i = 0; i < num_asteroids_; i++) {
+        double r = belt_distribution(engine_);
+        double theta = angle_distribution(engine_);
+        Eigen::Vector3d position(r * std::sin(theta), r * std::cos(theta), 0.0);
+        Eigen::Vector3d velocity(-1 / std::sqrt(r) * std::cos(theta), 1 / std::sqrt(r) * std::sin(theta), 0.0);
+        particles.push_back(Particle(0.0, position, velocity));
+    }
+
     return particles;
+}
+
+ParticleSystem SolarSystemGenerator::generateParticleSystem() {
+    ParticleSystem system(generateInitialConditions());
+    system.setNumMassive(kSolarBodies);
+    return system;
 }
\ No newline at end of file
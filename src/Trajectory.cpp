@@ -0,0 +1,275 @@
+#include "Trajectory.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Profiler.hpp"
+
+namespace {
+
+const char kTrajectoryMagic[8] = {'N', 'B', 'T', 'R', 'A', 'J', '\0', '\0'};
+
+// The format is little-endian and frames are copied and mapped as raw doubles
+void requireLittleEndian() {
+    if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+        throw std::runtime_error("Trajectory files are only supported on little-endian hosts");
+    }
+}
+
+std::size_t frameDoubles(const TrajectoryHeader& header) {
+    const std::size_t arrays = header.flags & kTrajectoryVelocities ? 6 : 3;
+    return 2 + arrays * header.num_bodies;
+}
+
+std::uint64_t firstFrameOffset(const TrajectoryHeader& header) {
+    return sizeof(TrajectoryHeader) + header.num_bodies * sizeof(double);
+}
+
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& path, const ParticleSystem& system, bool velocities, long resume_after) {
+    requireLittleEndian();
+    std::memcpy(header_.magic, kTrajectoryMagic, sizeof(kTrajectoryMagic));
+    header_.version = kTrajectoryVersion;
+    header_.flags = velocities ? kTrajectoryVelocities : 0;
+    header_.num_bodies = system.size();
+    header_.num_frames = 0;
+    header_.index_offset = 0;
+    frame_doubles_ = frameDoubles(header_);
+    next_offset_ = firstFrameOffset(header_);
+
+    if (resume_after < 0) {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (file_ == nullptr) {
+            throw std::runtime_error("Cannot create trajectory file '" + path + "'");
+        }
+        writeHeader();
+        if (std::fwrite(system.m.data(), sizeof(double), system.size(), file_) != system.size()) {
+            failed_ = true;
+        }
+    }
+    else {
+        // the frames follow each other in the order of their steps, so the kept ones are a prefix
+        std::size_t kept = 0;
+        {
+            TrajectoryReader reader(path);
+            if (reader.numBodies() != system.size() || reader.hasVelocities() != velocities) {
+                throw std::runtime_error("'" + path + "' is not a trajectory of this run, it cannot be continued");
+            }
+            while (kept < reader.numFrames() && reader.frame(kept).step <= resume_after) {
+                kept++;
+            }
+        }
+        file_ = std::fopen(path.c_str(), "r+b");
+        if (file_ == nullptr) {
+            throw std::runtime_error("Cannot reopen trajectory file '" + path + "'");
+        }
+        for (std::size_t k = 0; k < kept; k++) {
+            offsets_.push_back(next_offset_);
+            next_offset_ += frame_doubles_ * sizeof(double);
+        }
+        // the old index goes with the dropped frames, and the header marks the file as open again
+        if (::ftruncate(::fileno(file_), static_cast<off_t>(next_offset_)) != 0) {
+            std::fclose(file_);
+            throw std::runtime_error("Cannot cut the trajectory file '" + path + "' back to step " + std::to_string(resume_after));
+        }
+        writeHeader();
+        if (std::fseek(file_, static_cast<long>(next_offset_), SEEK_SET) != 0) {
+            failed_ = true;
+        }
+    }
+    for (std::vector<double>& buffer : buffers_) {
+        buffer.resize(frame_doubles_);
+    }
+    thread_ = std::thread(&TrajectoryWriter::run, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    try {
+        close();
+    }
+    catch (const std::runtime_error&) {
+    }
+}
+
+void TrajectoryWriter::writeHeader() {
+    if (std::fseek(file_, 0, SEEK_SET) != 0 || std::fwrite(&header_, sizeof(header_), 1, file_) != 1) {
+        failed_ = true;
+    }
+}
+
+// Function to copy positions and velocities into the free buffer and hand it to the writer thread
+void TrajectoryWriter::write(const ParticleSystem& system, double time, long step) {
+    PROFILE_SCOPE(Output);
+    if (system.size() != header_.num_bodies) {
+        throw std::invalid_argument("The number of bodies changed after the trajectory was opened");
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this] { return !full_[fill_]; });
+    }
+
+    const std::size_t n = system.size();
+    double* frame = buffers_[fill_].data();
+    const std::int64_t step64 = step;
+    frame[0] = time;
+    std::memcpy(frame + 1, &step64, sizeof(step64));
+    double* out = frame + 2;
+    const AlignedVector* arrays[] = {&system.x, &system.y, &system.z, &system.vx, &system.vy, &system.vz};
+    const int num_arrays = header_.flags & kTrajectoryVelocities ? 6 : 3;
+    for (int a = 0; a < num_arrays; a++) {
+        std::memcpy(out + a * n, arrays[a]->data(), n * sizeof(double));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        full_[fill_] = true;
+        fill_ ^= 1;
+    }
+    changed_.notify_all();
+    frames_queued_++;
+}
+
+void TrajectoryWriter::run() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [this] { return full_[drain_] || closing_; });
+            if (!full_[drain_]) {
+                return;
+            }
+        }
+
+        if (std::fwrite(buffers_[drain_].data(), sizeof(double), frame_doubles_, file_) != frame_doubles_) {
+            failed_ = true;
+        }
+        offsets_.push_back(next_offset_);
+        next_offset_ += frame_doubles_ * sizeof(double);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            full_[drain_] = false;
+            drain_ ^= 1;
+        }
+        changed_.notify_all();
+    }
+}
+
+void TrajectoryWriter::close() {
+    if (file_ == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+
+    header_.num_frames = offsets_.size();
+    header_.index_offset = next_offset_;
+    if (std::fwrite(offsets_.data(), sizeof(std::uint64_t), offsets_.size(), file_) != offsets_.size()) {
+        failed_ = true;
+    }
+    writeHeader();
+    if (std::fclose(file_) != 0) {
+        failed_ = true;
+    }
+    file_ = nullptr;
+    if (failed_) {
+        throw std::runtime_error("Writing the trajectory file failed");
+    }
+}
+
+std::size_t TrajectoryWriter::framesQueued() const {
+    return frames_queued_;
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& path) {
+    requireLittleEndian();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open trajectory file '" + path + "'");
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(TrajectoryHeader)) {
+        ::close(fd);
+        throw std::runtime_error("'" + path + "' is too short to be a trajectory file");
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map trajectory file '" + path + "'");
+    }
+    data_ = static_cast<const unsigned char*>(mapping);
+
+    std::memcpy(&header_, data_, sizeof(header_));
+    const std::uint64_t first = firstFrameOffset(header_);
+    if (std::memcmp(header_.magic, kTrajectoryMagic, sizeof(kTrajectoryMagic)) != 0 || header_.version != kTrajectoryVersion || first > size_) {
+        ::munmap(mapping, size_);
+        throw std::runtime_error("'" + path + "' is not a version " + std::to_string(kTrajectoryVersion) + " trajectory file");
+    }
+
+    const std::uint64_t frame_bytes = frameDoubles(header_) * sizeof(double);
+    if (header_.index_offset != 0 && header_.index_offset + header_.num_frames * sizeof(std::uint64_t) <= size_) {
+        offsets_.resize(header_.num_frames);
+        std::memcpy(offsets_.data(), data_ + header_.index_offset, header_.num_frames * sizeof(std::uint64_t));
+        for (std::uint64_t offset : offsets_) {
+            if (offset < first || offset + frame_bytes > size_) {
+                ::munmap(mapping, size_);
+                throw std::runtime_error("The frame index of '" + path + "' points outside the file");
+            }
+        }
+    }
+    else {
+        for (std::uint64_t offset = first; offset + frame_bytes <= size_; offset += frame_bytes) {
+            offsets_.push_back(offset);
+        }
+    }
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    ::munmap(const_cast<unsigned char*>(data_), size_);
+}
+
+std::size_t TrajectoryReader::numBodies() const {
+    return header_.num_bodies;
+}
+
+std::size_t TrajectoryReader::numFrames() const {
+    return offsets_.size();
+}
+
+bool TrajectoryReader::hasVelocities() const {
+    return header_.flags & kTrajectoryVelocities;
+}
+
+const double* TrajectoryReader::masses() const {
+    return reinterpret_cast<const double*>(data_ + sizeof(TrajectoryHeader));
+}
+
+TrajectoryFrame TrajectoryReader::frame(std::size_t k) const {
+    if (k >= offsets_.size()) {
+        throw std::out_of_range("Trajectory frame " + std::to_string(k) + " does not exist");
+    }
+    const double* data = reinterpret_cast<const double*>(data_ + offsets_[k]);
+    const std::size_t n = header_.num_bodies;
+    std::int64_t step;
+    std::memcpy(&step, data + 1, sizeof(step));
+
+    TrajectoryFrame frame;
+    frame.time = data[0];
+    frame.step = static_cast<long>(step);
+    frame.x = data + 2;
+    frame.y = frame.x + n;
+    frame.z = frame.y + n;
+    const bool velocities = hasVelocities();
+    frame.vx = velocities ? frame.z + n : nullptr;
+    frame.vy = velocities ? frame.vx + n : nullptr;
+    frame.vz = velocities ? frame.vy + n : nullptr;
+    return frame;
+}
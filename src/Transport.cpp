@@ -0,0 +1,229 @@
+#include "Transport.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+static_assert(std::atomic<int>::is_always_lock_free && std::atomic<std::uint64_t>::is_always_lock_free,
+              "The shared memory transport needs lock-free atomics, they are the only ones that work across processes");
+
+// Spins of a waiting rank between checks on the other processes
+constexpr int kSpinsPerCheck = 256;
+
+// Control block at the start of the shared mapping, the mailboxes follow it
+struct alignas(64) SharedControl {
+    std::atomic<int> arrived{0};
+    std::atomic<int> generation{0};
+    std::atomic<int> aborted{0};
+    // rank whose failure aborted the run, -1 while none has failed
+    std::atomic<int> first_failed{-1};
+    // length of the message in mailbox [phase][rank]
+    std::atomic<std::uint64_t> counts[2][kMaxLocalRanks];
+};
+
+// Function to stop every rank at its next transport call, remembering the rank that failed first
+void abortRun(SharedControl* control, int rank) {
+    int none = -1;
+    control->first_failed.compare_exchange_strong(none, rank);
+    control->aborted.store(1, std::memory_order_release);
+}
+
+class SharedMemoryTransport : public Transport {
+public:
+    SharedMemoryTransport(SharedControl* control, double* mailboxes, int rank, int num_ranks, std::size_t capacity, pid_t parent) :
+        control_(control), mailboxes_(mailboxes), rank_(rank), num_ranks_(num_ranks), capacity_(capacity), parent_(parent) {}
+
+    int rank() const override {
+        return rank_;
+    }
+
+    int numRanks() const override {
+        return num_ranks_;
+    }
+
+    std::size_t capacity() const override {
+        return capacity_;
+    }
+
+    // The mailboxes alternate between two phases, so a rank can write its next message while its
+    // neighbour still copies the last one; the barrier in between keeps them one phase apart
+    std::size_t shift(const double* send, std::size_t count, double* receive) override {
+        if (count > capacity_) {
+            throw std::invalid_argument("A message of " + std::to_string(count) + " doubles exceeds the transport capacity of " + std::to_string(capacity_));
+        }
+        std::memcpy(mailbox(rank_, phase_), send, count * sizeof(double));
+        control_->counts[phase_][rank_].store(count, std::memory_order_relaxed);
+        barrier();
+        const int source = (rank_ + num_ranks_ - 1) % num_ranks_;
+        const std::size_t received = control_->counts[phase_][source].load(std::memory_order_relaxed);
+        std::memcpy(receive, mailbox(source, phase_), received * sizeof(double));
+        phase_ = 1 - phase_;
+        return received;
+    }
+
+    // Sense by generation count: the last rank to arrive resets the count and opens the next generation
+    void barrier() override {
+        throwIfAborted();
+        const int generation = control_->generation.load(std::memory_order_acquire);
+        if (control_->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == num_ranks_) {
+            control_->arrived.store(0, std::memory_order_relaxed);
+            control_->generation.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        for (int spin = 1; control_->generation.load(std::memory_order_acquire) == generation; spin++) {
+            if (spin % kSpinsPerCheck == 0) {
+                checkOthers(generation);
+            }
+            // the ranks may share cores, so waiting gives the core to the rank being waited for
+            sched_yield();
+        }
+    }
+
+    // Function to note the forked children, so rank 0 can tell when one of them dies
+    void watch(const std::vector<pid_t>& children) {
+        children_ = children;
+        statuses_.assign(children.size(), -1);
+    }
+
+    // Function to wait for the children that have not exited yet, returns the first failed rank or 0
+    int reapChildren() {
+        int failed = 0;
+        for (std::size_t k = 0; k < children_.size(); k++) {
+            if (statuses_[k] == -1) {
+                int status;
+                statuses_[k] = waitpid(children_[k], &status, 0) == children_[k] ? status : 1;
+            }
+            if (!(WIFEXITED(statuses_[k]) && WEXITSTATUS(statuses_[k]) == 0) && failed == 0) {
+                failed = static_cast<int>(k) + 1;
+            }
+        }
+        return failed;
+    }
+
+private:
+    double* mailbox(int rank, int phase) const {
+        return mailboxes_ + (2 * static_cast<std::size_t>(rank) + phase) * capacity_;
+    }
+
+    void throwIfAborted() const {
+        if (control_->aborted.load(std::memory_order_acquire) != 0) {
+            throw std::runtime_error("Rank " + std::to_string(rank_) + " stopped because another rank of the run failed");
+        }
+    }
+
+    // Function to abort the run if a process it waits for is gone: a child seen by rank 0, the parent by a child.
+    // A child can open the barrier of the given generation and exit before rank 0 sees it open, so a child
+    // that exited cleanly fails the run only if the generation is still the one rank 0 waits at.
+    void checkOthers(int generation) {
+        throwIfAborted();
+        if (rank_ == 0) {
+            for (std::size_t k = 0; k < children_.size(); k++) {
+                int status;
+                if (statuses_[k] == -1 && waitpid(children_[k], &status, WNOHANG) == children_[k]) {
+                    statuses_[k] = status;
+                }
+                if (statuses_[k] == -1) {
+                    continue;
+                }
+                const bool clean_exit = WIFEXITED(statuses_[k]) && WEXITSTATUS(statuses_[k]) == 0;
+                if (!clean_exit || control_->generation.load(std::memory_order_acquire) == generation) {
+                    abortRun(control_, static_cast<int>(k) + 1);
+                }
+            }
+        }
+        else if (getppid() != parent_) {
+            abortRun(control_, 0);
+        }
+        throwIfAborted();
+    }
+
+    SharedControl* control_;
+    double* mailboxes_;
+    int rank_;
+    int num_ranks_;
+    std::size_t capacity_;
+    pid_t parent_;
+    int phase_ = 0;
+    std::vector<pid_t> children_;
+    std::vector<int> statuses_;
+};
+
+}
+
+void runLocalRanks(int num_ranks, std::size_t capacity, const std::function<void(Transport&)>& worker) {
+    if (num_ranks < 1 || num_ranks > kMaxLocalRanks) {
+        throw std::invalid_argument("A local run takes 1 to " + std::to_string(kMaxLocalRanks) + " ranks, not " + std::to_string(num_ranks));
+    }
+    const std::size_t mailbox_bytes = 2 * static_cast<std::size_t>(num_ranks) * capacity * sizeof(double);
+    const std::size_t bytes = sizeof(SharedControl) + mailbox_bytes;
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Cannot map " + std::to_string(bytes) + " bytes of shared memory for the ranks");
+    }
+    SharedControl* control = new (memory) SharedControl();
+    double* mailboxes = reinterpret_cast<double*>(static_cast<char*>(memory) + sizeof(SharedControl));
+
+    // output still buffered would otherwise be written once by every process
+    std::fflush(nullptr);
+    const pid_t parent = getpid();
+    std::vector<pid_t> children;
+    for (int rank = 1; rank < num_ranks; rank++) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            int status = 0;
+            try {
+                SharedMemoryTransport transport(control, mailboxes, rank, num_ranks, capacity, parent);
+                worker(transport);
+            }
+            catch (...) {
+                abortRun(control, rank);
+                status = 1;
+            }
+            std::fflush(nullptr);
+            _exit(status);
+        }
+        if (pid < 0) {
+            abortRun(control, 0);
+            break;
+        }
+        children.push_back(pid);
+    }
+
+    SharedMemoryTransport transport(control, mailboxes, 0, num_ranks, capacity, parent);
+    transport.watch(children);
+    std::exception_ptr failure;
+    if (static_cast<int>(children.size()) + 1 < num_ranks) {
+        failure = std::make_exception_ptr(std::runtime_error("Cannot start " + std::to_string(num_ranks) + " processes for the ranks"));
+    }
+    else {
+        try {
+            worker(transport);
+        }
+        catch (...) {
+            abortRun(control, 0);
+            failure = std::current_exception();
+        }
+    }
+    const int failed_child = transport.reapChildren();
+    const int first_failed = control->first_failed.load();
+    munmap(memory, bytes);
+
+    // rank 0 reports its own error, the failure of another rank is what stopped rank 0 otherwise
+    if (first_failed == 0 && failure) {
+        std::rethrow_exception(failure);
+    }
+    if (first_failed > 0 || failed_child != 0) {
+        throw std::runtime_error("Rank " + std::to_string(first_failed > 0 ? first_failed : failed_child) + " of the local run failed");
+    }
+}
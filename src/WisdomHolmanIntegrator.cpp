@@ -0,0 +1,210 @@
+#include "WisdomHolmanIntegrator.hpp"
+#include <exception>
+#include <stdexcept>
+#include "KeplerSolver.hpp"
+#include "Profiler.hpp"
+
+void WisdomHolmanIntegrator::reset() {
+    Integrator::reset();
+    state_for_ = nullptr;
+}
+
+void WisdomHolmanIntegrator::reserve(std::size_t num_particles) {
+    bodies_.reserve(num_particles);
+}
+
+// The heliocentric bodies are saved as they are, converting them back from the inertial arrays would not round the same way
+void WisdomHolmanIntegrator::saveState(const ParticleSystem& system, std::vector<double>& state) const {
+    const bool has_state = state_for_ == &system && bodies_.size() + 1 == system.size();
+    state.push_back(has_state ? 1.0 : 0.0);
+    if (!has_state) {
+        return;
+    }
+    state.push_back(central_mass_);
+    state.push_back(total_mass_);
+    state.insert(state.end(), com_, com_ + 3);
+    state.insert(state.end(), com_velocity_, com_velocity_ + 3);
+    state.push_back(forcesCurrent(bodies_) ? 1.0 : 0.0);
+    for (const AlignedVector* array : {&bodies_.x, &bodies_.y, &bodies_.z, &bodies_.vx, &bodies_.vy, &bodies_.vz, &bodies_.ax, &bodies_.ay, &bodies_.az, &bodies_.m}) {
+        appendState(state, *array);
+    }
+}
+
+void WisdomHolmanIntegrator::restoreState(ParticleSystem& system, const ForceSolver& solver, double epsilon, const std::vector<double>& state, std::size_t& pos) {
+    reset();
+    if (readState(state, pos) == 0.0) {
+        return;
+    }
+    central_mass_ = readState(state, pos);
+    total_mass_ = readState(state, pos);
+    for (int k = 0; k < 3; k++) {
+        com_[k] = readState(state, pos);
+    }
+    for (int k = 0; k < 3; k++) {
+        com_velocity_[k] = readState(state, pos);
+    }
+    const bool forces_current = readState(state, pos) != 0.0;
+    if (system.numMassive() == 0) {
+        throw std::invalid_argument("Wisdom-Holman integration needs a massive central body at index 0");
+    }
+    const std::size_t count = system.size() > 0 ? system.size() - 1 : 0;
+    for (AlignedVector* array : {&bodies_.x, &bodies_.y, &bodies_.z, &bodies_.vx, &bodies_.vy, &bodies_.vz, &bodies_.ax, &bodies_.ay, &bodies_.az, &bodies_.m}) {
+        readState(state, pos, *array, count);
+    }
+    bodies_.setNumMassive(system.numMassive() - 1);
+    if (forces_current) {
+        adoptForces(bodies_, solver, epsilon);
+    }
+    state_for_ = &system;
+}
+
+std::string WisdomHolmanIntegrator::name() const {
+    return "wh";
+}
+
+void WisdomHolmanIntegrator::step(ParticleSystem& system, ForceSolver& solver, double dt, double epsilon) {
+    if (state_for_ != &system || bodies_.size() + 1 != system.size()) {
+        toDemocraticHeliocentric(system);
+        Integrator::reset();
+        state_for_ = &system;
+    }
+
+    // interaction half kick, jump, Kepler drift, jump, interaction half kick
+    ensureForces(bodies_, solver, epsilon);
+    kick(bodies_, 0.5 * dt);
+    jump(0.5 * dt);
+    keplerStep(dt);
+    jump(0.5 * dt);
+    computeForces(bodies_, solver, epsilon);
+    kick(bodies_, 0.5 * dt);
+
+    for (int k = 0; k < 3; k++) {
+        com_[k] += dt * com_velocity_[k];
+    }
+    toInertial(system);
+}
+
+// Function to split the system into the centre of mass motion and heliocentric positions with barycentric velocities
+void WisdomHolmanIntegrator::toDemocraticHeliocentric(const ParticleSystem& system) {
+    const std::size_t n = system.size();
+    if (n == 0 || system.numMassive() == 0 || system.m[0] <= 0.0) {
+        throw std::invalid_argument("Wisdom-Holman integration needs a central body with positive mass at index 0");
+    }
+
+    central_mass_ = system.m[0];
+    total_mass_ = 0.0;
+    double r[3] = {0.0, 0.0, 0.0}, v[3] = {0.0, 0.0, 0.0};
+    for (std::size_t i = 0; i < n; i++) {
+        total_mass_ += system.m[i];
+        r[0] += system.m[i] * system.x[i];
+        r[1] += system.m[i] * system.y[i];
+        r[2] += system.m[i] * system.z[i];
+        v[0] += system.m[i] * system.vx[i];
+        v[1] += system.m[i] * system.vy[i];
+        v[2] += system.m[i] * system.vz[i];
+    }
+    for (int k = 0; k < 3; k++) {
+        com_[k] = r[k] / total_mass_;
+        com_velocity_[k] = v[k] / total_mass_;
+    }
+
+    bodies_.resize(n - 1);
+    for (std::size_t i = 1; i < n; i++) {
+        bodies_.x[i - 1] = system.x[i] - system.x[0];
+        bodies_.y[i - 1] = system.y[i] - system.y[0];
+        bodies_.z[i - 1] = system.z[i] - system.z[0];
+        bodies_.vx[i - 1] = system.vx[i] - com_velocity_[0];
+        bodies_.vy[i - 1] = system.vy[i] - com_velocity_[1];
+        bodies_.vz[i - 1] = system.vz[i] - com_velocity_[2];
+        bodies_.m[i - 1] = system.m[i];
+    }
+    bodies_.setNumMassive(system.numMassive() - 1);
+}
+
+void WisdomHolmanIntegrator::toInertial(ParticleSystem& system) const {
+    const int n = static_cast<int>(bodies_.size());
+    double q[3] = {0.0, 0.0, 0.0}, p[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < n; i++) {
+        q[0] += bodies_.m[i] * bodies_.x[i];
+        q[1] += bodies_.m[i] * bodies_.y[i];
+        q[2] += bodies_.m[i] * bodies_.z[i];
+        p[0] += bodies_.m[i] * bodies_.vx[i];
+        p[1] += bodies_.m[i] * bodies_.vy[i];
+        p[2] += bodies_.m[i] * bodies_.vz[i];
+    }
+
+    // The central body sits where the barycentre stays fixed and carries the opposite momentum
+    const double x0 = com_[0] - q[0] / total_mass_;
+    const double y0 = com_[1] - q[1] / total_mass_;
+    const double z0 = com_[2] - q[2] / total_mass_;
+    system.x[0] = x0;
+    system.y[0] = y0;
+    system.z[0] = z0;
+    system.vx[0] = com_velocity_[0] - p[0] / central_mass_;
+    system.vy[0] = com_velocity_[1] - p[1] / central_mass_;
+    system.vz[0] = com_velocity_[2] - p[2] / central_mass_;
+
+    #pragma omp parallel for simd
+    for (int i = 0; i < n; i++) {
+        system.x[i + 1] = bodies_.x[i] + x0;
+        system.y[i + 1] = bodies_.y[i] + y0;
+        system.z[i + 1] = bodies_.z[i] + z0;
+        system.vx[i + 1] = bodies_.vx[i] + com_velocity_[0];
+        system.vy[i + 1] = bodies_.vy[i] + com_velocity_[1];
+        system.vz[i + 1] = bodies_.vz[i] + com_velocity_[2];
+    }
+}
+
+// Function to drift every heliocentric position by the total barycentric momentum over the central mass
+void WisdomHolmanIntegrator::jump(double h) {
+    const int n = static_cast<int>(bodies_.size());
+    double px = 0.0, py = 0.0, pz = 0.0;
+    #pragma omp parallel for reduction(+:px, py, pz)
+    for (int i = 0; i < n; i++) {
+        px += bodies_.m[i] * bodies_.vx[i];
+        py += bodies_.m[i] * bodies_.vy[i];
+        pz += bodies_.m[i] * bodies_.vz[i];
+    }
+
+    const double s = h / central_mass_;
+    #pragma omp parallel for simd
+    for (int i = 0; i < n; i++) {
+        bodies_.x[i] += s * px;
+        bodies_.y[i] += s * py;
+        bodies_.z[i] += s * pz;
+    }
+}
+
+void WisdomHolmanIntegrator::keplerStep(double h) {
+    PROFILE_SCOPE(Kepler);
+    const int n = static_cast<int>(bodies_.size());
+    // exceptions cannot leave the parallel region, the first one is kept and rethrown after it
+    std::exception_ptr failure;
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < n; i++) {
+        double position[3] = {bodies_.x[i], bodies_.y[i], bodies_.z[i]};
+        double velocity[3] = {bodies_.vx[i], bodies_.vy[i], bodies_.vz[i]};
+        try {
+            keplerDrift(central_mass_, h, position, velocity);
+        }
+        catch (...) {
+            #pragma omp critical(kepler_failure)
+            if (!failure) {
+                failure = std::current_exception();
+            }
+            continue;
+        }
+        bodies_.x[i] = position[0];
+        bodies_.y[i] = position[1];
+        bodies_.z[i] = position[2];
+        bodies_.vx[i] = velocity[0];
+        bodies_.vy[i] = velocity[1];
+        bodies_.vz[i] = velocity[2];
+    }
+    if (failure) {
+        // the heliocentric bodies are half way through the step, the next step converts the system again,
+        // which step() has not written to yet
+        reset();
+        std::rethrow_exception(failure);
+    }
+}
@@ -4,10 +4,11 @@
 #include <cmath>
 #include <vector>
 #include <random>
+#include "Diagnostics.hpp"
 
 // Particle class constructor
 Particle::Particle(double in_mass, const Eigen::Vector3d& position, const Eigen::Vector3d& velocity, const Eigen::Vector3d& acceleration) :
-    mass{in_mass}, position_(position), velocity_(velocity), acceleration_(acceleration)
+    position_(position), velocity_(velocity), acceleration_(acceleration), mass{in_mass}
     {}
 
 // Functions for Particle class
@@ -45,7 +46,7 @@ Eigen::Vector3d calcAcceleration(const Particle& i, const Particle& j, double ep
 Eigen::Vector3d calcTotalAcceleration(const Particle& particle, const std::vector<Particle>& particles, double epsilon) {
     Eigen::Vector3d total_acc = Eigen::Vector3d::Zero();
 
-    for (int i = 0; i < particles.size(); i++) {
+    for (std::size_t i = 0; i < particles.size(); i++) {
         // Check that the particle does not interact with itself
         if ((particle.getPosition().isApprox(particles[i].getPosition())) == 0) {
             Eigen::Vector3d acc = calcAcceleration(particle, particles[i], epsilon);
@@ -55,6 +56,18 @@ Eigen::Vector3d calcTotalAcceleration(const Particle& particle, const std::vecto
     return total_acc;
 }
 
+// Function to calculate total acceleration on the particle at index due to all other particles, excluding itself by index
+Eigen::Vector3d calcTotalAcceleration(std::size_t index, const std::vector<Particle>& particles, double epsilon) {
+    Eigen::Vector3d total_acc = Eigen::Vector3d::Zero();
+
+    for (std::size_t i = 0; i < particles.size(); i++) {
+        if (i != index) {
+            total_acc += calcAcceleration(particles[index], particles[i], epsilon);
+        }
+    }
+    return total_acc;
+}
+
 // Function to generate initial conditions for the Solar system simulation
 std::vector<Particle> initial_condition_generator() {
     const std::vector<double> masses = {1.,1./6023600,1./408524,1./332946.038,1./3098710,1./1047.55,1./3499,1./22962,1./19352};
@@ -62,7 +75,7 @@ std::vector<Particle> initial_condition_generator() {
 
     std::vector<Particle> particles {Particle(1.0)};
 
-    for (int i = 1; i < masses.size(); i++) {
+    for (std::size_t i = 1; i < masses.size(); i++) {
         double m = masses[i];
         double theta = ((double)std::rand() / RAND_MAX) * 2 * M_PI;
         double r = distances[i];
@@ -81,18 +94,16 @@ std::vector<Particle> initial_condition_generator() {
 
 // Function to generate evolution conditions for the system simulation
 std::vector<Particle> evolution_Solar_System(std::vector<Particle> particles, double dt, int time_steps, double epsilon) {
+    std::vector<Eigen::Vector3d> accelerations(particles.size());
     for (int i = 0; i < time_steps; i++) {
-        std::vector<Eigen::Vector3d> accelerations(particles.size());
 
         #pragma omp parallel for
-        for (int j = 0; j < accelerations.size(); j++) {
-            Particle& p = particles[j];
-            Eigen::Vector3d acc = calcTotalAcceleration(p, particles, epsilon);
-            accelerations[j] = acc;
+        for (std::size_t j = 0; j < accelerations.size(); j++) {
+            accelerations[j] = calcTotalAcceleration(static_cast<std::size_t>(j), particles, epsilon);
         }
 
         #pragma omp parallel for
-        for (int k = 0; k < accelerations.size(); k++) {
+        for (std::size_t k = 0; k < accelerations.size(); k++) {
             Particle& p = particles[k];
             p = Particle(p.getMass(), p.getPosition(), p.getVelocity(), accelerations[k]);
             p.update(dt);
@@ -102,10 +113,10 @@ std::vector<Particle> evolution_Solar_System(std::vector<Particle> particles, do
 }
 
 // Function to calculate the total energy of a particle
-double getEnergy(Particle particle, std::vector<Particle> particles) {
+double getEnergy(const Particle& particle, const std::vector<Particle>& particles) {
     double kinetic_energy = 0.5 * particle.getMass() * particle.getVelocity().norm() * particle.getVelocity().norm();
     double potential_energy = 0.0;
-    for (int i = 0; i < particles.size(); i++) {
+    for (std::size_t i = 0; i < particles.size(); i++) {
         if (particle.getPosition().isApprox(particles[i].getPosition()) == 0) {
             potential_energy += -0.5 * particle.getMass() * particles[i].getMass() / (particle.getPosition() - particles[i].getPosition()).norm();
         }
@@ -115,11 +126,6 @@ double getEnergy(Particle particle, std::vector<Particle> particles) {
 }
 
 // Function to calculate the total energy of a list of particles
-double totalEnergy(std::vector<Particle> particles) {
-    double total_energy = 0.0;
-    for (int i = 0; i < particles.size(); i++) {
-        double energy = getEnergy(particles[i], particles);
-        total_energy += energy;
-    }
-    return total_energy;
+double totalEnergy(const std::vector<Particle>& particles) {
+    return computeDiagnostics(ParticleSystem(particles)).energy();
 }
\ No newline at end of file
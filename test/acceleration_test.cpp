@@ -1,6 +1,12 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <utility>
+#include <vector>
 #include "particle.hpp"
+#include "ForceKernel.hpp"
+#include "ForceSolver.hpp"
+#include "RandomSystemGenerator.hpp"
 
 
 TEST_CASE("Gravitational force between two particles") {
@@ -50,4 +56,124 @@ TEST_CASE("Zero acceleration between two equal particles") {
     std::vector<Particle> particles{p0, p1, p2};
     Eigen::Vector3d actual_total_acc = calcTotalAcceleration(p0, particles);
     REQUIRE(Eigen::Vector3d::Zero().isApprox(actual_total_acc, 0.001));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Close but distinct particles still interact when excluded by index") {
+    // isApprox treats these positions as equal, so the position based check drops the pair
+    Particle p0(1.0, Eigen::Vector3d(1e6, 0.0, 0.0));
+    Particle p1(1.0, Eigen::Vector3d(1e6 + 1e-7, 0.0, 0.0));
+    std::vector<Particle> particles{p0, p1};
+
+    REQUIRE(calcTotalAcceleration(p0, particles).isZero());
+    Eigen::Vector3d expected_acc = calcAcceleration(p0, p1);
+    REQUIRE(expected_acc.x() > 0.0);
+    REQUIRE(expected_acc.isApprox(calcTotalAcceleration(std::size_t(0), particles)));
+    REQUIRE((-expected_acc).isApprox(calcTotalAcceleration(std::size_t(1), particles)));
+}
+
+TEST_CASE("Pairwise symmetric solver matches direct summation") {
+    RandomSystemGenerator generator(257);
+    ParticleSystem direct = generator.generateParticleSystem();
+    ParticleSystem pairwise = direct;
+
+    DirectSolver().computeAccelerations(direct, 0.01);
+    PairwiseSolver().computeAccelerations(pairwise, 0.01);
+
+    Eigen::Vector3d momentum_change = Eigen::Vector3d::Zero();
+    for (std::size_t i = 0; i < direct.size(); i++) {
+        REQUIRE(direct.getAcceleration(i).isApprox(pairwise.getAcceleration(i), 1e-10));
+        momentum_change += pairwise.getMass(i) * pairwise.getAcceleration(i);
+    }
+    // Equal and opposite contributions cancel to rounding
+    REQUIRE(momentum_change.norm() < 1e-12);
+}
+
+TEST_CASE("Coincident bodies exert no force on each other in the pairwise kernels") {
+    // 19 bodies fill whole vector blocks and leave tails, two pairs share a position
+    ParticleSystem system = RandomSystemGenerator(19).generateParticleSystem();
+    for (auto [i, j] : {std::pair<int, int>{2, 7}, std::pair<int, int>{4, 17}}) {
+        system.x[j] = system.x[i];
+        system.y[j] = system.y[i];
+        system.z[j] = system.z[i];
+    }
+    ParticleSystem direct = system;
+    computeAccelerations(direct, 0.0);
+
+    const int n = static_cast<int>(system.size());
+    const SourceArrays sources = sourceArrays(system);
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > detectSimdLevel()) {
+            continue;
+        }
+        const PairRowKernel row = selectPairRowKernel(level);
+        std::vector<double> bx(n, 0.0), by(n, 0.0), bz(n, 0.0);
+        for (int i = 0; i < n; i++) {
+            row(sources, i, i + 1, n, 0.0, bx.data(), by.data(), bz.data());
+        }
+        for (int i = 0; i < n; i++) {
+            REQUIRE(Eigen::Vector3d(bx[i], by[i], bz[i]).isApprox(direct.getAcceleration(i), 1e-10));
+        }
+    }
+
+    // tiles of 4 put the coincident pairs in different tiles
+    PairwiseSolver(4).computeAccelerations(system, 0.0);
+    for (int i = 0; i < n; i++) {
+        REQUIRE(system.getAcceleration(i).isApprox(direct.getAcceleration(i), 1e-10));
+    }
+}
+
+TEST_CASE("Every available mixed precision kernel stays close to double precision") {
+    // 300 bodies cover two full tiles and a partial one
+    RandomSystemGenerator generator(300);
+    ParticleSystem system = generator.generateParticleSystem();
+    AlignedFloatVector x(system.x.begin(), system.x.end()), y(system.y.begin(), system.y.end());
+    AlignedFloatVector z(system.z.begin(), system.z.end()), m(system.m.begin(), system.m.end());
+    const SourceArraysFloat sources{x.data(), y.data(), z.data(), m.data(), system.size()};
+
+    for (double epsilon : {0.0, 0.01}) {
+        computeAccelerations(system, epsilon);
+        double rms = 0.0;
+        for (std::size_t i = 0; i < system.size(); i++) {
+            rms += system.getAcceleration(i).squaredNorm() / system.size();
+        }
+        rms = std::sqrt(rms);
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            if (level > detectSimdLevel()) {
+                continue;
+            }
+            const MixedPointKernel kernel = selectMixedKernel(level);
+            for (std::size_t i = 0; i < system.size(); i++) {
+                double acc[3];
+                kernel(sources, x[i], y[i], z[i], static_cast<float>(epsilon * epsilon), acc);
+                REQUIRE((Eigen::Vector3d(acc[0], acc[1], acc[2]) - system.getAcceleration(i)).norm() < 1e-4 * rms);
+            }
+        }
+    }
+}
+
+TEST_CASE("Mixed precision solver matches direct summation to single precision") {
+    RandomSystemGenerator generator(2000);
+    ParticleSystem direct = generator.generateParticleSystem();
+    ParticleSystem mixed = direct;
+    DirectSolver().computeAccelerations(direct, 0.01);
+    MixedPrecisionSolver solver;
+    solver.setComputePotential(true);
+    solver.computeAccelerations(mixed, 0.01);
+
+    double error2 = 0.0, norm2 = 0.0;
+    for (std::size_t i = 0; i < direct.size(); i++) {
+        error2 += (mixed.getAcceleration(i) - direct.getAcceleration(i)).squaredNorm();
+        norm2 += direct.getAcceleration(i).squaredNorm();
+    }
+    REQUIRE(std::sqrt(error2 / norm2) < 1e-5);
+    // the energy diagnostics must fall back to the double precision pair sum
+    REQUIRE_FALSE(solver.potentialAvailable());
+
+    SolverConfig config;
+    config.precision = "mixed";
+    REQUIRE(dynamic_cast<MixedPrecisionSolver*>(makeForceSolver(config).get()) != nullptr);
+    config.name = "bh";
+    REQUIRE_THROWS_AS(makeForceSolver(config), std::invalid_argument);
+    config.precision = "half";
+    REQUIRE_THROWS_AS(makeForceSolver(config), std::invalid_argument);
+}
@@ -0,0 +1,125 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <omp.h>
+#include "AutoTuner.hpp"
+#include "BarnesHutSolver.hpp"
+#include "ForceSolver.hpp"
+#include "ParallelSystemGenerator.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "SolarSystemGenerator.hpp"
+
+TEST_CASE("The tuned solver settings change the speed and not the forces") {
+    const ParticleSystem initial = RandomSystemGenerator(700, 50).generateParticleSystem();
+    ParticleSystem reference = initial;
+    PairwiseSolver().computeAccelerations(reference, 0.01);
+    for (int tile : {1, 64, 512, 1024}) {
+        ParticleSystem system = initial;
+        PairwiseSolver(tile).computeAccelerations(system, 0.01);
+        for (std::size_t i = 0; i < system.size(); i++) {
+            REQUIRE(system.getAcceleration(i).isApprox(reference.getAcceleration(i), 1e-12));
+        }
+    }
+
+    // the chunk only changes which thread walks a body
+    ParticleSystem tree_reference = initial;
+    BarnesHutSolver(0.5, false, 8, 64).computeAccelerations(tree_reference, 0.01);
+    for (int chunk : {1, 16, 1024}) {
+        ParticleSystem system = initial;
+        BarnesHutSolver(0.5, false, 8, chunk).computeAccelerations(system, 0.01);
+        for (std::size_t i = 0; i < system.size(); i++) {
+            REQUIRE(system.getAcceleration(i) == tree_reference.getAcceleration(i));
+        }
+    }
+
+    REQUIRE_THROWS_AS(PairwiseSolver(0), std::invalid_argument);
+    REQUIRE_THROWS_AS(BarnesHutSolver(0.5, false, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(BarnesHutSolver(0.5, false, 8, 0), std::invalid_argument);
+}
+
+TEST_CASE("Systems are banded by powers of two") {
+    REQUIRE(AutoTuner::band(1) == 0);
+    REQUIRE(AutoTuner::band(9) == 3);
+    REQUIRE(AutoTuner::band(1023) == 9);
+    REQUIRE(AutoTuner::band(1024) == 10);
+    REQUIRE(AutoTuner::hostKey().find_first_of(" \t") == std::string::npos);
+}
+
+TEST_CASE("The calibration finds the crossover from direct summation to the tree") {
+    const int threads = omp_get_max_threads();
+    const TuningChoice small = AutoTuner::calibrate(SolarSystemGenerator().generateParticleSystem(), 0.0, SolverConfig(), threads);
+    REQUIRE(small.solver.name != "bh");
+    REQUIRE(small.threads >= 1);
+    REQUIRE(small.threads <= threads);
+
+    SolverConfig base;
+    base.theta = 0.7;
+    const TuningChoice large = AutoTuner::calibrate(ParallelSystemGenerator("plummer", 16384).generateParticleSystem(), 0.01, base, threads);
+    REQUIRE(large.solver.name == "bh");
+    REQUIRE(large.solver.theta == 0.7);
+    REQUIRE(large.seconds > 0.0);
+    REQUIRE(omp_get_max_threads() == threads);
+
+    base.precision = "mixed";
+    REQUIRE_THROWS_AS(AutoTuner::calibrate(SolarSystemGenerator().generateParticleSystem(), 0.0, base, threads), std::invalid_argument);
+}
+
+TEST_CASE("A calibration is cached per host, bands, thread count and opening angle") {
+    const std::string path = "autotune_test_cache.txt";
+    std::remove(path.c_str());
+    const ParticleSystem system = RandomSystemGenerator(300).generateParticleSystem();
+
+    AutoTuner first(path);
+    const TuningChoice calibrated = first.tune(system, 0.01, SolverConfig());
+    REQUIRE(first.calibrated());
+
+    // another system of the same band is served from the cache
+    AutoTuner second(path);
+    const TuningChoice cached = second.tune(RandomSystemGenerator(500).generateParticleSystem(), 0.01, SolverConfig());
+    REQUIRE_FALSE(second.calibrated());
+    REQUIRE(cached.solver.name == calibrated.solver.name);
+    REQUIRE(cached.solver.tile == calibrated.solver.tile);
+    REQUIRE(cached.solver.leaf_size == calibrated.solver.leaf_size);
+    REQUIRE(cached.solver.chunk == calibrated.solver.chunk);
+    REQUIRE(cached.threads == calibrated.threads);
+    REQUIRE(cached.seconds == calibrated.seconds);
+
+    SECTION("another band, opening angle or host calibrates again") {
+        AutoTuner tuner(path);
+        tuner.tune(RandomSystemGenerator(600).generateParticleSystem(), 0.01, SolverConfig());
+        REQUIRE(tuner.calibrated());
+        // as many bodies, but most of them test particles
+        tuner.tune(RandomSystemGenerator(60, 240).generateParticleSystem(), 0.01, SolverConfig());
+        REQUIRE(tuner.calibrated());
+        SolverConfig wide;
+        wide.theta = 0.9;
+        tuner.tune(system, 0.01, wide);
+        REQUIRE(tuner.calibrated());
+
+        std::remove(path.c_str());
+        std::ofstream(path) << "other/1/scalar 8 8 1 0.5 0 bh 256 8 64 1 1e-6\n";
+        tuner.tune(system, 0.01, SolverConfig());
+        REQUIRE(tuner.calibrated());
+    }
+    SECTION("another thread count calibrates again and a cached thread count is capped") {
+        const int threads = omp_get_max_threads();
+        omp_set_num_threads(threads + 1);
+        AutoTuner tuner(path);
+        REQUIRE(tuner.tune(system, 0.01, SolverConfig()).threads <= threads + 1);
+        REQUIRE(tuner.calibrated());
+        omp_set_num_threads(threads);
+
+        std::ofstream(path, std::ios::app) << AutoTuner::hostKey() << " 8 8 " << threads << " 0.5 0 direct 256 8 64 " << threads + 8 << " 1e-6\n";
+        const TuningChoice capped = tuner.tune(system, 0.01, SolverConfig());
+        REQUIRE_FALSE(tuner.calibrated());
+        REQUIRE(capped.solver.name == "direct");
+        REQUIRE(capped.threads == threads);
+    }
+    SECTION("a malformed line is reported") {
+        std::ofstream(path, std::ios::app) << "other/1/scalar 8 8 1 0.5\n";
+        REQUIRE_THROWS_AS(AutoTuner(path).tune(system, 0.01, SolverConfig()), std::runtime_error);
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,56 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "BarnesHutSolver.hpp"
+#include "ForceKernel.hpp"
+#include "RandomSystemGenerator.hpp"
+
+// Mean relative error of the tree accelerations against direct summation
+double meanRelativeError(const ParticleSystem& tree, const ParticleSystem& direct) {
+    double error = 0.0;
+    for (std::size_t i = 0; i < direct.size(); i++) {
+        error += (tree.getAcceleration(i) - direct.getAcceleration(i)).norm() / direct.getAcceleration(i).norm();
+    }
+    return error / direct.size();
+}
+
+TEST_CASE("Barnes-Hut with theta = 0 reduces to direct summation") {
+    RandomSystemGenerator generator(300);
+    ParticleSystem direct = generator.generateParticleSystem();
+    ParticleSystem tree = direct;
+
+    computeAccelerations(direct, 0.01);
+    BarnesHutSolver solver(0.0);
+    solver.computeAccelerations(tree, 0.01);
+
+    REQUIRE(solver.nodeCount() > 1);
+    for (std::size_t i = 0; i < direct.size(); i++) {
+        REQUIRE(direct.getAcceleration(i).isApprox(tree.getAcceleration(i), 1e-10));
+    }
+}
+
+TEST_CASE("Quadrupole moments reduce the Barnes-Hut force error") {
+    RandomSystemGenerator generator(2000);
+    ParticleSystem direct = generator.generateParticleSystem();
+    // Drop the central star so the error is dominated by the disk itself
+    direct.m[0] = 0.0;
+    ParticleSystem monopole = direct;
+    ParticleSystem quadrupole = direct;
+
+    computeAccelerations(direct, 0.001);
+    BarnesHutSolver(0.7, false).computeAccelerations(monopole, 0.001);
+    BarnesHutSolver(0.7, true).computeAccelerations(quadrupole, 0.001);
+
+    double monopole_error = meanRelativeError(monopole, direct);
+    double quadrupole_error = meanRelativeError(quadrupole, direct);
+    REQUIRE(monopole_error < 0.05);
+    REQUIRE(quadrupole_error < monopole_error);
+}
+
+TEST_CASE("Solver factory selects the backend by name") {
+    SolverConfig config;
+    REQUIRE(dynamic_cast<DirectSolver*>(makeForceSolver(config).get()) != nullptr);
+    config.name = "bh";
+    REQUIRE(dynamic_cast<BarnesHutSolver*>(makeForceSolver(config).get()) != nullptr);
+    config.name = "fmm";
+    REQUIRE_THROWS(makeForceSolver(config));
+}
@@ -0,0 +1,80 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include "particle.hpp"
+#include "BarnesHutSolver.hpp"
+#include "BlockTimestepIntegrator.hpp"
+#include "RandomSystemGenerator.hpp"
+
+using Catch::Matchers::WithinAbs;
+
+// Sun with one light body at the inner edge of the random disks and twenty between radius 10 and 30
+ParticleSystem innerOuter() {
+    ParticleSystem system;
+    system.addParticle(1.0);
+    system.addParticle(1e-6, Eigen::Vector3d(0.4, 0, 0), Eigen::Vector3d(0, 1 / std::sqrt(0.4), 0));
+    for (int k = 0; k < 20; k++) {
+        double r = 10.0 + k;
+        double theta = 0.3 * k;
+        Eigen::Vector3d position(r * std::cos(theta), r * std::sin(theta), 0);
+        Eigen::Vector3d velocity(-std::sin(theta) / std::sqrt(r), std::cos(theta) / std::sqrt(r), 0);
+        system.addParticle(1e-6, position, velocity);
+    }
+    return system;
+}
+
+TEST_CASE("Solvers compute the same accelerations for active bodies as for all bodies") {
+    ParticleSystem all = RandomSystemGenerator(500).generateParticleSystem();
+    ParticleSystem some = all;
+    std::vector<int> active = {0, 7, 123, 499};
+
+    DirectSolver direct;
+    direct.computeAccelerations(all, 0.01);
+    direct.computeActiveAccelerations(some, active, 0.01);
+    for (int i : active) {
+        REQUIRE(some.getAcceleration(i).isApprox(all.getAcceleration(i), 1e-12));
+    }
+    REQUIRE(some.ax[1] == 0.0);
+
+    BarnesHutSolver tree(0.5);
+    tree.computeAccelerations(all, 0.01);
+    tree.computeActiveAccelerations(some, active, 0.01);
+    for (int i : active) {
+        REQUIRE(some.getAcceleration(i).isApprox(all.getAcceleration(i), 1e-12));
+    }
+}
+
+TEST_CASE("Block timesteps put inner bodies on finer levels than outer bodies") {
+    ParticleSystem system = innerOuter();
+    DirectSolver solver;
+    BlockTimestepIntegrator integrator(0.01, 12);
+    integrator.step(system, solver, 1.0, 0.0);
+
+    const std::vector<int>& levels = integrator.levels();
+    REQUIRE(levels[1] >= levels.back() + 5);
+}
+
+TEST_CASE("Block timesteps follow the inner orbit with far fewer force evaluations") {
+    double dt = 1.0;
+    int time_steps = 20;
+
+    ParticleSystem block_system = innerOuter();
+    DirectSolver solver;
+    BlockTimestepIntegrator block(0.01, 12);
+    evolution_Solar_System(block_system, solver, block, dt, time_steps);
+
+    // Leapfrog with every body on the finest step the inner body needed
+    ParticleSystem leapfrog_system = innerOuter();
+    LeapfrogIntegrator leapfrog;
+    int fine_steps = time_steps << block.levels()[1];
+    evolution_Solar_System(leapfrog_system, solver, leapfrog, dt * time_steps / fine_steps, fine_steps);
+
+    for (std::size_t i = 1; i < block_system.size(); i++) {
+        REQUIRE((block_system.getPosition(i) - leapfrog_system.getPosition(i)).norm() < 1e-3);
+    }
+    REQUIRE(8 * block.bodyForceEvaluations() < leapfrog.bodyForceEvaluations());
+
+    double energy_start = totalEnergy(innerOuter().toParticles());
+    double energy_end = totalEnergy(block_system.toParticles());
+    REQUIRE_THAT(energy_end, WithinAbs(energy_start, 1e-4 * std::abs(energy_start)));
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "Checkpoint.hpp"
+#include "CheckpointGenerator.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "Simulation.hpp"
+
+namespace {
+
+Simulation makeSimulation(ParticleSystem system, const std::string& integrator) {
+    return Simulation(std::move(system), std::make_unique<DirectSolver>(), makeIntegrator(integrator), 0.01, 0.01);
+}
+
+bool fileExists(const std::string& path) {
+    return std::ifstream(path).good();
+}
+
+}
+
+TEST_CASE("A restarted run continues exactly like an uninterrupted one") {
+    const std::string path = "checkpoint_test_restart.bin";
+    for (const std::string name : {"euler", "leapfrog", "verlet", "yoshida4", "wh", "block"}) {
+        DYNAMIC_SECTION(name) {
+            ParticleSystem initial = RandomSystemGenerator(50).generateParticleSystem();
+            Simulation uninterrupted = makeSimulation(initial, name);
+            uninterrupted.advance(10);
+            uninterrupted.writeCheckpoint(path);
+            REQUIRE_FALSE(fileExists(path + ".tmp"));
+            uninterrupted.advance(10);
+
+            CheckpointGenerator generator(path);
+            Simulation restarted = makeSimulation(generator.generateParticleSystem(), name);
+            restarted.restore(generator.checkpoint());
+            REQUIRE(restarted.steps() == 10);
+            REQUIRE(restarted.time() == generator.checkpoint().time());
+            restarted.advance(10);
+
+            for (std::size_t i = 0; i < restarted.size(); i++) {
+                REQUIRE(restarted.positions()[i] == uninterrupted.positions()[i]);
+                REQUIRE(restarted.velocities()[i] == uninterrupted.velocities()[i]);
+            }
+            REQUIRE(restarted.integrator().forceEvaluations() <= uninterrupted.integrator().forceEvaluations() / 2);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("A newer checkpoint replaces the old one") {
+    const std::string path = "checkpoint_test_replace.bin";
+    Simulation simulation = makeSimulation(RandomSystemGenerator(20).generateParticleSystem(), "leapfrog");
+    simulation.writeCheckpoint(path);
+    simulation.advance(5);
+    simulation.writeCheckpoint(path);
+
+    Checkpoint checkpoint(path);
+    REQUIRE(checkpoint.numBodies() == 20);
+    REQUIRE(checkpoint.steps() == 5);
+    REQUIRE(checkpoint.integrator() == "leapfrog");
+    ParticleSystem system;
+    checkpoint.loadInto(system);
+    REQUIRE(system.getPosition(7) == simulation.positions()[7]);
+    REQUIRE(system.getMass(7) == simulation.system().getMass(7));
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Restarting with different settings is rejected") {
+    const std::string path = "checkpoint_test_mismatch.bin";
+    Simulation block = makeSimulation(RandomSystemGenerator(20).generateParticleSystem(), "block");
+    block.advance(2);
+    block.writeCheckpoint(path);
+
+    Checkpoint checkpoint(path);
+    Simulation other_dt(ParticleSystem(), std::make_unique<DirectSolver>(), makeIntegrator("block"), 0.02, 0.01);
+    REQUIRE_THROWS_AS(other_dt.restore(checkpoint), std::invalid_argument);
+    Simulation leapfrog = makeSimulation(ParticleSystem(), "leapfrog");
+    REQUIRE_THROWS_AS(leapfrog.restore(checkpoint), std::invalid_argument);
+
+    // leapfrog and Verlet save no state of their own, only the recorded name tells them apart
+    leapfrog.writeCheckpoint(path);
+    Simulation verlet = makeSimulation(ParticleSystem(), "verlet");
+    REQUIRE_THROWS_AS(verlet.restore(Checkpoint(path)), std::invalid_argument);
+    std::remove(path.c_str());
+
+    // a truncated file is not taken for a checkpoint
+    std::ofstream(path, std::ios::binary) << std::string(100, '\0');
+    REQUIRE_THROWS_AS(Checkpoint(path), std::runtime_error);
+    REQUIRE_THROWS_AS(CheckpointGenerator("does_not_exist.bin"), std::runtime_error);
+    std::remove(path.c_str());
+}
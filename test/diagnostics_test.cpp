@@ -0,0 +1,81 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include "particle.hpp"
+#include "Diagnostics.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "Simulation.hpp"
+
+using Catch::Matchers::WithinAbs;
+using Catch::Matchers::WithinRel;
+
+TEST_CASE("Diagnostics of the Sun and the Earth") {
+    ParticleSystem system;
+    system.addParticle(1.0);
+    system.addParticle(0.001, Eigen::Vector3d(0, 2, 0), Eigen::Vector3d(-1, 0, 0));
+    Diagnostics d = computeDiagnostics(system);
+
+    REQUIRE_THAT(d.mass, WithinAbs(1.001, 1e-15));
+    REQUIRE_THAT(d.kinetic, WithinAbs(0.0005, 1e-15));
+    REQUIRE_THAT(d.potential, WithinAbs(-0.0005, 1e-15));
+    REQUIRE(d.momentum.isApprox(Eigen::Vector3d(-0.001, 0, 0)));
+    REQUIRE(d.angular_momentum.isApprox(Eigen::Vector3d(0, 0, 0.002)));
+    REQUIRE(d.centre_of_mass.isApprox(Eigen::Vector3d(0, 0.002 / 1.001, 0)));
+
+    // softening as in the force kernels
+    REQUIRE_THAT(computeDiagnostics(system, 1.5).potential, WithinAbs(-0.001 / 2.5, 1e-15));
+}
+
+TEST_CASE("Diagnostics energy matches the particle by particle sum") {
+    std::vector<Particle> particles = initial_condition_generator();
+    double energy = 0.0;
+    for (const Particle& p : particles) {
+        energy += getEnergy(p, particles);
+    }
+    REQUIRE_THAT(computeDiagnostics(ParticleSystem(particles)).energy(), WithinRel(energy, 1e-12));
+    REQUIRE_THAT(totalEnergy(particles), WithinRel(energy, 1e-12));
+}
+
+TEST_CASE("Potential from the direct solver gives the same energy as the pair sum") {
+    ParticleSystem system = RandomSystemGenerator(1000).generateParticleSystem();
+    DirectSolver solver;
+    solver.setComputePotential(true);
+    solver.computeAccelerations(system, 0.01);
+    REQUIRE(solver.potentialAvailable());
+
+    Diagnostics from_pairs = computeDiagnostics(system, 0.01);
+    Diagnostics from_solver = computeDiagnostics(system, solver.potential());
+    REQUIRE_THAT(from_solver.potential, WithinRel(from_pairs.potential, 1e-12));
+
+    // the accelerations are the same as without the potential
+    ParticleSystem plain = system;
+    DirectSolver plain_solver;
+    plain_solver.computeAccelerations(plain, 0.01);
+    REQUIRE(plain.getAcceleration(17).isApprox(system.getAcceleration(17), 1e-14));
+}
+
+TEST_CASE("Simulation diagnostics only reuse a potential that belongs to the current positions") {
+    ParticleSystem system = RandomSystemGenerator(200).generateParticleSystem();
+
+    Simulation leapfrog(system, std::make_unique<DirectSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.01, 0.01);
+    leapfrog.setComputePotential(true);
+    leapfrog.advance(10);
+    REQUIRE_THAT(leapfrog.diagnostics().potential, WithinRel(computeDiagnostics(leapfrog.system(), 0.01).potential, 1e-12));
+
+    // Euler evaluates the forces before it moves the bodies
+    Simulation euler(system, std::make_unique<DirectSolver>(), std::make_unique<EulerIntegrator>(), 0.01, 0.01);
+    euler.setComputePotential(true);
+    euler.advance(10);
+    REQUIRE(euler.diagnostics().potential == computeDiagnostics(euler.system(), 0.01).potential);
+}
+
+TEST_CASE("Leapfrog conserves momentum and keeps the centre of mass moving uniformly") {
+    Simulation simulation(RandomSystemGenerator(100).generateParticleSystem(), std::make_unique<PairwiseSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.01, 0.01);
+    Diagnostics start = simulation.diagnostics();
+    simulation.advance(100);
+    Diagnostics end = simulation.diagnostics();
+
+    REQUIRE((end.momentum - start.momentum).norm() < 1e-15);
+    REQUIRE((end.angular_momentum - start.angular_momentum).norm() < 1e-12);
+    REQUIRE(centreOfMassDrift(start, end, simulation.time()) < 1e-12);
+}
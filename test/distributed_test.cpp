@@ -0,0 +1,110 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+#include "DistributedRun.hpp"
+#include "ForceSolver.hpp"
+#include "Integrator.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "Simulation.hpp"
+#include "Transport.hpp"
+
+TEST_CASE("A shift passes every message once around the ring") {
+    for (int num_ranks : {1, 2, 5}) {
+        DYNAMIC_SECTION(num_ranks << " ranks") {
+            REQUIRE_NOTHROW(runLocalRanks(num_ranks, 4, [](Transport& transport) {
+                std::vector<double> seen(transport.numRanks(), 0.0);
+                double message[4] = {static_cast<double>(transport.rank()), 0, 0, 0};
+                double received[4];
+                seen[transport.rank()] = 1.0;
+                // messages of different lengths, so the length comes with each one
+                std::size_t length = 1 + transport.rank() % 4;
+                for (int hop = 1; hop < transport.numRanks(); hop++) {
+                    length = transport.shift(message, length, received);
+                    std::copy(received, received + length, message);
+                    const int from = static_cast<int>(message[0]);
+                    if (from != (transport.rank() + transport.numRanks() - hop) % transport.numRanks() || length != 1 + from % 4u) {
+                        throw std::runtime_error("A message arrived out of order");
+                    }
+                    seen[from] += 1.0;
+                }
+                for (double count : seen) {
+                    if (count != 1.0) {
+                        throw std::runtime_error("A message was lost or repeated");
+                    }
+                }
+            }));
+        }
+    }
+    REQUIRE_THROWS_AS(runLocalRanks(0, 4, [](Transport&) {}), std::invalid_argument);
+}
+
+TEST_CASE("Ranks in separate processes follow the single process leapfrog") {
+    const ParticleSystem initial = RandomSystemGenerator(50, 13).generateParticleSystem();
+    Simulation simulation(initial, std::make_unique<DirectSolver>(), makeIntegrator("leapfrog"), 0.01, 0.01);
+    simulation.advance(20);
+
+    for (int num_ranks : {1, 2, 3, 7}) {
+        DYNAMIC_SECTION(num_ranks << " ranks") {
+            ParticleSystem distributed = initial;
+            advanceDistributed(distributed, num_ranks, 0.01, 20, 0.01);
+            for (std::size_t i = 0; i < initial.size(); i++) {
+                REQUIRE(distributed.getPosition(i).isApprox(simulation.positions()[i], 1e-12));
+                REQUIRE(distributed.getVelocity(i).isApprox(simulation.velocities()[i], 1e-12));
+                REQUIRE(distributed.getAcceleration(i).isApprox(simulation.system().getAcceleration(i), 1e-12));
+            }
+        }
+    }
+}
+
+TEST_CASE("A failed rank stops the run instead of hanging it") {
+    SECTION("a rank throws") {
+        REQUIRE_THROWS_AS(runLocalRanks(4, 1, [](Transport& transport) {
+            double value = 0.0, received;
+            for (int step = 0; step < 100; step++) {
+                if (transport.rank() == 2 && step == 10) {
+                    throw std::runtime_error("rank 2 fails");
+                }
+                transport.shift(&value, 1, &received);
+            }
+        }), std::runtime_error);
+    }
+    SECTION("a rank dies") {
+        REQUIRE_THROWS_AS(runLocalRanks(3, 1, [](Transport& transport) {
+            if (transport.rank() == 1) {
+                _exit(3);
+            }
+            transport.barrier();
+        }), std::runtime_error);
+    }
+    SECTION("a rank returns while the others wait for it") {
+        REQUIRE_THROWS_AS(runLocalRanks(3, 1, [](Transport& transport) {
+            if (transport.rank() != 1) {
+                transport.barrier();
+            }
+        }), std::runtime_error);
+    }
+    SECTION("rank 0 reports its own error") {
+        REQUIRE_THROWS_AS(runLocalRanks(3, 1, [](Transport& transport) {
+            if (transport.rank() == 0) {
+                throw std::invalid_argument("rank 0 fails");
+            }
+            transport.barrier();
+        }), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Ranks that leave right after the last barrier do not fail the run") {
+    // rank 0 waits at the barrier while the others arrive and exit at once, so it often reaps a
+    // child before it sees the barrier open
+    for (int run = 0; run < 200; run++) {
+        REQUIRE_NOTHROW(runLocalRanks(4, 1, [](Transport& transport) {
+            if (transport.rank() != 0) {
+                usleep(100);
+            }
+            transport.barrier();
+        }));
+    }
+}
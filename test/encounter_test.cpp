@@ -0,0 +1,139 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "Diagnostics.hpp"
+#include "EncounterIntegrator.hpp"
+#include "Encounters.hpp"
+#include "ForceSolver.hpp"
+#include "Integrator.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "SolarSystemGenerator.hpp"
+
+namespace {
+
+// Two bodies on a hyperbolic flyby with a pericentre of 0.02 after 2 / 3 time units, watched by a
+// third one further out
+ParticleSystem flyby() {
+    ParticleSystem system;
+    system.addParticle(0.5, Eigen::Vector3d(-1.0, 0.0348, 0.0), Eigen::Vector3d(1.5, 0.0, 0.0));
+    system.addParticle(0.5, Eigen::Vector3d(1.0, -0.0348, 0.0), Eigen::Vector3d(-1.5, 0.0, 0.0));
+    system.addParticle(0.1, Eigen::Vector3d(0.0, 3.0, 0.0));
+    return system;
+}
+
+double energyError(Integrator& integrator, double dt, long steps) {
+    ParticleSystem system = flyby();
+    DirectSolver solver;
+    const double start = computeDiagnostics(system).energy();
+    for (long i = 0; i < steps; i++) {
+        integrator.step(system, solver, dt, 0.0);
+    }
+    return std::abs((computeDiagnostics(system).energy() - start) / start);
+}
+
+}
+
+TEST_CASE("The encounter grid finds the same pairs as a check of all pairs") {
+    const ParticleSystem system = RandomSystemGenerator(3000, 1000).generateParticleSystem();
+    for (double radius : {0.05, 0.3, 2.0}) {
+        EncounterGrid grid(radius);
+        std::vector<EncounterPair> expected;
+        for (int i = 0; i < static_cast<int>(system.numMassive()); i++) {
+            for (int j = i + 1; j < static_cast<int>(system.size()); j++) {
+                if ((system.getPosition(j) - system.getPosition(i)).squaredNorm() < radius * radius) {
+                    expected.emplace_back(i, j);
+                }
+            }
+        }
+        REQUIRE(!expected.empty());
+        REQUIRE(grid.findPairs(system) == expected);
+        // a second search reuses the buffers and gives the same answer
+        REQUIRE(grid.findPairs(system) == expected);
+    }
+    REQUIRE_THROWS_AS(EncounterGrid(0.0), std::invalid_argument);
+}
+
+TEST_CASE("Pairs that share a body form one group") {
+    std::vector<int> members, group_begin;
+    encounterGroups({{1, 5}, {2, 3}, {5, 9}, {3, 7}, {0, 9}}, members, group_begin);
+    REQUIRE(members == std::vector<int>{0, 1, 5, 9, 2, 3, 7});
+    REQUIRE(group_begin == std::vector<int>{0, 4, 7});
+}
+
+TEST_CASE("Without encounters the step is the leapfrog step") {
+    const ParticleSystem initial = SolarSystemGenerator().generateParticleSystem();
+    ParticleSystem leapfrog_system = initial;
+    ParticleSystem encounter_system = initial;
+    DirectSolver solver;
+    LeapfrogIntegrator leapfrog;
+    EncounterIntegrator encounter(1e-4);
+    for (int i = 0; i < 100; i++) {
+        leapfrog.step(leapfrog_system, solver, 0.01, 0.0);
+        encounter.step(encounter_system, solver, 0.01, 0.0);
+    }
+    REQUIRE(encounter.encounterPairs() == 0);
+    REQUIRE(encounter_system.x == leapfrog_system.x);
+    REQUIRE(encounter_system.vx == leapfrog_system.vx);
+    REQUIRE(encounter_system.az == leapfrog_system.az);
+}
+
+TEST_CASE("Substeps resolve a close flyby that the leapfrog step misses") {
+    LeapfrogIntegrator leapfrog;
+    EncounterIntegrator encounter(1.0);
+    const double leapfrog_error = energyError(leapfrog, 0.01, 150);
+    const double encounter_error = energyError(encounter, 0.01, 150);
+    REQUIRE(encounter.encounterPairs() > 0);
+    REQUIRE(encounter.substeps() > encounter.encounterPairs());
+    REQUIRE(leapfrog_error > 1.0);
+    REQUIRE(encounter_error < 1e-3);
+    REQUIRE_THROWS_AS(EncounterIntegrator(0.5, -1.0), std::invalid_argument);
+    REQUIRE_THROWS_AS(EncounterIntegrator(0.5, 1.0), std::invalid_argument);
+}
+
+TEST_CASE("Merging conserves mass and momentum and compacts the arrays") {
+    ParticleSystem system;
+    system.addParticle(1.0, Eigen::Vector3d(0.0, 0.0, 0.0), Eigen::Vector3d(0.0, 1.0, 0.0));
+    system.addParticle(0.5, Eigen::Vector3d(5.0, 0.0, 0.0));
+    system.addParticle(0.25, Eigen::Vector3d(0.01, 0.0, 0.0), Eigen::Vector3d(0.0, -1.0, 0.0));
+    system.addParticle(0.5, Eigen::Vector3d(5.0, 0.0, 0.01), Eigen::Vector3d(1.0, 0.0, 0.0));
+    system.addTestParticle(Eigen::Vector3d(0.0, 0.005, 0.0));
+    system.addTestParticle(Eigen::Vector3d(20.0, 0.0, 0.0));
+    system.addTestParticle(Eigen::Vector3d(20.0, 0.0, 0.001));
+    const Diagnostics before = computeDiagnostics(system);
+
+    EncounterGrid grid(0.05);
+    REQUIRE(mergeCollisions(system, grid) == 3);
+    REQUIRE(system.size() == 4);
+    REQUIRE(system.numMassive() == 2);
+    REQUIRE(system.m[0] == 1.25);
+    REQUIRE(system.m[1] == 1.0);
+    REQUIRE_THAT(system.x[0], Catch::Matchers::WithinAbs(0.002, 1e-15));
+    REQUIRE_THAT(system.vy[0], Catch::Matchers::WithinAbs(0.6, 1e-15));
+    REQUIRE(system.getPosition(1).isApprox(Eigen::Vector3d(5.0, 0.0, 0.005)));
+    REQUIRE(system.vx[1] == 0.5);
+    // the two test particles that met stay, they do not pull on each other
+    REQUIRE(system.x[2] == 20.0);
+    REQUIRE(system.x[3] == 20.0);
+
+    const Diagnostics after = computeDiagnostics(system);
+    REQUIRE((after.momentum - before.momentum).norm() < 1e-15);
+    REQUIRE_THAT(after.mass, Catch::Matchers::WithinAbs(before.mass, 1e-15));
+    REQUIRE(mergeCollisions(system, grid) == 0);
+    REQUIRE_THROWS_AS(system.removeParticles(std::vector<char>(3, 0)), std::invalid_argument);
+}
+
+TEST_CASE("The integrator merges bodies before it steps") {
+    ParticleSystem system = flyby();
+    DirectSolver solver;
+    const Diagnostics before = computeDiagnostics(system);
+    EncounterIntegrator encounter(1.0, 0.1);
+    for (int i = 0; i < 150; i++) {
+        encounter.step(system, solver, 0.01, 0.0);
+    }
+    REQUIRE(encounter.mergedBodies() == 1);
+    REQUIRE(system.size() == 2);
+    REQUIRE(system.m[0] == 1.0);
+    REQUIRE((computeDiagnostics(system).momentum - before.momentum).norm() < 1e-12);
+}
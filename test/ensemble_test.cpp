@@ -0,0 +1,74 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <map>
+#include <set>
+#include "Diagnostics.hpp"
+#include "Ensemble.hpp"
+#include "SolarSystemGenerator.hpp"
+#include "Simulation.hpp"
+
+using Catch::Matchers::WithinRel;
+
+namespace {
+
+ParticleSystem solarSystem(std::uint64_t seed) {
+    return SolarSystemGenerator(seed).generateParticleSystem();
+}
+
+}
+
+TEST_CASE("Seeded Solar systems are reproducible and differ between seeds") {
+    REQUIRE(solarSystem(5).getPosition(3) == solarSystem(5).getPosition(3));
+    REQUIRE(solarSystem(5).getPosition(3) != solarSystem(6).getPosition(3));
+
+    std::set<std::uint64_t> seeds;
+    for (long k = 0; k < 1000; k++) {
+        seeds.insert(ensembleMemberSeed(42, k));
+    }
+    REQUIRE(seeds.size() == 1000);
+}
+
+TEST_CASE("An ensemble member evolves like the same system run on its own") {
+    std::vector<EnsembleSummary> members;
+    EnsembleRunner(solarSystem, 0.01, 0.001, 4).run(3, 9, 200, [&](const EnsembleSummary& s) { members.push_back(s); });
+    REQUIRE(members.size() == 3);
+
+    for (const EnsembleSummary& member : members) {
+        Simulation alone(solarSystem(member.seed), std::make_unique<DirectSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.01, 0.001);
+        REQUIRE(member.seed == ensembleMemberSeed(9, member.member));
+        REQUIRE_THAT(member.energy_start, WithinRel(alone.diagnostics().energy(), 1e-12));
+        alone.advance(200);
+        REQUIRE_THAT(member.energy_end, WithinRel(alone.diagnostics().energy(), 1e-12));
+        REQUIRE(member.relativeEnergyError() < 1e-6);
+
+        // Jupiter keeps its near-circular orbit at 5.2 au
+        REQUIRE(member.elements.size() == 8);
+        REQUIRE_THAT(member.elements[4].semi_major_axis, WithinRel(5.2, 1e-2));
+        REQUIRE(member.elements[4].eccentricity < 0.01);
+    }
+}
+
+TEST_CASE("Ensemble results do not depend on the batch width") {
+    std::map<long, EnsembleSummary> narrow, wide;
+    EnsembleRunner(solarSystem, 0.01, 0.0, 1).run(10, 3, 50, [&](const EnsembleSummary& s) { narrow[s.member] = s; });
+    EnsembleRunner(solarSystem, 0.01, 0.0, 7).run(10, 3, 50, [&](const EnsembleSummary& s) { wide[s.member] = s; });
+    REQUIRE(narrow.size() == 10);
+    REQUIRE(wide.size() == 10);
+    for (long k = 0; k < 10; k++) {
+        REQUIRE(narrow[k].seed == wide[k].seed);
+        REQUIRE_THAT(narrow[k].energy_end, WithinRel(wide[k].energy_end, 1e-13));
+        REQUIRE_THAT(narrow[k].elements[7].semi_major_axis, WithinRel(wide[k].elements[7].semi_major_axis, 1e-13));
+    }
+}
+
+TEST_CASE("Ensemble members of different sizes are rejected") {
+    auto growing = [](std::uint64_t seed) {
+        ParticleSystem system = solarSystem(seed);
+        if (seed != ensembleMemberSeed(0, 0)) {
+            system.addParticle(1e-9, Eigen::Vector3d(50, 0, 0));
+        }
+        return system;
+    };
+    REQUIRE_THROWS_AS(EnsembleRunner(growing, 0.01).run(4, 0, 1, [](const EnsembleSummary&) {}), std::invalid_argument);
+    REQUIRE_THROWS_AS(EnsembleRunner(solarSystem, 0.01, 0.0, 0), std::invalid_argument);
+}
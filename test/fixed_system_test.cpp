@@ -0,0 +1,97 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "Diagnostics.hpp"
+#include "FixedSystem.hpp"
+#include "Integrator.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "SolarSystemGenerator.hpp"
+
+using Catch::Matchers::WithinAbs;
+using Catch::Matchers::WithinRel;
+
+namespace {
+
+// The same steps with the general solver and integrator
+ParticleSystem stepGeneral(ParticleSystem system, const std::string& name, double dt, int steps, double epsilon) {
+    DirectSolver solver;
+    std::unique_ptr<Integrator> integrator = makeIntegrator(name);
+    evolution_Solar_System(system, solver, *integrator, dt, steps, epsilon);
+    return system;
+}
+
+}
+
+TEST_CASE("Unrolled loops visit every index once in order") {
+    int visited = 0;
+    unrolledFor<0, 5>([&](auto i) {
+        REQUIRE(decltype(i)::value == visited);
+        visited++;
+    });
+    REQUIRE(visited == 5);
+}
+
+TEST_CASE("Fixed-size kernels follow the general leapfrog and Yoshida steps") {
+    ParticleSystem solar = SolarSystemGenerator(3).generateParticleSystem();
+    ParticleSystem cluster = RandomSystemGenerator(12).generateParticleSystem();
+
+    for (const std::string name : {"leapfrog", "yoshida4"}) {
+        for (const ParticleSystem* initial : {&solar, &cluster}) {
+            const double epsilon = initial == &solar ? 0.0 : 0.1;
+            const double dt = initial == &solar ? 0.01 : 0.001;
+            ParticleSystem expected = stepGeneral(*initial, name, dt, 200, epsilon);
+            ParticleSystem fixed = *initial;
+            advanceFixed(fixed, name, dt, 200, epsilon);
+            for (std::size_t i = 0; i < fixed.size(); i++) {
+                REQUIRE(fixed.getPosition(i).isApprox(expected.getPosition(i), 1e-10));
+                REQUIRE(fixed.getVelocity(i).isApprox(expected.getVelocity(i), 1e-10));
+                REQUIRE(fixed.getAcceleration(i).isApprox(expected.getAcceleration(i), 1e-9));
+            }
+        }
+    }
+}
+
+TEST_CASE("A fixed-size run split over several calls matches one call") {
+    ParticleSystem whole = SolarSystemGenerator(8).generateParticleSystem();
+    ParticleSystem split = whole;
+    advanceFixed(whole, "leapfrog", 0.01, 300);
+    advanceFixed(split, "leapfrog", 0.01, 100);
+    advanceFixed(split, "leapfrog", 0.01, 200);
+    for (std::size_t i = 0; i < whole.size(); i++) {
+        REQUIRE(whole.getPosition(i) == split.getPosition(i));
+        REQUIRE(whole.getVelocity(i) == split.getVelocity(i));
+    }
+}
+
+TEST_CASE("Compile-time Solar masses give the same steps as masses held with the state") {
+    const ParticleSystem initial = SolarSystemGenerator(5).generateParticleSystem();
+    FixedSystem<kSolarBodies, SolarMasses> constant;
+    FixedSystem<kSolarBodies> stored;
+    constant.load(initial);
+    stored.load(initial);
+    constant.computeAccelerations(0.0);
+    stored.computeAccelerations(0.0);
+    REQUIRE_THAT(constant.energy(0.0), WithinRel(computeDiagnostics(initial).energy(), 1e-13));
+
+    for (int step = 0; step < 1000; step++) {
+        constant.leapfrogStep(0.01, 0.0);
+        stored.leapfrogStep(0.01, 0.0);
+    }
+    for (int i = 0; i < kSolarBodies; i++) {
+        REQUIRE_THAT(constant.x[i], WithinAbs(stored.x[i], 1e-13));
+        REQUIRE_THAT(constant.vy[i], WithinAbs(stored.vy[i], 1e-13));
+    }
+    REQUIRE_THAT(constant.energy(0.0), WithinRel(stored.energy(0.0), 1e-13));
+}
+
+TEST_CASE("Fixed-size kernels reject unsupported sizes and integrators") {
+    REQUIRE(hasFixedKernel(2));
+    REQUIRE(hasFixedKernel(16, "yoshida4"));
+    REQUIRE_FALSE(hasFixedKernel(9, "wh"));
+
+    ParticleSystem large = RandomSystemGenerator(17).generateParticleSystem();
+    ParticleSystem single = RandomSystemGenerator(1).generateParticleSystem();
+    ParticleSystem solar = SolarSystemGenerator(1).generateParticleSystem();
+    REQUIRE_THROWS_AS(advanceFixed(large, "leapfrog", 0.01, 1), std::invalid_argument);
+    REQUIRE_THROWS_AS(advanceFixed(single, "leapfrog", 0.01, 1), std::invalid_argument);
+    REQUIRE_THROWS_AS(advanceFixed(solar, "verlet", 0.01, 1), std::invalid_argument);
+}
@@ -0,0 +1,76 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include "particle.hpp"
+#include "Integrator.hpp"
+
+// Sun and an Earth mass body on an orbit with eccentricity 0.44, a circular orbit would hide the energy error of the symmetric schemes
+ParticleSystem sunEarth() {
+    ParticleSystem system;
+    system.addParticle(1.0);
+    system.addParticle(1./332946.038, Eigen::Vector3d(0, 1, 0), Eigen::Vector3d(-1.2, 0, 0));
+    return system;
+}
+
+// Relative energy error after a time of 2π
+double energyError(Integrator& integrator, double dt) {
+    ParticleSystem system = sunEarth();
+    DirectSolver solver;
+    double energy_start = totalEnergy(system.toParticles());
+    evolution_Solar_System(system, solver, integrator, dt, int(2 * M_PI / dt));
+    return std::abs((totalEnergy(system.toParticles()) - energy_start) / energy_start);
+}
+
+TEST_CASE("Euler integrator matches the Particle update") {
+    std::vector<Particle> particles_start = initial_condition_generator();
+    std::vector<Particle> particles_end = evolution_Solar_System(particles_start, 0.01, 100);
+
+    ParticleSystem system(particles_start);
+    DirectSolver solver;
+    EulerIntegrator integrator;
+    evolution_Solar_System(system, solver, integrator, 0.01, 100);
+
+    for (std::size_t i = 0; i < particles_end.size(); i++) {
+        REQUIRE(particles_end[i].getPosition().isApprox(system.getPosition(i), 1e-9));
+    }
+}
+
+TEST_CASE("Symplectic integrators conserve energy far better than Euler") {
+    EulerIntegrator euler;
+    LeapfrogIntegrator leapfrog;
+    VelocityVerletIntegrator verlet;
+    YoshidaIntegrator yoshida;
+
+    double euler_error = energyError(euler, 0.01);
+    double leapfrog_error = energyError(leapfrog, 0.01);
+    double verlet_error = energyError(verlet, 0.01);
+    double yoshida_error = energyError(yoshida, 0.01);
+
+    REQUIRE(leapfrog_error < 1e-3 * euler_error);
+    REQUIRE_THAT(verlet_error, Catch::Matchers::WithinRel(leapfrog_error, 0.01));
+    REQUIRE(yoshida_error < 1e-2 * leapfrog_error);
+}
+
+TEST_CASE("Integrators reuse the force evaluation of the previous step") {
+    ParticleSystem system = sunEarth();
+    DirectSolver solver;
+
+    LeapfrogIntegrator leapfrog;
+    evolution_Solar_System(system, solver, leapfrog, 0.01, 10);
+    REQUIRE(leapfrog.forceEvaluations() == 11);
+
+    YoshidaIntegrator yoshida;
+    evolution_Solar_System(system, solver, yoshida, 0.01, 10);
+    REQUIRE(yoshida.forceEvaluations() == 31);
+
+    // Positions changed from outside: the cached accelerations must not be used
+    yoshida.reset();
+    system.x[1] += 0.1;
+    yoshida.step(system, solver, 0.01, 0.0);
+    REQUIRE(yoshida.forceEvaluations() == 35);
+}
+
+TEST_CASE("Integrator factory selects the scheme by name") {
+    REQUIRE(dynamic_cast<YoshidaIntegrator*>(makeIntegrator("yoshida4").get()) != nullptr);
+    REQUIRE_THROWS(makeIntegrator("rk4"));
+}
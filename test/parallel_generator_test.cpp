@@ -0,0 +1,110 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <string>
+#include <omp.h>
+#include "Diagnostics.hpp"
+#include "ParallelSystemGenerator.hpp"
+#include "Philox.hpp"
+
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+bool sameArrays(const ParticleSystem& a, const ParticleSystem& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.vx == b.vx && a.vy == b.vy && a.vz == b.vz && a.m == b.m;
+}
+
+}
+
+TEST_CASE("Philox matches the known answers of Random123") {
+    REQUIRE(philox4x32({0, 0, 0, 0}, 0) == PhiloxBlock{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+    REQUIRE(philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, 0xffffffffffffffffULL) == PhiloxBlock{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+    REQUIRE(philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, 0x299f31d0a4093822ULL) == PhiloxBlock{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1});
+
+    PhiloxStream stream(5, 3);
+    for (int k = 0; k < 1000; k++) {
+        const double u = stream.uniform();
+        REQUIRE(u > 0.0);
+        REQUIRE(u < 1.0);
+    }
+}
+
+TEST_CASE("Parallel generation gives the same bodies for any number of threads") {
+    const int max_threads = omp_get_max_threads();
+    for (const std::string name : {"disk", "thick-disk", "plummer"}) {
+        DYNAMIC_SECTION(name) {
+            // more bodies than one chunk of the centre of mass sum
+            omp_set_num_threads(1);
+            const ParticleSystem serial = ParallelSystemGenerator(name, 100000, 3).generateParticleSystem();
+            omp_set_num_threads(4);
+            const ParticleSystem parallel = ParallelSystemGenerator(name, 100000, 3).generateParticleSystem();
+            omp_set_num_threads(max_threads);
+            REQUIRE(sameArrays(serial, parallel));
+
+            const ParticleSystem other_seed = ParallelSystemGenerator(name, 100000, 4).generateParticleSystem();
+            REQUIRE(serial.x != other_seed.x);
+            // a longer system starts with the same bodies
+            const ParticleSystem longer = ParallelSystemGenerator(name, 100001, 3).generateParticleSystem();
+            if (name != "plummer") {
+                REQUIRE(longer.x[99999] == serial.x[99999]);
+            }
+        }
+    }
+    omp_set_num_threads(max_threads);
+}
+
+TEST_CASE("Disks orbit the central mass") {
+    const ParticleSystem disk = ParallelSystemGenerator("disk", 1000).generateParticleSystem();
+    const ParticleSystem thick = ParallelSystemGenerator("thick-disk", 1000).generateParticleSystem();
+    REQUIRE(disk.getMass(0) == 1.0);
+    REQUIRE(disk.getPosition(0).isZero());
+    double height2 = 0.0;
+    for (std::size_t i = 1; i < disk.size(); i++) {
+        const double r = disk.getPosition(i).norm();
+        REQUIRE(r >= 0.4);
+        REQUIRE(r <= 30.0);
+        REQUIRE(disk.z[i] == 0.0);
+        REQUIRE_THAT(disk.getVelocity(i).norm(), WithinAbs(1 / std::sqrt(r), 1e-12));
+        REQUIRE(disk.getPosition(i).dot(disk.getVelocity(i)) < 1e-12);
+        const double rho = std::hypot(thick.x[i], thick.y[i]);
+        height2 += thick.z[i] * thick.z[i] / (rho * rho);
+    }
+    REQUIRE_THAT(std::sqrt(height2 / (thick.size() - 1)), WithinAbs(kDiskAspect, 0.01));
+}
+
+TEST_CASE("A Plummer sphere starts in virial equilibrium at rest at the origin") {
+    const ParticleSystem sphere = ParallelSystemGenerator("plummer", 4000, 11).generateParticleSystem();
+    const Diagnostics d = computeDiagnostics(sphere);
+    REQUIRE_THAT(d.mass, WithinAbs(1.0, 1e-12));
+    REQUIRE(d.centre_of_mass.norm() < 1e-14);
+    REQUIRE(d.momentum.norm() < 1e-14);
+    // Henon units: E = -1/4 and 2K = -W, within the sampling noise of 4000 bodies
+    REQUIRE_THAT(d.energy(), WithinAbs(-0.25, 0.02));
+    REQUIRE_THAT(2 * d.kinetic / -d.potential, WithinAbs(1.0, 0.06));
+
+    REQUIRE_THROWS_AS(ParallelSystemGenerator("cube", 10), std::invalid_argument);
+}
+
+TEST_CASE("Test particles follow the massive bodies without changing them") {
+    for (const std::string name : {"disk", "plummer"}) {
+        DYNAMIC_SECTION(name) {
+            const ParticleSystem massive = ParallelSystemGenerator(name, 2000, 5).generateParticleSystem();
+            const ParticleSystem with_test = ParallelSystemGenerator(name, 2000, 5, 500).generateParticleSystem();
+            REQUIRE(with_test.size() == 2500);
+            REQUIRE(with_test.numMassive() == 2000);
+            REQUIRE(with_test.numTest() == 500);
+            for (std::size_t i = 0; i < massive.size(); i++) {
+                REQUIRE(with_test.x[i] == massive.x[i]);
+                REQUIRE(with_test.vz[i] == massive.vz[i]);
+            }
+            for (std::size_t i = massive.size(); i < with_test.size(); i++) {
+                REQUIRE(with_test.m[i] == 0.0);
+                REQUIRE(with_test.getPosition(i).norm() > 0.0);
+            }
+            // test particles are not copies of massive bodies
+            REQUIRE(with_test.x[2000] != massive.x[0]);
+            REQUIRE(with_test.x[2001] != massive.x[1]);
+        }
+    }
+}
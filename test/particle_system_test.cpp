@@ -0,0 +1,68 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cstdint>
+#include "particle.hpp"
+#include "ParticleSystem.hpp"
+#include "ForceKernel.hpp"
+#include "RandomSystemGenerator.hpp"
+
+TEST_CASE("ParticleSystem round-trips a list of particles") {
+    std::vector<Particle> particles = initial_condition_generator();
+    ParticleSystem system(particles);
+
+    REQUIRE(system.size() == particles.size());
+    REQUIRE(reinterpret_cast<std::uintptr_t>(system.x.data()) % 64 == 0);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(system.m.data()) % 64 == 0);
+
+    std::vector<Particle> back = system.toParticles();
+    for (std::size_t i = 0; i < particles.size(); i++) {
+        REQUIRE(back[i].getMass() == particles[i].getMass());
+        REQUIRE(back[i].getPosition() == particles[i].getPosition());
+        REQUIRE(back[i].getVelocity() == particles[i].getVelocity());
+    }
+}
+
+TEST_CASE("Random generator fills the arrays with the same bodies") {
+    RandomSystemGenerator generator(100);
+    std::vector<Particle> particles = generator.generateInitialConditions();
+    ParticleSystem system = generator.generateParticleSystem();
+
+    REQUIRE(system.size() == 100);
+    for (std::size_t i = 0; i < particles.size(); i++) {
+        REQUIRE(system.getMass(i) == particles[i].getMass());
+        REQUIRE(system.getPosition(i).isApprox(particles[i].getPosition()));
+    }
+}
+
+TEST_CASE("Every available SIMD kernel matches calcTotalAcceleration") {
+    // 37 bodies so the vector kernels also exercise their tails
+    RandomSystemGenerator generator(37);
+    std::vector<Particle> particles = generator.generateInitialConditions();
+    ParticleSystem system(particles);
+
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > detectSimdLevel()) {
+            continue;
+        }
+        for (double epsilon : {0.0, 0.01}) {
+            computeAccelerations(system, epsilon, level);
+            for (std::size_t i = 0; i < particles.size(); i++) {
+                Eigen::Vector3d expected = calcTotalAcceleration(particles[i], particles, epsilon);
+                REQUIRE(expected.isApprox(system.getAcceleration(i), 1e-12));
+            }
+        }
+    }
+}
+
+TEST_CASE("Structure-of-arrays evolution matches the Particle path") {
+    std::vector<Particle> particles_start = initial_condition_generator();
+    std::vector<Particle> particles_end = evolution_Solar_System(particles_start, 0.001, 500);
+
+    ParticleSystem system(particles_start);
+    evolution_Solar_System(system, 0.001, 500);
+
+    for (std::size_t i = 0; i < particles_end.size(); i++) {
+        REQUIRE(particles_end[i].getPosition().isApprox(system.getPosition(i), 1e-9));
+        REQUIRE(particles_end[i].getVelocity().isApprox(system.getVelocity(i), 1e-9));
+    }
+}
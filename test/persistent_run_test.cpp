@@ -0,0 +1,54 @@
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+#include <string>
+#include <omp.h>
+#include "ForceSolver.hpp"
+#include "Integrator.hpp"
+#include "PersistentRun.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "Simulation.hpp"
+
+namespace {
+
+void requireSameState(const ParticleSystem& a, const ParticleSystem& b) {
+    REQUIRE(a.x == b.x);
+    REQUIRE(a.y == b.y);
+    REQUIRE(a.z == b.z);
+    REQUIRE(a.vx == b.vx);
+    REQUIRE(a.vy == b.vy);
+    REQUIRE(a.vz == b.vz);
+    REQUIRE(a.ax == b.ax);
+    REQUIRE(a.ay == b.ay);
+    REQUIRE(a.az == b.az);
+}
+
+}
+
+TEST_CASE("The persistent region steps exactly like the integrators with direct summation") {
+    const int max_threads = omp_get_max_threads();
+    for (const std::string name : {"euler", "leapfrog"}) {
+        // more threads than bodies leaves some threads without a block
+        for (int threads : {1, 3, 64}) {
+            DYNAMIC_SECTION(name << " with " << threads << " threads") {
+                const ParticleSystem initial = RandomSystemGenerator(40, 20).generateParticleSystem();
+                Simulation simulation(initial, std::make_unique<DirectSolver>(), makeIntegrator(name), 0.01, 0.01);
+                simulation.advance(25);
+
+                omp_set_num_threads(threads);
+                ParticleSystem persistent = initial;
+                advancePersistent(persistent, name, 0.01, 10, 0.01);
+                advancePersistent(persistent, name, 0.01, 15, 0.01);
+                omp_set_num_threads(max_threads);
+                requireSameState(persistent, simulation.system());
+            }
+        }
+    }
+    omp_set_num_threads(max_threads);
+}
+
+TEST_CASE("The persistent region rejects other integrators") {
+    REQUIRE(hasPersistentKernel("leapfrog"));
+    REQUIRE_FALSE(hasPersistentKernel("yoshida4"));
+    ParticleSystem system = RandomSystemGenerator(10).generateParticleSystem();
+    REQUIRE_THROWS_AS(advancePersistent(system, "wh", 0.01, 1), std::invalid_argument);
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "BarnesHutSolver.hpp"
+#include "Profiler.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "Simulation.hpp"
+
+TEST_CASE("Profiler counts phases and pair interactions of a run") {
+    if (!Profiler::compiledIn()) {
+        WARN("built without NBODY_PROFILING");
+        return;
+    }
+    Simulation simulation(RandomSystemGenerator(100).generateParticleSystem(), std::make_unique<DirectSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.01, 0.01);
+    Profiler::enable();
+    simulation.advance(5);
+    Profiler::disable();
+
+    // the first step also evaluates the starting forces
+    REQUIRE(Profiler::calls(ProfilePhase::Force) == 6);
+    REQUIRE(Profiler::calls(ProfilePhase::Kick) == 10);
+    REQUIRE(Profiler::calls(ProfilePhase::Drift) == 5);
+    REQUIRE(Profiler::total(ProfileCounter::PairInteractions) == 6 * 100 * 99);
+    REQUIRE(Profiler::total(ProfileCounter::NodeVisits) == 0);
+
+    std::ostringstream summary;
+    Profiler::printSummary(summary);
+    REQUIRE(summary.str().find("| ForceLoop | ") != std::string::npos);
+
+    // nothing is recorded while disabled
+    simulation.advance(1);
+    REQUIRE(Profiler::calls(ProfilePhase::Force) == 6);
+}
+
+TEST_CASE("Profiler counts tree node visits and writes a trace") {
+    if (!Profiler::compiledIn()) {
+        WARN("built without NBODY_PROFILING");
+        return;
+    }
+    const std::string path = "profiler_test_trace.json";
+    ParticleSystem system = RandomSystemGenerator(1000).generateParticleSystem();
+    BarnesHutSolver solver;
+    Profiler::enable(true);
+    solver.computeAccelerations(system, 0.01);
+    Profiler::disable();
+
+    REQUIRE(Profiler::calls(ProfilePhase::TreeBuild) == 1);
+    REQUIRE(Profiler::total(ProfileCounter::NodeVisits) > 1000);
+    // the tree replaces most of the 1000 * 999 pairs
+    REQUIRE(Profiler::total(ProfileCounter::PairInteractions) < 1000 * 999 / 2);
+
+    Profiler::writeChromeTrace(path);
+    std::ifstream in(path);
+    std::string trace((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(trace.find("\"name\": \"TreeBuild\"") != std::string::npos);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,102 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "particle.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "Simulation.hpp"
+
+using Catch::Matchers::WithinAbs;
+
+// Every heap allocation of the test executable goes through these replacements
+std::atomic<long> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocations++;
+    std::size_t a = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(a, (size + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+// Number of heap allocations made while stepping a freshly constructed simulation
+long stepAllocations(const std::string& solver_name, const std::string& integrator_name) {
+    SolverConfig config;
+    config.name = solver_name;
+    Simulation simulation(RandomSystemGenerator(300).generateParticleSystem(), makeForceSolver(config), makeIntegrator(integrator_name), 0.01, 0.01);
+    long before = allocations;
+    simulation.advance(5);
+    return allocations - before;
+}
+
+TEST_CASE("Simulation follows the same trajectory as evolution_Solar_System") {
+    ParticleSystem system(initial_condition_generator());
+    DirectSolver solver;
+    LeapfrogIntegrator integrator;
+    Simulation simulation(system, std::make_unique<DirectSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.01);
+
+    evolution_Solar_System(system, solver, integrator, 0.01, 100);
+    simulation.advance(40);
+    simulation.advance(60);
+
+    REQUIRE(simulation.steps() == 100);
+    for (std::size_t i = 0; i < system.size(); i++) {
+        REQUIRE(simulation.positions()[i] == system.getPosition(i));
+        REQUIRE(simulation.velocities()[i] == system.getVelocity(i));
+    }
+}
+
+TEST_CASE("Simulation advances until a time with whole steps") {
+    Simulation simulation(ParticleSystem(initial_condition_generator()), std::make_unique<DirectSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.1);
+    simulation.advance_until(1.0);
+    REQUIRE(simulation.steps() == 10);
+    simulation.advance_until(1.05);
+    REQUIRE(simulation.steps() == 11);
+    REQUIRE_THAT(simulation.time(), WithinAbs(1.1, 1e-12));
+    simulation.advance_until(0.5);
+    REQUIRE(simulation.steps() == 11);
+    REQUIRE(simulation.integrator().forceEvaluations() == 12);
+}
+
+TEST_CASE("Simulation views point into the particle arrays") {
+    Simulation simulation(ParticleSystem(initial_condition_generator()), std::make_unique<DirectSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.1);
+    VectorView positions = simulation.positions();
+    simulation.step();
+    REQUIRE(positions.x == simulation.system().x.data());
+    REQUIRE(positions.count == simulation.size());
+    REQUIRE(positions[3] == simulation.system().getPosition(3));
+}
+
+TEST_CASE("Stepping a simulation does not allocate") {
+    // start the OpenMP thread pool, which allocates once per process
+    #pragma omp parallel
+    {}
+
+    long before = allocations;
+    ParticleSystem counted(10);
+    REQUIRE(allocations > before);
+
+    REQUIRE(stepAllocations("direct", "euler") == 0);
+    REQUIRE(stepAllocations("direct", "leapfrog") == 0);
+    REQUIRE(stepAllocations("direct", "verlet") == 0);
+    REQUIRE(stepAllocations("direct", "yoshida4") == 0);
+    REQUIRE(stepAllocations("direct", "wh") == 0);
+    REQUIRE(stepAllocations("direct", "block") == 0);
+    REQUIRE(stepAllocations("pairwise", "leapfrog") == 0);
+    REQUIRE(stepAllocations("bh", "leapfrog") == 0);
+}
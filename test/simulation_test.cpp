@@ -6,7 +6,7 @@ TEST_CASE("Masses & distances of the Solar System") {
     std::vector<Particle> particles = initial_condition_generator();
     const std::vector<double> masses = {1.,1./6023600,1./408524,1./332946.038,1./3098710,1./1047.55,1./3499,1./22962,1./19352};
     const std::vector<double> distances = {0.0, 0.4, 0.7, 1, 1.5, 5.2, 9.5, 19.2, 30.1};
-    for (int i = 0; i < particles.size(); i++) {
+    for (std::size_t i = 0; i < particles.size(); i++) {
         Particle p = particles[i];
         double actual_m = p.getMass();
         double actual_d = (particles[0].getPosition() - p.getPosition()).norm();
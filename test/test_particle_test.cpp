@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "Checkpoint.hpp"
+#include "CheckpointGenerator.hpp"
+#include "Diagnostics.hpp"
+#include "ForceSolver.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "Simulation.hpp"
+#include "SolarSystemGenerator.hpp"
+
+using Catch::Matchers::WithinRel;
+
+namespace {
+
+// The same bodies with the massless ones treated as sources, so every solver takes the full sum
+ParticleSystem allMassive(ParticleSystem system) {
+    system.setNumMassive(system.size());
+    return system;
+}
+
+}
+
+TEST_CASE("Test particles are kept after the massive bodies") {
+    ParticleSystem system;
+    system.addParticle(1.0);
+    system.addTestParticle(Eigen::Vector3d(1, 0, 0), Eigen::Vector3d(0, 1, 0));
+    system.addParticle(0.001, Eigen::Vector3d(0, 2, 0));
+    REQUIRE(system.size() == 3);
+    REQUIRE(system.numMassive() == 2);
+    REQUIRE(system.numTest() == 1);
+    REQUIRE(system.getMass(1) == 0.001);
+    REQUIRE(system.getPosition(2) == Eigen::Vector3d(1, 0, 0));
+    REQUIRE(system.getVelocity(2) == Eigen::Vector3d(0, 1, 0));
+
+    REQUIRE_THROWS_AS(system.setNumMassive(1), std::invalid_argument);
+    REQUIRE_THROWS_AS(system.setNumMassive(4), std::invalid_argument);
+    system.setNumMassive(3);
+    REQUIRE(system.numTest() == 0);
+
+    // a system without test particles counts every body as massive
+    ParticleSystem plain = RandomSystemGenerator(10).generateParticleSystem();
+    REQUIRE(plain.numMassive() == 10);
+    plain.resize(12);
+    REQUIRE(plain.numMassive() == 12);
+}
+
+TEST_CASE("Solvers give test particles the accelerations of the full sum") {
+    ParticleSystem system = RandomSystemGenerator(100, 300).generateParticleSystem();
+    REQUIRE(system.numMassive() == 100);
+    REQUIRE(system.numTest() == 300);
+    ParticleSystem reference = allMassive(system);
+    DirectSolver().computeAccelerations(reference, 0.01);
+
+    for (const std::string name : {"direct", "pairwise", "bh"}) {
+        DYNAMIC_SECTION(name) {
+            SolverConfig config;
+            config.name = name;
+            config.theta = 0.0;
+            ParticleSystem split = system;
+            makeForceSolver(config)->computeAccelerations(split, 0.01);
+            for (std::size_t i = 0; i < system.size(); i++) {
+                REQUIRE(split.getAcceleration(i).isApprox(reference.getAcceleration(i), 1e-10));
+            }
+        }
+    }
+
+    SECTION("mixed") {
+        ParticleSystem split = system;
+        MixedPrecisionSolver().computeAccelerations(split, 0.01);
+        for (std::size_t i = 0; i < system.size(); i++) {
+            REQUIRE(split.getAcceleration(i).isApprox(reference.getAcceleration(i), 1e-4));
+        }
+    }
+}
+
+TEST_CASE("Test particles do not change the massive bodies or the diagnostics") {
+    ParticleSystem planets = SolarSystemGenerator(7).generateParticleSystem();
+    ParticleSystem belt = SolarSystemGenerator(7, 500).generateParticleSystem();
+    REQUIRE(belt.numMassive() == kSolarBodies);
+    REQUIRE(belt.numTest() == 500);
+
+    const Diagnostics d_planets = computeDiagnostics(planets);
+    const Diagnostics d_belt = computeDiagnostics(belt);
+    REQUIRE(d_belt.energy() == d_planets.energy());
+    REQUIRE(d_belt.momentum == d_planets.momentum);
+
+    for (const std::string name : {"leapfrog", "wh"}) {
+        DYNAMIC_SECTION(name) {
+            Simulation alone(planets, std::make_unique<DirectSolver>(), makeIntegrator(name), 0.01);
+            Simulation with_belt(belt, std::make_unique<PairwiseSolver>(), makeIntegrator(name), 0.01);
+            alone.advance(200);
+            with_belt.advance(200);
+            for (int i = 0; i < kSolarBodies; i++) {
+                REQUIRE(with_belt.positions()[i].isApprox(alone.positions()[i], 1e-12));
+            }
+            // the belt stays between Mars and Jupiter over the run
+            for (std::size_t i = kSolarBodies; i < belt.size(); i++) {
+                const double r = (with_belt.positions()[i] - with_belt.positions()[0]).norm();
+                REQUIRE(r > 0.9 * kBeltInner);
+                REQUIRE(r < 1.1 * kBeltOuter);
+            }
+        }
+    }
+}
+
+TEST_CASE("Checkpoints keep the test particles") {
+    const std::string path = "test_particle_checkpoint.bin";
+    Simulation simulation(RandomSystemGenerator(20, 30).generateParticleSystem(), std::make_unique<DirectSolver>(), makeIntegrator("leapfrog"), 0.01, 0.01);
+    simulation.advance(3);
+    simulation.writeCheckpoint(path);
+
+    ParticleSystem system;
+    CheckpointGenerator(path).checkpoint().loadInto(system);
+    REQUIRE(system.numMassive() == 20);
+    REQUIRE(system.numTest() == 30);
+    REQUIRE(system.getPosition(40) == simulation.positions()[40]);
+    std::remove(path.c_str());
+}
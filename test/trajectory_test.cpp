@@ -0,0 +1,127 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "particle.hpp"
+#include "CheckpointGenerator.hpp"
+#include "RandomSystemGenerator.hpp"
+#include "Simulation.hpp"
+#include "Trajectory.hpp"
+
+TEST_CASE("Trajectory frames read back as written") {
+    const std::string path = "trajectory_test_frames.bin";
+    Simulation simulation(RandomSystemGenerator(100).generateParticleSystem(), std::make_unique<DirectSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.01, 0.01);
+    std::vector<ParticleSystem> expected;
+    {
+        TrajectoryWriter writer(path, simulation.system());
+        for (int k = 0; k < 5; k++) {
+            writer.write(simulation.system(), simulation.time(), simulation.steps());
+            expected.push_back(simulation.system());
+            simulation.advance(3);
+        }
+        REQUIRE(writer.framesQueued() == 5);
+    }
+
+    TrajectoryReader reader(path);
+    REQUIRE(reader.numBodies() == 100);
+    REQUIRE(reader.numFrames() == 5);
+    REQUIRE(reader.hasVelocities());
+    REQUIRE(reader.masses()[42] == expected[0].m[42]);
+
+    // random access, last frame first
+    for (int k = 4; k >= 0; k--) {
+        TrajectoryFrame frame = reader.frame(k);
+        REQUIRE(frame.step == 3 * k);
+        REQUIRE(frame.time == 0.03 * k);
+        for (int i = 0; i < 100; i++) {
+            REQUIRE(frame.x[i] == expected[k].x[i]);
+            REQUIRE(frame.z[i] == expected[k].z[i]);
+            REQUIRE(frame.vy[i] == expected[k].vy[i]);
+        }
+    }
+    REQUIRE_THROWS_AS(reader.frame(5), std::out_of_range);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Trajectory without velocities and without an index") {
+    const std::string path = "trajectory_test_positions.bin";
+    ParticleSystem system(initial_condition_generator());
+    {
+        TrajectoryWriter writer(path, system, false);
+        writer.write(system, 0.0, 0);
+        system.x[3] = 7.0;
+        writer.write(system, 1.0, 10);
+    }
+
+    // Cut the index off, as if the writer had never been closed
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    TrajectoryHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    bytes.resize(header.index_offset);
+    header.num_frames = 0;
+    header.index_offset = 0;
+    std::memcpy(&bytes[0], &header, sizeof(header));
+    std::ofstream(path, std::ios::binary) << bytes;
+
+    TrajectoryReader reader(path);
+    REQUIRE_FALSE(reader.hasVelocities());
+    REQUIRE(reader.numFrames() == 2);
+    REQUIRE(reader.frame(1).x[3] == 7.0);
+    REQUIRE(reader.frame(1).step == 10);
+    REQUIRE(reader.frame(1).vx == nullptr);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("A restarted run continues the trajectory from its checkpoint") {
+    const std::string path = "trajectory_test_restart.bin";
+    const std::string checkpoint = "trajectory_test_restart.ckpt";
+    Simulation first(RandomSystemGenerator(30).generateParticleSystem(), std::make_unique<DirectSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.01, 0.01);
+    std::vector<ParticleSystem> expected;
+    {
+        TrajectoryWriter writer(path, first.system());
+        while (first.steps() <= 10) {
+            writer.write(first.system(), first.time(), first.steps());
+            expected.push_back(first.system());
+            if (first.steps() == 4) {
+                first.writeCheckpoint(checkpoint);
+            }
+            first.advance(2);
+        }
+    }
+
+    // the first run got to step 10, the restart goes back to the checkpoint at step 4
+    CheckpointGenerator generator(checkpoint);
+    Simulation second(generator.generateParticleSystem(), std::make_unique<DirectSolver>(), std::make_unique<LeapfrogIntegrator>(), 0.01, 0.01);
+    second.restore(generator.checkpoint());
+    {
+        TrajectoryWriter writer(path, second.system(), true, second.steps());
+        while (second.steps() < 10) {
+            second.advance(2);
+            writer.write(second.system(), second.time(), second.steps());
+        }
+    }
+
+    TrajectoryReader reader(path);
+    REQUIRE(reader.numFrames() == expected.size());
+    for (std::size_t k = 0; k < expected.size(); k++) {
+        REQUIRE(reader.frame(k).step == static_cast<long>(2 * k));
+        REQUIRE(reader.frame(k).x[7] == expected[k].x[7]);
+        REQUIRE(reader.frame(k).vz[29] == expected[k].vz[29]);
+    }
+    REQUIRE_THROWS_AS(TrajectoryWriter(path, RandomSystemGenerator(31).generateParticleSystem(), true, 4), std::runtime_error);
+    REQUIRE_THROWS_AS(TrajectoryWriter(path, second.system(), false, 4), std::runtime_error);
+    std::remove(path.c_str());
+    std::remove(checkpoint.c_str());
+}
+
+TEST_CASE("Trajectory reader rejects other files") {
+    const std::string path = "trajectory_test_text.bin";
+    std::ofstream(path) << "Body No.1 Start position: 0 0 0 and some more text to fill the header";
+    REQUIRE_THROWS_AS(TrajectoryReader(path), std::runtime_error);
+    REQUIRE_THROWS_AS(TrajectoryReader("does_not_exist.bin"), std::runtime_error);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <stdexcept>
+#include "particle.hpp"
+#include "KeplerSolver.hpp"
+#include "WisdomHolmanIntegrator.hpp"
+
+using Catch::Matchers::WithinAbs;
+
+// Specific orbital energy of a body relative to the attracting mass
+double orbitalEnergy(double mu, const double* position, const double* velocity) {
+    double r = std::sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+    double v2 = velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2];
+    return 0.5 * v2 - mu / r;
+}
+
+TEST_CASE("Stumpff functions match their closed forms") {
+    double c[4];
+    stumpff(2.25, c);
+    REQUIRE_THAT(c[0], WithinAbs(std::cos(1.5), 1e-14));
+    REQUIRE_THAT(c[1], WithinAbs(std::sin(1.5) / 1.5, 1e-14));
+    REQUIRE_THAT(c[2], WithinAbs((1 - std::cos(1.5)) / 2.25, 1e-14));
+    REQUIRE_THAT(c[3], WithinAbs((1.5 - std::sin(1.5)) / (2.25 * 1.5), 1e-14));
+
+    stumpff(-4.0, c);
+    REQUIRE_THAT(c[0], WithinAbs(std::cosh(2.0), 1e-13));
+    REQUIRE_THAT(c[3], WithinAbs((std::sinh(2.0) - 2.0) / 8.0, 1e-14));
+}
+
+TEST_CASE("Kepler drift returns an eccentric orbit to its start after one period") {
+    // Semi-major axis 1 around mu = 1, so the period is 2π
+    double position[3] = {0.5, 0.0, 0.0};
+    double velocity[3] = {0.0, std::sqrt(3.0), 0.0};
+    for (int i = 0; i < 7; i++) {
+        keplerDrift(1.0, 2 * M_PI / 7, position, velocity);
+    }
+    REQUIRE_THAT(position[0], WithinAbs(0.5, 1e-12));
+    REQUIRE_THAT(position[1], WithinAbs(0.0, 1e-12));
+    REQUIRE_THAT(velocity[1], WithinAbs(std::sqrt(3.0), 1e-12));
+}
+
+TEST_CASE("Kepler drift is reversible on a hyperbolic orbit") {
+    double position[3] = {1.0, 0.2, -0.1};
+    double velocity[3] = {0.3, 1.6, 0.2};
+    double energy = orbitalEnergy(1.0, position, velocity);
+    REQUIRE(energy > 0.0);
+
+    keplerDrift(1.0, 50.0, position, velocity);
+    REQUIRE_THAT(orbitalEnergy(1.0, position, velocity), WithinAbs(energy, 1e-12));
+    keplerDrift(1.0, -50.0, position, velocity);
+    REQUIRE_THAT(position[0], WithinAbs(1.0, 1e-10));
+    REQUIRE_THAT(position[1], WithinAbs(0.2, 1e-10));
+    REQUIRE_THAT(velocity[2], WithinAbs(0.2, 1e-10));
+}
+
+TEST_CASE("Kepler drift of a body at the central mass fails instead of hanging") {
+    double position[3] = {0.0, 0.0, 0.0};
+    double velocity[3] = {0.5, 0.0, 0.0};
+    REQUIRE_THROWS_AS(keplerDrift(1.0, 0.1, position, velocity), std::runtime_error);
+    // the state is left as it was
+    REQUIRE(position[0] == 0.0);
+    REQUIRE(velocity[0] == 0.5);
+
+    double nan_position[3] = {NAN, 1.0, 0.0};
+    double nan_velocity[3] = {0.0, 1.0, 0.0};
+    REQUIRE_THROWS_AS(keplerDrift(1.0, 0.1, nan_position, nan_velocity), std::runtime_error);
+}
+
+TEST_CASE("Wisdom-Holman keeps the Solar System energy at large timesteps") {
+    std::vector<Particle> particles = initial_condition_generator();
+    double energy_start = totalEnergy(particles);
+    double dt = 0.1;
+    int time_steps = int(10 * 2 * M_PI / dt);
+
+    ParticleSystem leapfrog_system(particles);
+    ParticleSystem wh_system(particles);
+    DirectSolver solver;
+    LeapfrogIntegrator leapfrog;
+    WisdomHolmanIntegrator wh;
+    evolution_Solar_System(leapfrog_system, solver, leapfrog, dt, time_steps);
+    evolution_Solar_System(wh_system, solver, wh, dt, time_steps);
+
+    double leapfrog_error = std::abs(totalEnergy(leapfrog_system.toParticles()) - energy_start);
+    double wh_error = std::abs(totalEnergy(wh_system.toParticles()) - energy_start);
+    REQUIRE(wh_error < 1e-2 * leapfrog_error);
+    REQUIRE(wh.forceEvaluations() == time_steps + 1);
+}
+
+TEST_CASE("Wisdom-Holman rejects a system without a massive central body") {
+    ParticleSystem solar(initial_condition_generator());
+    DirectSolver solver;
+    WisdomHolmanIntegrator wh;
+    wh.step(solar, solver, 0.01, 0.0);
+    std::vector<double> state;
+    wh.saveState(solar, state);
+
+    ParticleSystem test_only;
+    for (std::size_t i = 0; i < solar.size(); i++) {
+        test_only.addTestParticle(solar.getPosition(i), solar.getVelocity(i));
+    }
+    REQUIRE(test_only.numMassive() == 0);
+    REQUIRE_THROWS_AS(WisdomHolmanIntegrator().step(test_only, solver, 0.01, 0.0), std::invalid_argument);
+    std::size_t pos = 0;
+    REQUIRE_THROWS_AS(WisdomHolmanIntegrator().restoreState(test_only, solver, 0.0, state, pos), std::invalid_argument);
+}
+
+TEST_CASE("A failed Kepler drift inside a step throws and leaves the system unchanged") {
+    ParticleSystem system(initial_condition_generator());
+    system.x[3] = NAN;
+    const ParticleSystem start = system;
+    DirectSolver solver;
+    WisdomHolmanIntegrator wh;
+    REQUIRE_THROWS_AS(wh.step(system, solver, 0.01, 0.0), std::runtime_error);
+    for (std::size_t i = 0; i < system.size(); i++) {
+        REQUIRE((system.vx[i] == start.vx[i] && system.y[i] == start.y[i]));
+        REQUIRE((i == 3 || system.x[i] == start.x[i]));
+    }
+
+    // the integrator starts over from the system once it is repaired
+    system.x[3] = 1.5;
+    REQUIRE_NOTHROW(wh.step(system, solver, 0.01, 0.0));
+    REQUIRE(std::isfinite(system.x[3]));
+}